@@ -17,6 +17,7 @@
 #define GRPPI_COMMON_CALLABLE_TRAITS_H
 
 #include <type_traits>
+#include <utility>
 
 namespace grppi {
 
@@ -90,8 +91,42 @@ constexpr bool has_arguments() {
   return typename internal::callable<F>::arity() != 0;
 }
 
+template <typename ... T>
+struct make_void { using type = void; };
+
+// Meta-function for determining if a callable accepts an rvalue of type T
+template <typename F, typename T, typename = void>
+struct accepts_rvalue : std::false_type {};
+
+template <typename F, typename T>
+struct accepts_rvalue<F, T, typename make_void<
+    decltype(std::declval<F>()(std::declval<T>()))>::type> :
+  std::true_type {};
+
 } // end namespace internal
 
+/**
+\brief Invokes a callable on an item that is no longer needed by the caller.
+The item is moved when the callable accepts an rvalue, and passed as an
+lvalue otherwise, so that callables taking a non-const reference still work.
+*/
+template <typename F, typename T,
+          std::enable_if_t<internal::accepts_rvalue<F,T>::value, int> = 0>
+decltype(auto) invoke_on_item(F && f, T & item) {
+  return std::forward<F>(f)(std::move(item));
+}
+
+template <typename F, typename T,
+          std::enable_if_t<!internal::accepts_rvalue<F,T>::value, int> = 0>
+decltype(auto) invoke_on_item(F && f, T & item) {
+  return std::forward<F>(f)(item);
+}
+
+// Result of invoking a callable on an item through invoke_on_item
+template <typename F, typename T>
+using item_result_t = decltype(invoke_on_item(
+    std::declval<F>(), std::declval<std::remove_reference_t<T>&>()));
+
 
 // Meta-function for determining if F is consumer of I
 template <typename F, typename I>
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_CANCELLATION_H
+#define GRPPI_COMMON_CANCELLATION_H
+
+#include <atomic>
+
+namespace grppi {
+
+/**
+\brief Token for the cooperative cancellation of patterns.
+
+A token is attached to an execution policy, which checks it while running a
+pattern. Once cancelled, generators stop producing items, stages discard the
+items still in flight and data patterns stop processing new chunks. Patterns
+still finish in an orderly way, so that every thread is joined and every
+queue is drained.
+
+A token may be cancelled from any thread, including the operations of the
+pattern being cancelled. It must outlive every policy it is attached to.
+*/
+class cancellation_token {
+public:
+
+  /**
+  \brief Constructs a token that is not cancelled.
+  */
+  cancellation_token() noexcept = default;
+
+  cancellation_token(cancellation_token const &) = delete;
+  cancellation_token & operator=(cancellation_token const &) = delete;
+
+  /**
+  \brief Requests the cancellation of the patterns checking the token.
+  */
+  void cancel() noexcept { cancelled_.store(true, std::memory_order_release); }
+
+  /**
+  \brief Checks if cancellation was requested.
+  */
+  bool is_cancelled() const noexcept {
+    return cancelled_.load(std::memory_order_acquire);
+  }
+
+  /**
+  \brief Clears a cancellation request so that the token can be reused.
+  \pre No pattern checking the token is running.
+  */
+  void reset() noexcept { cancelled_.store(false, std::memory_order_release); }
+
+private:
+  std::atomic<bool> cancelled_{false};
+};
+
+}
+
+#endif
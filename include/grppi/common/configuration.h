@@ -34,6 +34,17 @@ enum class execution_backend {
   ff
 };
 
+enum class farm_distribution {
+  shared,
+  sharded
+};
+
+enum class loop_schedule {
+  static_chunks,
+  dynamic_chunks,
+  guided_chunks
+};
+
 class environment_option_getter {
 public:
   char const * operator()(char const * var_name) { return std::getenv(var_name); }
@@ -49,6 +60,13 @@ public:
     set_ordering(option_getter("GRPPI_ORDERING"));
     set_queue_size(option_getter("GRPPI_QUEUE_SIZE"));
     set_queue_mode(option_getter("GRPPI_QUEUE_MODE"));
+    set_queue_wait(option_getter("GRPPI_QUEUE_WAIT"));
+    set_queue_limit(option_getter("GRPPI_QUEUE_LIMIT"));
+    set_reorder_capacity(option_getter("GRPPI_REORDER_CAPACITY"));
+    set_farm_distribution(option_getter("GRPPI_FARM_DISTRIBUTION"));
+    set_queue_statistics(option_getter("GRPPI_QUEUE_STATS"));
+    set_schedule(option_getter("GRPPI_SCHEDULE"));
+    set_stage_fusion(option_getter("GRPPI_STAGE_FUSION"));
     set_dynamic_backend(option_getter("GRPPI_DYN_BACKEND"));
   }
 
@@ -68,6 +86,38 @@ public:
     return queue_mode_;
   }
 
+  std::size_t queue_limit() const noexcept {
+    return queue_limit_;
+  }
+
+  int reorder_capacity() const noexcept {
+    return reorder_capacity_;
+  }
+
+  queue_wait wait_mode() const noexcept {
+    return queue_wait_;
+  }
+
+  farm_distribution distribution() const noexcept {
+    return farm_distribution_;
+  }
+
+  bool queue_statistics_enabled() const noexcept {
+    return queue_statistics_;
+  }
+
+  loop_schedule schedule() const noexcept {
+    return schedule_;
+  }
+
+  std::size_t schedule_chunk() const noexcept {
+    return schedule_chunk_;
+  }
+
+  bool stage_fusion_enabled() const noexcept {
+    return stage_fusion_;
+  }
+
   execution_backend dynamic_backend() const noexcept {
     return dynamic_backend_;
   }
@@ -117,6 +167,36 @@ public:
     }  
   }
 
+  void set_queue_limit(char const * str) noexcept {
+    if (!str) return;
+    try {
+      long long limit = std::stoll(str);
+      if (limit < 0) {
+        std::cerr << "GrPPI: Invalid queue limit \"" << limit << "\"\n";
+        return;
+      }
+      queue_limit_ = static_cast<std::size_t>(limit);
+    }
+    catch (...) {
+      std::cerr << "GrPPI: Invalid queue limit \"" << str << "\"\n";
+    }
+  }
+
+  void set_reorder_capacity(char const * str) noexcept {
+    if (!str) return;
+    try {
+      int capacity = std::stoi(str);
+      if (capacity <= 0) {
+        std::cerr << "GrPPI: Invalid reorder capacity \"" << capacity << "\"\n";
+        return;
+      }
+      reorder_capacity_ = capacity;
+    }
+    catch (...) {
+      std::cerr << "GrPPI: Invalid reorder capacity \"" << str << "\"\n";
+    }
+  }
+
    void set_queue_mode(char const * str) noexcept {
      if (!str) return;
      if (strcmp(str, "blocking") == 0) {
@@ -125,10 +205,105 @@ public:
      else if (strcmp(str, "lockfree") == 0) {
        queue_mode_ = queue_mode::lockfree;
      }
+     else if (strcmp(str, "sequenced") == 0) {
+       queue_mode_ = queue_mode::sequenced;
+     }
+     else if (strcmp(str, "unbounded") == 0) {
+       queue_mode_ = queue_mode::unbounded;
+     }
      else {
        std::cerr << "GrPPI: Invalid queue mode \"" << str << "\"\n";
      }
    }
+
+   void set_queue_wait(char const * str) noexcept {
+     if (!str) return;
+     if (strcmp(str, "spin") == 0) {
+       queue_wait_ = queue_wait::spin;
+     }
+     else if (strcmp(str, "backoff") == 0) {
+       queue_wait_ = queue_wait::backoff;
+     }
+     else {
+       std::cerr << "GrPPI: Invalid queue wait \"" << str << "\"\n";
+     }
+   }
+
+   void set_farm_distribution(char const * str) noexcept {
+     if (!str) return;
+     if (strcmp(str, "shared") == 0) {
+       farm_distribution_ = farm_distribution::shared;
+     }
+     else if (strcmp(str, "sharded") == 0) {
+       farm_distribution_ = farm_distribution::sharded;
+     }
+     else {
+       std::cerr << "GrPPI: Invalid farm distribution \"" << str << "\"\n";
+     }
+   }
+
+   void set_queue_statistics(char const * str) noexcept {
+     if (!str) return;
+     if (strcmp(str, "on") == 0) {
+       queue_statistics_ = true;
+     }
+     else if (strcmp(str, "off") == 0) {
+       queue_statistics_ = false;
+     }
+     else {
+       std::cerr << "GrPPI: Invalid queue statistics \"" << str << "\"\n";
+     }
+   }
+
+   void set_schedule(char const * str) noexcept {
+     if (!str) return;
+     char const * chunk = std::strchr(str, ',');
+     std::string kind_name = chunk ? std::string(str, chunk) : std::string(str);
+     loop_schedule kind;
+     if (kind_name == "static") {
+       kind = loop_schedule::static_chunks;
+     }
+     else if (kind_name == "dynamic") {
+       kind = loop_schedule::dynamic_chunks;
+     }
+     else if (kind_name == "guided") {
+       kind = loop_schedule::guided_chunks;
+     }
+     else {
+       std::cerr << "GrPPI: Invalid schedule \"" << str << "\"\n";
+       return;
+     }
+     std::size_t chunk_size = 0;
+     if (chunk) {
+       try {
+         long long sz = std::stoll(chunk+1);
+         if (sz <= 0) {
+           std::cerr << "GrPPI: Invalid schedule chunk \"" << sz << "\"\n";
+           return;
+         }
+         chunk_size = static_cast<std::size_t>(sz);
+       }
+       catch (...) {
+         std::cerr << "GrPPI: Invalid schedule chunk \"" << chunk+1 << "\"\n";
+         return;
+       }
+     }
+     schedule_ = kind;
+     schedule_chunk_ = chunk_size;
+   }
+
+   void set_stage_fusion(char const * str) noexcept {
+     if (!str) return;
+     if (strcmp(str, "on") == 0) {
+       stage_fusion_ = true;
+     }
+     else if (strcmp(str, "off") == 0) {
+       stage_fusion_ = false;
+     }
+     else {
+       std::cerr << "GrPPI: Invalid stage fusion \"" << str << "\"\n";
+     }
+   }
   
    void set_dynamic_backend(char const * str) noexcept {
      if (!str) return;
@@ -157,11 +332,21 @@ public:
 
   constexpr static int default_queue_size = 100;
 
+  constexpr static int default_reorder_capacity = 1024;
+
 private:
   int concurrency_degree_ = static_cast<int>(std::thread::hardware_concurrency());
   bool ordering_ = true;
   int queue_size_ = default_queue_size;
   queue_mode queue_mode_ = queue_mode::blocking;
+  queue_wait queue_wait_ = queue_wait::spin;
+  std::size_t queue_limit_ = 0;
+  int reorder_capacity_ = default_reorder_capacity;
+  farm_distribution farm_distribution_ = farm_distribution::shared;
+  bool queue_statistics_ = false;
+  loop_schedule schedule_ = loop_schedule::static_chunks;
+  std::size_t schedule_chunk_ = 0;
+  bool stage_fusion_ = false;
   execution_backend dynamic_backend_ = execution_backend::seq;
 
 };
@@ -169,6 +354,9 @@ private:
 template <typename OptionGetter>
 constexpr int configuration<OptionGetter>::default_queue_size;
 
+template <typename OptionGetter>
+constexpr int configuration<OptionGetter>::default_reorder_capacity;
+
 }
 
 #endif
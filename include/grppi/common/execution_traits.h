@@ -56,6 +56,13 @@ constexpr bool supports_reduce() { return false; }
 template <typename E>
 constexpr bool supports_map_reduce() { return false; }
 
+/**
+\brief Determines if an execution policy supports the map-reduce by key pattern.
+\note This must be specialized by every execution policy supporting the pattern.
+*/
+template <typename E>
+constexpr bool supports_map_reduce_by_key() { return false; }
+
 /**
 \brief Determines if an execution policy supports the stencil pattern.
 \note This must be specialized by every execution policy supporting the pattern.
@@ -63,6 +70,20 @@ constexpr bool supports_map_reduce() { return false; }
 template <typename E>
 constexpr bool supports_stencil() { return false; }
 
+/**
+\brief Determines if an execution policy supports the scan pattern.
+\note This must be specialized by every execution policy supporting the pattern.
+*/
+template <typename E>
+constexpr bool supports_scan() { return false; }
+
+/**
+\brief Determines if an execution policy supports the sort pattern.
+\note This must be specialized by every execution policy supporting the pattern.
+*/
+template <typename E>
+constexpr bool supports_sort() { return false; }
+
 /**
 \brief Determines if an execution policy supports the divide-conquer pattern.
 \note This must be specialized by every execution policy supporting the pattern.
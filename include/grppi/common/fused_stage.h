@@ -0,0 +1,75 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_FUSED_STAGE_H
+#define GRPPI_COMMON_FUSED_STAGE_H
+
+#include "callable_traits.h"
+
+#include <utility>
+
+namespace grppi {
+
+/**
+\brief Representation of two consecutive pipeline stages fused in one.
+The fused stage applies the second transformer to the result of the first
+one, so that both run in the same thread without a queue between them.
+A fused stage is a plain callable and not a pattern.
+\tparam Transformer Callable type for the first stage.
+\tparam Next Callable type for the second stage.
+*/
+template <typename Transformer, typename Next>
+class fused_stage_t {
+public:
+
+  using transformer_type = Transformer;
+  using next_type = Next;
+
+  /**
+  \brief Constructs a fused stage from two consecutive stages.
+  \param t Transformer for the first stage.
+  \param n Transformer for the second stage.
+  */
+  fused_stage_t(Transformer && t, Next && n) noexcept :
+    transformer_{std::forward<Transformer>(t)},
+    next_{std::forward<Next>(n)}
+  {}
+
+  /**
+  \brief Invokes both stages over a data item.
+  */
+  template <typename I>
+  auto operator()(I && item) {
+    auto result = invoke_on_item(transformer_, item);
+    return invoke_on_item(next_, result);
+  }
+
+  /**
+  \brief Invokes both stages over a data item.
+  */
+  template <typename I>
+  auto operator()(I && item) const {
+    auto result = invoke_on_item(transformer_, item);
+    return invoke_on_item(next_, result);
+  }
+
+private:
+  Transformer transformer_;
+  Next next_;
+};
+
+}
+
+#endif
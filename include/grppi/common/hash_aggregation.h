@@ -0,0 +1,300 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_HASH_AGGREGATION_H
+#define GRPPI_COMMON_HASH_AGGREGATION_H
+
+#include "optional.h"
+
+#include <vector>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace grppi {
+
+/**
+\brief Open addressing hash table combining the values of equal keys.
+
+Entries are stored in a single array with linear probing, so that
+aggregating a value does not allocate unless the table grows. The table
+keeps the hash of every entry, so that entries may be moved to another
+table without hashing their keys again. Hashes must be well distributed
+in their lower bits, as given by mix_hash().
+\tparam Key Type of the keys.
+\tparam Value Type of the aggregated values.
+\tparam KeyEqual Callable type for key equality.
+*/
+template <typename Key, typename Value,
+          typename KeyEqual = std::equal_to<Key>>
+class hash_aggregation_table {
+public:
+
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<Key,Value>;
+
+  /**
+  \brief Constructs an empty table.
+  \param capacity Initial capacity (rounded up to a power of two).
+  */
+  explicit hash_aggregation_table(std::size_t capacity = 16);
+
+  /**
+  \brief Inserts a key with its value, or combines the value with the
+  one already aggregated for the key.
+  \param hash Hash of the key.
+  \param key Key to be inserted.
+  \param value Value to be aggregated.
+  \param combine_op Combiner invoked as combine_op(aggregated, value).
+  */
+  template <typename Combiner>
+  void aggregate(std::size_t hash, Key && key, Value && value,
+                 Combiner & combine_op);
+
+  /**
+  \brief Number of different keys in the table.
+  */
+  std::size_t size() const noexcept { return count_; }
+
+  /**
+  \brief Checks if the table has no keys.
+  */
+  bool empty() const noexcept { return count_ == 0; }
+
+  /**
+  \brief Moves every entry out of the table, leaving it empty.
+  \param consume Callable invoked with the hash and the entry.
+  */
+  template <typename Consumer>
+  void drain(Consumer && consume);
+
+private:
+  struct slot {
+    std::size_t hash;
+    grppi::optional<value_type> entry;
+  };
+
+  void grow();
+
+private:
+  std::vector<slot> slots_;
+  std::size_t count_ = 0;
+  KeyEqual equal_{};
+};
+
+/**
+\brief Mixes the bits of a hash value.
+Standard library hashes of integers are usually the identity, which would
+make every key of a partition collide in the lower bits.
+*/
+inline std::size_t mix_hash(std::size_t hash) noexcept
+{
+  std::uint64_t h = hash;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return static_cast<std::size_t>(h);
+}
+
+/**
+\brief Applies a map/reduce by key with hash partitioned aggregation.
+
+Each chunk of the sequence is aggregated into one hash table per
+partition, with the partition selected by the upper bits of the hash. Then
+each partition is merged in parallel by combining the tables of every chunk
+in chunk order, so that values of a key are combined in sequence order.
+Finally, partitions are concatenated into a flat vector.
+
+Every chunk keeps its own tables, so that finer chunks balance the load
+better at the cost of more tables to merge.
+
+\tparam InputIterator Iterator type for the input sequence.
+\tparam KeyTransformer Callable type for extracting keys.
+\tparam ValueTransformer Callable type for extracting values.
+\tparam Combiner Callable type for combining values.
+\tparam ParallelFor Callable type for the parallel loop.
+\param first Iterator to the first element of the sequence.
+\param bounds Offsets of the chunk boundaries, starting by 0 and ending by
+the size of the sequence.
+\param key_op Callable returning the key of an element.
+\param value_op Callable returning the value of an element.
+\param combine_op Associative combination of values.
+\param nthreads Number of threads available to parallel_for.
+\param parallel_for Operation taking a number of iterations n and a
+callable, that invokes the callable for each index in [0,n).
+\return A vector with a pair for every key and its combined value.
+*/
+template <typename InputIterator, typename KeyTransformer,
+          typename ValueTransformer, typename Combiner,
+          typename ParallelFor>
+auto hash_map_reduce_by_key(InputIterator first,
+    std::vector<std::size_t> const & bounds,
+    KeyTransformer && key_op, ValueTransformer && value_op,
+    Combiner && combine_op,
+    std::size_t nthreads, ParallelFor && parallel_for)
+{
+  using key_type = std::decay_t<decltype(key_op(*first))>;
+  using mapped_type = std::decay_t<decltype(value_op(*first))>;
+  using table_type = hash_aggregation_table<key_type,mapped_type>;
+
+  const auto sequence_size = bounds.back();
+  const auto nchunks = bounds.size() - 1;
+  const auto nparts = std::max<std::size_t>(1,
+      std::min(nthreads, sequence_size));
+  auto partition = [nparts](std::size_t hash) {
+    return (hash >> (sizeof(std::size_t) * 4)) % nparts;
+  };
+
+  // Table for partition p of chunk c is tables[c*nparts + p]
+  std::vector<table_type> tables(nchunks * nparts);
+  parallel_for(nchunks, [&](std::size_t c) {
+    std::hash<key_type> hasher;
+    auto it = std::next(first, bounds[c]);
+    for (auto i=bounds[c]; i!=bounds[c+1]; ++i, ++it) {
+      key_type key = key_op(*it);
+      mapped_type value = value_op(*it);
+      const auto hash = mix_hash(hasher(key));
+      tables[c*nparts + partition(hash)].aggregate(hash, std::move(key),
+          std::move(value), combine_op);
+    }
+  });
+
+  parallel_for(nparts, [&](std::size_t p) {
+    auto & target = tables[p];
+    for (std::size_t c=1; c<nchunks; ++c) {
+      tables[c*nparts + p].drain([&](std::size_t hash, auto && entry) {
+        target.aggregate(hash, std::move(entry.first),
+            std::move(entry.second), combine_op);
+      });
+    }
+  });
+
+  std::vector<std::pair<key_type,mapped_type>> result;
+  std::size_t total = 0;
+  for (std::size_t p=0; p<nparts; ++p) { total += tables[p].size(); }
+  result.reserve(total);
+  for (std::size_t p=0; p<nparts; ++p) {
+    tables[p].drain([&](std::size_t, auto && entry) {
+      result.push_back(std::move(entry));
+    });
+  }
+  return result;
+}
+
+/**
+\brief Applies a map/reduce by key with hash partitioned aggregation,
+splitting the sequence in one chunk per thread.
+\param first Iterator to the first element of the sequence.
+\param sequence_size Size of the sequence.
+\param key_op Callable returning the key of an element.
+\param value_op Callable returning the value of an element.
+\param combine_op Associative combination of values.
+\param nthreads Number of threads available to parallel_for.
+\param parallel_for Operation taking a number of iterations n and a
+callable, that invokes the callable for each index in [0,n).
+\return A vector with a pair for every key and its combined value.
+*/
+template <typename InputIterator, typename KeyTransformer,
+          typename ValueTransformer, typename Combiner,
+          typename ParallelFor>
+auto hash_map_reduce_by_key(InputIterator first, std::size_t sequence_size,
+    KeyTransformer && key_op, ValueTransformer && value_op,
+    Combiner && combine_op,
+    std::size_t nthreads, ParallelFor && parallel_for)
+{
+  const auto nchunks = std::max<std::size_t>(1,
+      std::min(nthreads, sequence_size));
+  std::vector<std::size_t> bounds{0};
+  for (std::size_t c=1; c<=nchunks; ++c) {
+    bounds.push_back(sequence_size * c / nchunks);
+  }
+  return hash_map_reduce_by_key(first, bounds,
+      std::forward<KeyTransformer>(key_op),
+      std::forward<ValueTransformer>(value_op),
+      std::forward<Combiner>(combine_op),
+      nthreads, std::forward<ParallelFor>(parallel_for));
+}
+
+template <typename Key, typename Value, typename KeyEqual>
+hash_aggregation_table<Key,Value,KeyEqual>::hash_aggregation_table(
+    std::size_t capacity) :
+  slots_{}
+{
+  std::size_t c = 1;
+  while (c < capacity) { c <<= 1; }
+  slots_.resize(c);
+}
+
+template <typename Key, typename Value, typename KeyEqual>
+template <typename Combiner>
+void hash_aggregation_table<Key,Value,KeyEqual>::aggregate(
+    std::size_t hash, Key && key, Value && value, Combiner & combine_op)
+{
+  // Keep load factor below one half
+  if (2 * (count_ + 1) > slots_.size()) { grow(); }
+  const auto mask = slots_.size() - 1;
+  for (auto i = hash & mask; ; i = (i+1) & mask) {
+    auto & s = slots_[i];
+    if (!s.entry) {
+      s.hash = hash;
+      s.entry.emplace(std::move(key), std::move(value));
+      count_++;
+      return;
+    }
+    if (s.hash == hash && equal_(s.entry->first, key)) {
+      s.entry->second = combine_op(s.entry->second, value);
+      return;
+    }
+  }
+}
+
+template <typename Key, typename Value, typename KeyEqual>
+template <typename Consumer>
+void hash_aggregation_table<Key,Value,KeyEqual>::drain(Consumer && consume)
+{
+  for (auto & s : slots_) {
+    if (s.entry) {
+      consume(s.hash, std::move(*s.entry));
+      s.entry = grppi::optional<value_type>{};
+    }
+  }
+  count_ = 0;
+}
+
+template <typename Key, typename Value, typename KeyEqual>
+void hash_aggregation_table<Key,Value,KeyEqual>::grow()
+{
+  std::vector<slot> slots(slots_.size() * 2);
+  const auto mask = slots.size() - 1;
+  for (auto & s : slots_) {
+    if (!s.entry) continue;
+    auto i = s.hash & mask;
+    while (slots[i].entry) { i = (i+1) & mask; }
+    slots[i].hash = s.hash;
+    slots[i].entry.emplace(std::move(*s.entry));
+  }
+  slots_.swap(slots);
+}
+
+}
+
+#endif
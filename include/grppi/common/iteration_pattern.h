@@ -46,6 +46,13 @@ public:
     return predicate_(std::forward<Item>(item));
   }
 
+  /**
+  \brief Return the transformer function stored in the iteration pattern.
+  */
+  Transformer & transformer() {
+    return transform_;
+  }
+
   /**
   \brief Applies the transformation over a data item.
   */
@@ -0,0 +1,280 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_KEYED_REDUCE_PATTERN_H
+#define GRPPI_COMMON_KEYED_REDUCE_PATTERN_H
+
+#include "hash_aggregation.h"
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include <iterator>
+#include <utility>
+
+namespace grppi {
+
+/**
+\brief Count based windows of a stream, kept separately for every key.
+Windows follow the same rules as reduce_t, but each key has its own window.
+\tparam Key Type of the keys.
+\tparam Item Type of the stream items.
+\tparam Identity Type of the identity value and of the window results.
+\tparam Combiner Callable type combining a result with an item.
+*/
+template <typename Key, typename Item, typename Identity, typename Combiner>
+class keyed_windows {
+public:
+
+  /**
+  \brief Constructs the windows with no keys.
+  \param wsize Window size.
+  \param offset Offset between window starts.
+  \param identity Identity value.
+  \param combine_op Combiner used for the reduction of a window.
+  */
+  keyed_windows(int wsize, int offset, Identity identity,
+                Combiner combine_op) :
+    window_size_{wsize}, offset_{offset},
+    identity_{std::move(identity)}, combiner_{std::move(combine_op)}
+  {}
+
+  /**
+  \brief Adds an item to the window of its key.
+  If the window is complete, it is reduced and slid.
+  \param key Key of the item.
+  \param item Item to be added.
+  \param emit_op Callable invoked with the key and the result of the
+  window, if the window was reduced.
+  */
+  template <typename Emitter>
+  void add_item(Key && key, Item && item, Emitter && emit_op);
+
+  /**
+  \brief Number of keys with a window.
+  */
+  std::size_t size() const noexcept { return windows_.size(); }
+
+private:
+  struct window {
+    std::vector<Item> items{};
+    int remaining = 0;
+  };
+
+  int window_size_;
+  int offset_;
+  Identity identity_;
+  Combiner combiner_;
+  std::unordered_map<Key, window> windows_{};
+};
+
+/**
+\brief Representation of a reduce by key pattern.
+Represents a reduction of windows of the items with the same key, that
+can be used as a stage on a pipeline. The window state of every key is
+owned by one of several replicas, selected by the hash of the key.
+\tparam KeyExtractor Callable type returning the key of an item.
+\tparam Combiner Callable type for the combine operation used in the reduction.
+\tparam Identity Identity value for the combiner.
+*/
+template <typename KeyExtractor, typename Combiner, typename Identity>
+class reduce_by_key_t {
+public:
+
+  /**
+  \brief Construct a reduce by key pattern object.
+  \param replicas Number of replicas sharing the keys.
+  \param wsize Window size.
+  \param offset Offset between window starts.
+  \param key_op Key extractor.
+  \param id Identity value.
+  \param combine_op Combiner used for the reduction.
+  */
+  reduce_by_key_t(int replicas, int wsize, int offset,
+                  KeyExtractor && key_op, Identity id,
+                  Combiner && combine_op) :
+    replicas_{replicas < 1 ? 1 : replicas},
+    window_size_{wsize}, offset_{offset},
+    key_extractor_{std::forward<KeyExtractor>(key_op)},
+    identity_{id}, combiner_{std::forward<Combiner>(combine_op)}
+  {}
+
+  /**
+  \brief Type of the keys of items of type Item.
+  */
+  template <typename Item>
+  using key_type = std::decay_t<
+      typename std::result_of<KeyExtractor(const Item &)>::type>;
+
+  /**
+  \brief Type of the results for items of type Item.
+  */
+  template <typename Item>
+  using result_type = std::pair<key_type<Item>, std::decay_t<Identity>>;
+
+  /**
+  \brief Get the number of replicas.
+  */
+  int replicas() const noexcept { return replicas_; }
+
+  /**
+  \brief Get the key of an item.
+  */
+  template <typename Item>
+  auto key(const Item & item) const { return key_extractor_(item); }
+
+  /**
+  \brief Get the replica owning a key.
+  */
+  template <typename Key>
+  int replica(const Key & k) const {
+    return static_cast<int>(mix_hash(std::hash<Key>{}(k)) % replicas_);
+  }
+
+  /**
+  \brief Makes an empty window state for items of type Item.
+  */
+  template <typename Item>
+  auto make_windows() const {
+    return keyed_windows<key_type<Item>, Item, std::decay_t<Identity>,
+        std::decay_t<Combiner>>{window_size_, offset_, identity_, combiner_};
+  }
+
+private:
+  int replicas_;
+  int window_size_;
+  int offset_;
+  std::decay_t<KeyExtractor> key_extractor_;
+  Identity identity_;
+  std::decay_t<Combiner> combiner_;
+};
+
+/**
+\brief Reduce by key stage of a single stream.
+Owns the windows of a reduce by key pattern along one pipeline execution,
+so that the pattern object keeps no state. As the type of the windows
+depends on the type of the items, they are made with the first item.
+\tparam KeyedReduce Type of the reduce by key pattern.
+*/
+template <typename KeyedReduce>
+class keyed_reduce_stream {
+public:
+
+  /**
+  \brief Constructs the stage with no windows.
+  \param reduce_obj Reduce by key pattern, that must outlive the stage.
+  */
+  explicit keyed_reduce_stream(KeyedReduce & reduce_obj) noexcept :
+    reduce_{reduce_obj}
+  {}
+
+  /**
+  \brief Adds an item to the window of its key.
+  \param item Item to be added.
+  \param emit_op Callable invoked with the key and the result of the
+  window, if the window was reduced.
+  */
+  template <typename Item, typename Emitter>
+  void add_item(Item && item, Emitter && emit_op);
+
+private:
+  KeyedReduce & reduce_;
+  std::shared_ptr<void> windows_{};
+};
+
+template <typename Key, typename Item, typename Identity, typename Combiner>
+template <typename Emitter>
+void keyed_windows<Key,Item,Identity,Combiner>::add_item(
+    Key && key, Item && item, Emitter && emit_op)
+{
+  auto it = windows_.find(key);
+  if (it == windows_.end()) {
+    it = windows_.emplace(std::move(key), window{}).first;
+  }
+  auto & w = it->second;
+  if (w.remaining > 0) {
+    w.remaining--;
+    return;
+  }
+  w.items.push_back(std::move(item));
+  if (static_cast<int>(w.items.size()) < window_size_) return;
+
+  Identity result{identity_};
+  for (auto & x : w.items) {
+    result = combiner_(result, x);
+  }
+  if (offset_ > window_size_) {
+    w.remaining = offset_ - window_size_;
+    w.items.clear();
+  }
+  else {
+    w.items.erase(w.items.begin(), std::next(w.items.begin(), offset_));
+  }
+  emit_op(it->first, std::move(result));
+}
+
+template <typename KeyedReduce>
+template <typename Item, typename Emitter>
+void keyed_reduce_stream<KeyedReduce>::add_item(
+    Item && item, Emitter && emit_op)
+{
+  using item_type = std::decay_t<Item>;
+  using windows_type =
+      decltype(reduce_.template make_windows<item_type>());
+  if (!windows_) {
+    windows_ = std::make_shared<windows_type>(
+        reduce_.template make_windows<item_type>());
+  }
+  auto key = reduce_.key(item);
+  std::static_pointer_cast<windows_type>(windows_)->add_item(
+      std::move(key), item_type{std::forward<Item>(item)},
+      std::forward<Emitter>(emit_op));
+}
+
+namespace internal {
+
+template<typename T>
+struct is_reduce_by_key : std::false_type {};
+
+template <typename K, typename C, typename I>
+struct is_reduce_by_key<reduce_by_key_t<K,C,I>> :std::true_type {};
+
+template<typename T>
+struct is_keyed_reduce_stream : std::false_type {};
+
+template <typename R>
+struct is_keyed_reduce_stream<keyed_reduce_stream<R>> :std::true_type {};
+
+}
+
+template <typename T>
+constexpr bool is_reduce_by_key = internal::is_reduce_by_key<std::decay_t<T>>();
+
+template <typename T>
+using requires_reduce_by_key = std::enable_if_t<is_reduce_by_key<T>,int>;
+
+template <typename T>
+constexpr bool is_keyed_reduce_stream =
+    internal::is_keyed_reduce_stream<std::decay_t<T>>();
+
+template <typename T>
+using requires_keyed_reduce_stream =
+    std::enable_if_t<is_keyed_reduce_stream<T>,int>;
+
+} // end namespace grppi
+
+#endif
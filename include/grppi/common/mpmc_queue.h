@@ -17,11 +17,20 @@
 #define GRPPI_COMMON_MPMC_QUEUE_H
 
 
+#include <algorithm>
+#include <iterator>
 #include <memory>
+#include <type_traits>
 #include <atomic>
+#include <chrono>
 #include <mutex>
+#include <vector>
 #include <condition_variable>
 
+#include "wait_policy.h"
+#include "queue_statistics.h"
+#include "reorder_buffer.h"
+
 namespace grppi{
 
 /**
@@ -32,9 +41,17 @@ namespace grppi{
 
 /**
 \brief A lock-free multiple producer multiple consumer queue.
+
+Producers and consumers reserve positions with a ticket, but publish them in
+ticket order. Thus, an operation that got a position still waits for every
+operation with an earlier ticket to complete. This includes the non-blocking
+and timed operations: they do not wait for room or for elements, but may
+wait for a preempted producer or consumer with an earlier ticket. Use
+sequenced_mpmc_queue when such operations must never wait.
 \tparam T Element type for the queue.
+\tparam Wait Wait policy used when the queue is not ready.
 */
-template <typename T>
+template <typename T, typename Wait = spin_wait>
 class atomic_mpmc_queue {
 public:
 
@@ -76,27 +93,159 @@ public:
     return pread_.load() == pwrite_.load();
   }
 
+  /**
+  \brief Checks if the queue is full.
+  \return true if the queue is full, false otherwise.
+  */
+  bool full () const noexcept {
+    return internal_pwrite_.load() >= pread_.load() + size_;
+  }
+
   /**
   \brief Pops an item from the queue.
   \return The value that has been extracted from the queue.
-  \note This call may block by busy waiting if the queue is empty.
+  \note This call may block using the wait policy if the queue is empty.
   */
   T pop () noexcept(std::is_nothrow_move_constructible<T>::value);
 
   /**
   \brief Pushes an element in the queue by move.
   \param item Value to be moved into the queue.
-  \note This call may block by busy waiting if the queue is full.
+  \note This call may block using the wait policy if the queue is full.
   */
   void push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value);
 
   /**
   \brief Pushes an element in the queue by copy.
   \param item Value to be copied into the queue.
-  \note This call may block by busy waiting if the queue is full.
+  \note This call may block using the wait policy if the queue is full.
   */
   void push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value);
 
+  /**
+  \brief Pushes the elements of a range in the queue by move.
+  \param first Iterator to the first element to be pushed.
+  \param last Iterator to one past the last element to be pushed.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  template <typename InputIt>
+  void push_n (InputIt first, InputIt last)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pops a block of consecutive items from the queue.
+  Waits until at least one item is available and then extracts as many
+  available items as possible up to a maximum.
+  \param out Iterator where the extracted items are moved.
+  \param max Maximum number of items to be extracted.
+  \return The number of extracted items.
+  \pre max > 0
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  template <typename OutputIt>
+  std::size_t pop_n (OutputIt out, std::size_t max)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element by filling its slot in place.
+  \param fill Callable invoked as fill(slot) to store the element directly in
+  the slot reserved for it. The slot is published when fill returns.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  template <typename Fill>
+  void push_with (Fill && fill);
+
+  /**
+  \brief Pops an element by using it in place.
+  \param use Callable invoked as use(slot) on the front element. The slot is
+  released when use returns.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  template <typename Use>
+  void pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element by filling its slot in place without
+  blocking.
+  \param fill Callable invoked as fill(slot) if a slot can be reserved.
+  \return true if a slot was filled and published, false otherwise.
+  */
+  template <typename Fill>
+  bool try_push_with (Fill && fill);
+
+  /**
+  \brief Tries to pop an element by using it in place without blocking.
+  \param use Callable invoked as use(slot) if an element is available.
+  \return true if an element was used and released, false otherwise.
+  */
+  template <typename Use>
+  bool try_pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element in the queue by move without blocking.
+  \param item Value to be moved into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  \note item is only moved from when the element is pushed.
+  */
+  bool try_push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Tries to push an element in the queue by copy without blocking.
+  \param item Value to be copied into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  */
+  bool try_push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value);
+
+  /**
+  \brief Tries to pop an item from the queue without blocking.
+  \param item Variable where the extracted value is moved.
+  \return true if an item was popped, false if the queue was empty.
+  */
+  bool try_pop (T & item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most until a
+  deadline.
+  \param item Value to be moved into the queue.
+  \param deadline Time point after which the push is abandoned.
+  \return true if the element was pushed, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool push_until (T && item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pops an item from the queue waiting at most until a deadline.
+  \param item Variable where the extracted value is moved.
+  \param deadline Time point after which the pop is abandoned.
+  \return true if an item was popped, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool pop_until (T & item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most a timeout.
+  \param item Value to be moved into the queue.
+  \param timeout Maximum time to wait.
+  \return true if the element was pushed, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool push_for (T && item, std::chrono::duration<Rep,Period> const & timeout) {
+    return push_until(std::move(item), std::chrono::steady_clock::now() + timeout);
+  }
+
+  /**
+  \brief Pops an item from the queue waiting at most a timeout.
+  \param item Variable where the extracted value is moved.
+  \param timeout Maximum time to wait.
+  \return true if an item was popped, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool pop_for (T & item, std::chrono::duration<Rep,Period> const & timeout) {
+    return pop_until(item, std::chrono::steady_clock::now() + timeout);
+  }
+
 private:
   /// Maximum number of elements in the queue.
   int size_;
@@ -116,10 +265,16 @@ private:
 
   /// Internal index to next position to write.
   std::atomic<unsigned long long> internal_pwrite_{0};
+
+  /// Wait policy for threads waiting on pwrite_.
+  Wait not_empty_{};
+
+  /// Wait policy for threads waiting on pread_.
+  Wait not_full_{};
 };
 
-template <typename T>
-T atomic_mpmc_queue<T>::pop() noexcept(std::is_nothrow_move_constructible<T>::value) 
+template <typename T, typename Wait>
+T atomic_mpmc_queue<T,Wait>::pop() noexcept(std::is_nothrow_move_constructible<T>::value) 
 {
   unsigned long long current;
   do {
@@ -127,58 +282,200 @@ T atomic_mpmc_queue<T>::pop() noexcept(std::is_nothrow_move_constructible<T>::va
   } 
   while (!internal_pread_.compare_exchange_weak(current, current+1));
           
-  while (current >= pwrite_.load()) {}
+  not_empty_.wait_until([&] { return current < pwrite_.load(); });
 
   auto item = std::move(buffer_[current%size_]); 
-  auto aux = current;
-  do {
-    current = aux;
-  } 
-  while (!pread_.compare_exchange_weak(current, current+1));
+
+  not_full_.wait_until([&] { return pread_.load() == current; });
+  pread_.store(current+1);
+  not_full_.notify();
      
   return item;
 }
 
-template <typename T>
-void atomic_mpmc_queue<T>::push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value) {
+template <typename T, typename Wait>
+void atomic_mpmc_queue<T,Wait>::push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value) {
+  push_with([&](T & slot) { slot = std::move(item); });
+}
+
+template <typename T, typename Wait>
+void atomic_mpmc_queue<T,Wait>::push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value) {
+  push_with([&](T & slot) { slot = item; });
+}
+
+template <typename T, typename Wait>
+template <typename Fill>
+void atomic_mpmc_queue<T,Wait>::push_with(Fill && fill)
+{
   unsigned long long current;
   do {
     current = internal_pwrite_.load();
   } 
   while (!internal_pwrite_.compare_exchange_weak(current, current+1));
 
-  while (current >= (pread_.load()+size_)) {}
+  not_full_.wait_until([&] { return current < pread_.load()+size_; });
 
-  buffer_[current%size_] = std::move(item);
+  fill(buffer_[current%size_]);
   
-  auto aux = current;
-  do {
-    current = aux;
-  } 
-  while (!pwrite_.compare_exchange_weak(current, current+1));
+  not_empty_.wait_until([&] { return pwrite_.load() == current; });
+  pwrite_.store(current+1);
+  not_empty_.notify();
 }
 
-template <typename T>
-void atomic_mpmc_queue<T>::push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value) {
+template <typename T, typename Wait>
+template <typename Use>
+void atomic_mpmc_queue<T,Wait>::pop_with(Use && use)
+{
   unsigned long long current;
   do {
-    current = internal_pwrite_.load();
+    current = internal_pread_.load();
   } 
+  while (!internal_pread_.compare_exchange_weak(current, current+1));
+          
+  not_empty_.wait_until([&] { return current < pwrite_.load(); });
+
+  use(buffer_[current%size_]);
+
+  not_full_.wait_until([&] { return pread_.load() == current; });
+  pread_.store(current+1);
+  not_full_.notify();
+}
+
+template <typename T, typename Wait>
+template <typename Fill>
+bool atomic_mpmc_queue<T,Wait>::try_push_with(Fill && fill)
+{
+  auto current = internal_pwrite_.load();
+  do {
+    if (current >= pread_.load()+size_) return false;
+  }
   while (!internal_pwrite_.compare_exchange_weak(current, current+1));
 
-  while (current >= (pread_.load()+size_)) {}
+  fill(buffer_[current%size_]);
 
-  buffer_[current%size_] = item;
-  
-  auto aux = current;
+  not_empty_.wait_until([&] { return pwrite_.load() == current; });
+  pwrite_.store(current+1);
+  not_empty_.notify();
+  return true;
+}
+
+template <typename T, typename Wait>
+template <typename Use>
+bool atomic_mpmc_queue<T,Wait>::try_pop_with(Use && use)
+{
+  auto current = internal_pread_.load();
   do {
-    current = aux;
-  } 
-  while (!pwrite_.compare_exchange_weak(current, current+1));
+    if (current >= pwrite_.load()) return false;
+  }
+  while (!internal_pread_.compare_exchange_weak(current, current+1));
+
+  use(buffer_[current%size_]);
+
+  not_full_.wait_until([&] { return pread_.load() == current; });
+  pread_.store(current+1);
+  not_full_.notify();
+  return true;
+}
+
+template <typename T, typename Wait>
+bool atomic_mpmc_queue<T,Wait>::try_push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = std::move(item); });
+}
+
+template <typename T, typename Wait>
+bool atomic_mpmc_queue<T,Wait>::try_push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = item; });
+}
+
+template <typename T, typename Wait>
+bool atomic_mpmc_queue<T,Wait>::try_pop(T & item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_pop_with([&](T & slot) { item = std::move(slot); });
+}
+
+template <typename T, typename Wait>
+template <typename Clock, typename Duration>
+bool atomic_mpmc_queue<T,Wait>::push_until(T && item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  for (;;) {
+    if (try_push(std::move(item))) return true;
+    if (!not_full_.wait_until([&] { return internal_pwrite_.load() < pread_.load()+size_; }, deadline)) return false;
+  }
+}
+
+template <typename T, typename Wait>
+template <typename Clock, typename Duration>
+bool atomic_mpmc_queue<T,Wait>::pop_until(T & item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  for (;;) {
+    if (try_pop(item)) return true;
+    if (!not_empty_.wait_until([&] { return internal_pread_.load() < pwrite_.load(); }, deadline)) return false;
+  }
+}
+
+template <typename T, typename Wait>
+template <typename InputIt>
+void atomic_mpmc_queue<T,Wait>::push_n(InputIt first, InputIt last)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  while (first != last) {
+    // Blocks larger than the queue could never be committed.
+    auto n = static_cast<unsigned long long>(
+        std::min<std::ptrdiff_t>(std::distance(first, last), size_));
+    unsigned long long current;
+    do {
+      current = internal_pwrite_.load();
+    }
+    while (!internal_pwrite_.compare_exchange_weak(current, current+n));
+
+    for (unsigned long long i=current; i<current+n; ++i, ++first) {
+      not_full_.wait_until([&] { return i < pread_.load()+size_; });
+      buffer_[i%size_] = std::move(*first);
+    }
+
+    not_empty_.wait_until([&] { return pwrite_.load() == current; });
+    pwrite_.store(current+n);
+    not_empty_.notify();
+  }
+}
+
+template <typename T, typename Wait>
+template <typename OutputIt>
+std::size_t atomic_mpmc_queue<T,Wait>::pop_n(OutputIt out, std::size_t max)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  unsigned long long current;
+  unsigned long long n;
+  do {
+    current = internal_pread_.load();
+    auto written = pwrite_.load();
+    n = (written > current) ?
+        std::min<unsigned long long>(written - current, max) : 1;
+  }
+  while (!internal_pread_.compare_exchange_weak(current, current+n));
+
+  not_empty_.wait_until([&] { return current+n <= pwrite_.load(); });
+
+  for (unsigned long long i=current; i<current+n; ++i, ++out) {
+    *out = std::move(buffer_[i%size_]);
+  }
+
+  not_full_.wait_until([&] { return pread_.load() == current; });
+  pread_.store(current+n);
+  not_full_.notify();
+
+  return n;
 }
 
 /**
 \brief A lock-based multiple producer multiple consumer queue.
+Waiting threads are counted, so that condition variables are only signaled
+when some thread waits on them. Block operations wake as many waiting threads
+as items they transfer.
 \tparam T Element type for the queue.
 */
 template <typename T>
@@ -223,6 +520,14 @@ public:
     return pread_== pwrite_;
   }
 
+  /**
+  \brief Checks if the queue is full.
+  \return true if the queue is full, false otherwise.
+  */
+  bool full () const noexcept {
+    return pwrite_ >= pread_ + size_;
+  }
+
   /**
   \brief Pops an item from the queue.
   \return The value that has been extracted from the queue.
@@ -244,7 +549,153 @@ public:
   */
   void push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value);
 
+  /**
+  \brief Pushes the elements of a range in the queue by move.
+  \param first Iterator to the first element to be pushed.
+  \param last Iterator to one past the last element to be pushed.
+  \note This call may block through a mutex if the queue is full.
+  */
+  template <typename InputIt>
+  void push_n (InputIt first, InputIt last)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pops a block of consecutive items from the queue.
+  Waits until at least one item is available and then extracts as many
+  available items as possible up to a maximum.
+  \param out Iterator where the extracted items are moved.
+  \param max Maximum number of items to be extracted.
+  \return The number of extracted items.
+  \pre max > 0
+  \note This call may block through a mutex if the queue is empty.
+  */
+  template <typename OutputIt>
+  std::size_t pop_n (OutputIt out, std::size_t max)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element by filling its slot in place.
+  \param fill Callable invoked as fill(slot) to store the element directly in
+  the slot reserved for it. The slot is published when fill returns.
+  \note This call may block through a mutex if the queue is full.
+  */
+  template <typename Fill>
+  void push_with (Fill && fill);
+
+  /**
+  \brief Pops an element by using it in place.
+  \param use Callable invoked as use(slot) on the front element. The slot is
+  released when use returns.
+  \note This call may block through a mutex if the queue is empty.
+  */
+  template <typename Use>
+  void pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element by filling its slot in place without
+  blocking.
+  \param fill Callable invoked as fill(slot) if a slot can be reserved.
+  \return true if a slot was filled and published, false otherwise.
+  */
+  template <typename Fill>
+  bool try_push_with (Fill && fill);
+
+  /**
+  \brief Tries to pop an element by using it in place without blocking.
+  \param use Callable invoked as use(slot) if an element is available.
+  \return true if an element was used and released, false otherwise.
+  */
+  template <typename Use>
+  bool try_pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element in the queue by move without blocking.
+  \param item Value to be moved into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  \note item is only moved from when the element is pushed.
+  */
+  bool try_push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Tries to push an element in the queue by copy without blocking.
+  \param item Value to be copied into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  */
+  bool try_push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value);
+
+  /**
+  \brief Tries to pop an item from the queue without blocking.
+  \param item Variable where the extracted value is moved.
+  \return true if an item was popped, false if the queue was empty.
+  */
+  bool try_pop (T & item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most until a
+  deadline.
+  \param item Value to be moved into the queue.
+  \param deadline Time point after which the push is abandoned.
+  \return true if the element was pushed, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool push_until (T && item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pops an item from the queue waiting at most until a deadline.
+  \param item Variable where the extracted value is moved.
+  \param deadline Time point after which the pop is abandoned.
+  \return true if an item was popped, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool pop_until (T & item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most a timeout.
+  \param item Value to be moved into the queue.
+  \param timeout Maximum time to wait.
+  \return true if the element was pushed, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool push_for (T && item, std::chrono::duration<Rep,Period> const & timeout) {
+    return push_until(std::move(item), std::chrono::steady_clock::now() + timeout);
+  }
+
+  /**
+  \brief Pops an item from the queue waiting at most a timeout.
+  \param item Variable where the extracted value is moved.
+  \param timeout Maximum time to wait.
+  \return true if an item was popped, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool pop_for (T & item, std::chrono::duration<Rep,Period> const & timeout) {
+    return pop_until(item, std::chrono::steady_clock::now() + timeout);
+  }
+
 private:
+
+  /**
+  \brief Waits until the queue is not empty.
+  \param lk Lock on mut_.
+  */
+  void wait_not_empty(std::unique_lock<std::mutex> & lk);
+
+  /**
+  \brief Waits until the queue is not full.
+  \param lk Lock on mut_.
+  */
+  void wait_not_full(std::unique_lock<std::mutex> & lk);
+
+  /**
+  \brief Wakes up to a number of threads waiting on a condition variable.
+  \param cv Condition variable to be signaled.
+  \param waiters Number of threads registered as waiting on cv.
+  \param n Number of threads that may proceed.
+  \note Called without holding mut_.
+  */
+  static void wake(std::condition_variable & cv, int waiters, std::size_t n);
+
   /// Maximum number of elements in the queue.
   int size_;
 
@@ -265,77 +716,2210 @@ private:
 
   /// Condition variable to signal full queue.
   std::condition_variable full_{};
+
+  /// Number of consumers waiting on empty_. Protected by mut_.
+  int empty_waiters_ = 0;
+
+  /// Number of producers waiting on full_. Protected by mut_.
+  int full_waiters_ = 0;
 };
 
+template <typename T>
+void locked_mpmc_queue<T>::wait_not_empty(std::unique_lock<std::mutex> & lk)
+{
+  while (pread_ >= pwrite_) {
+    empty_waiters_++;
+    empty_.wait(lk);
+    empty_waiters_--;
+  }
+}
+
+template <typename T>
+void locked_mpmc_queue<T>::wait_not_full(std::unique_lock<std::mutex> & lk)
+{
+  while (pwrite_ >= (pread_ + size_)) {
+    full_waiters_++;
+    full_.wait(lk);
+    full_waiters_--;
+  }
+}
+
+template <typename T>
+void locked_mpmc_queue<T>::wake(std::condition_variable & cv, int waiters,
+    std::size_t n)
+{
+  if (waiters == 0) return;
+  if (n >= static_cast<std::size_t>(waiters)) {
+    cv.notify_all();
+    return;
+  }
+  for (std::size_t i=0; i<n; ++i) {
+    cv.notify_one();
+  }
+}
+
 template <typename T>
 T locked_mpmc_queue<T>::pop() noexcept(std::is_nothrow_move_constructible<T>::value) 
 {
   std::unique_lock<std::mutex> lk(mut_);
-  empty_.wait(lk, [this] {return pread_ < pwrite_; });
+  wait_not_empty(lk);
   auto item = std::move(buffer_[pread_%size_]);
   pread_++;
+  auto waiters = full_waiters_;
   lk.unlock();
-  full_.notify_one();
+  wake(full_, waiters, 1);
   return item;
 }
 
 template <typename T>
 void locked_mpmc_queue<T>::push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value) 
 {
+  push_with([&](T & slot) { slot = std::move(item); });
+}
+
+template <typename T>
+void locked_mpmc_queue<T>::push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value) 
+{
+  push_with([&](T & slot) { slot = item; });
+}
+
+template <typename T>
+template <typename Fill>
+void locked_mpmc_queue<T>::push_with(Fill && fill)
+{
+  int waiters;
   {
     std::unique_lock<std::mutex> lk(mut_);
-    full_.wait(lk, [this] { return pwrite_ < (pread_ + size_); });
-    buffer_[pwrite_%size_] = std::move(item);
+    wait_not_full(lk);
+    fill(buffer_[pwrite_%size_]);
     pwrite_++;
+    waiters = empty_waiters_;
   }
-  empty_.notify_one();
+  wake(empty_, waiters, 1);
 }
 
 template <typename T>
-void locked_mpmc_queue<T>::push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value) 
+template <typename Use>
+void locked_mpmc_queue<T>::pop_with(Use && use)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    wait_not_empty(lk);
+    use(buffer_[pread_%size_]);
+    pread_++;
+    waiters = full_waiters_;
+  }
+  wake(full_, waiters, 1);
+}
+
+template <typename T>
+template <typename Fill>
+bool locked_mpmc_queue<T>::try_push_with(Fill && fill)
 {
+  int waiters;
   {
     std::unique_lock<std::mutex> lk(mut_);
-    full_.wait(lk, [this] { return pwrite_ < (pread_ + size_); });
-    buffer_[pwrite_%size_] = item;
+    if (pwrite_ >= (pread_ + size_)) return false;
+    fill(buffer_[pwrite_%size_]);
     pwrite_++;
+    waiters = empty_waiters_;
   }
-  empty_.notify_one();
+  wake(empty_, waiters, 1);
+  return true;
 }
 
-/**
-\brief Synchronization mode for queues.
-*/
-enum class queue_mode {
-  /// Lock-free synchronization using atomics.
-  lockfree, 
-  /// Mutex based synchronization.
-  blocking 
-};
+template <typename T>
+template <typename Use>
+bool locked_mpmc_queue<T>::try_pop_with(Use && use)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    if (pread_ >= pwrite_) return false;
+    use(buffer_[pread_%size_]);
+    pread_++;
+    waiters = full_waiters_;
+  }
+  wake(full_, waiters, 1);
+  return true;
+}
 
-/**
-\brief A multiple producer multiple consumer queue.
-\tparam T Element type for the queue.
-The mpmc_queue may be constructed providing a synchronization mode 
-(lockfree or blocking).
-*/
 template <typename T>
-class mpmc_queue{
-public:
-  using value_type = T;
+bool locked_mpmc_queue<T>::try_push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = std::move(item); });
+}
 
-  /**
-  \brief Constructs a queue with a given size and a synchronization mode.
-  \param size Size of the queue.
-  \param mode Synchronization mode.
-  */
-  mpmc_queue(int size, queue_mode mode); 
+template <typename T>
+bool locked_mpmc_queue<T>::try_push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = item; });
+}
 
-  /**
-  \brief Move constructs a queue from another one.
-  \param q The queue to move from.
-  */
-  mpmc_queue(mpmc_queue && q); 
+template <typename T>
+bool locked_mpmc_queue<T>::try_pop(T & item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_pop_with([&](T & slot) { item = std::move(slot); });
+}
+
+template <typename T>
+template <typename Clock, typename Duration>
+bool locked_mpmc_queue<T>::push_until(T && item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    while (pwrite_ >= (pread_ + size_)) {
+      full_waiters_++;
+      auto status = full_.wait_until(lk, deadline);
+      full_waiters_--;
+      if (status == std::cv_status::timeout &&
+          pwrite_ >= (pread_ + size_)) return false;
+    }
+    buffer_[pwrite_%size_] = std::move(item);
+    pwrite_++;
+    waiters = empty_waiters_;
+  }
+  wake(empty_, waiters, 1);
+  return true;
+}
+
+template <typename T>
+template <typename Clock, typename Duration>
+bool locked_mpmc_queue<T>::pop_until(T & item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    while (pread_ >= pwrite_) {
+      empty_waiters_++;
+      auto status = empty_.wait_until(lk, deadline);
+      empty_waiters_--;
+      if (status == std::cv_status::timeout && pread_ >= pwrite_) return false;
+    }
+    item = std::move(buffer_[pread_%size_]);
+    pread_++;
+    waiters = full_waiters_;
+  }
+  wake(full_, waiters, 1);
+  return true;
+}
+
+template <typename T>
+template <typename InputIt>
+void locked_mpmc_queue<T>::push_n(InputIt first, InputIt last)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  while (first != last) {
+    std::size_t n = 0;
+    int waiters;
+    {
+      std::unique_lock<std::mutex> lk(mut_);
+      wait_not_full(lk);
+      while (first != last && pwrite_ < (pread_ + size_)) {
+        buffer_[pwrite_%size_] = std::move(*first);
+        ++first;
+        pwrite_++;
+        n++;
+      }
+      waiters = empty_waiters_;
+    }
+    wake(empty_, waiters, n);
+  }
+}
+
+template <typename T>
+template <typename OutputIt>
+std::size_t locked_mpmc_queue<T>::pop_n(OutputIt out, std::size_t max)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  std::size_t n = 0;
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    wait_not_empty(lk);
+    while (n < max && pread_ < pwrite_) {
+      *out = std::move(buffer_[pread_%size_]);
+      ++out;
+      pread_++;
+      n++;
+    }
+    waiters = full_waiters_;
+  }
+  wake(full_, waiters, n);
+  return n;
+}
+
+/**
+\brief A lock-free multiple producer multiple consumer queue with per slot
+sequence numbers.
+Every slot of the ring buffer carries its own sequence counter, which tells
+whether the slot is ready to be written or to be read for a given position.
+Producers and consumers only synchronize through the slot they have claimed, so
+a delayed thread only stalls the slot it owns instead of every later operation.
+\tparam T Element type for the queue.
+\tparam Wait Wait policy used when the queue is not ready.
+*/
+template <typename T, typename Wait = spin_wait>
+class sequenced_mpmc_queue {
+public:
+
+  /// Type alias for element type.
+  using value_type = T;
+
+  /**
+  \brief Constructs a sequenced queue with a given size.
+  \param size Size of the queue.
+  \note Sizes below 2 are rounded up to 2, as a slot released for the next
+  round must be distinguishable from a slot holding an element.
+  */
+  sequenced_mpmc_queue(int size);
+
+  /**
+  \brief Move constructs a sequenced queue from another one.
+  \param q The queue to move from.
+  */
+  sequenced_mpmc_queue(sequenced_mpmc_queue && q) noexcept :
+    size_{q.size_},
+    buffer_{std::move(q.buffer_)},
+    enqueue_pos_{q.enqueue_pos_.load()},
+    dequeue_pos_{q.dequeue_pos_.load()}
+  {}
+
+  sequenced_mpmc_queue & operator=(sequenced_mpmc_queue && q) noexcept = delete;
+
+  sequenced_mpmc_queue(sequenced_mpmc_queue const & q) noexcept = delete;
+  sequenced_mpmc_queue & operator=(sequenced_mpmc_queue const & q) noexcept = delete;
+
+  /**
+  \brief Checks if the queue is empty.
+  \return true if the queue is empty, false otherwise.
+  */
+  bool empty () const noexcept {
+    return dequeue_pos_.load() >= enqueue_pos_.load();
+  }
+
+  /**
+  \brief Checks if the queue is full.
+  \return true if the queue is full, false otherwise.
+  */
+  bool full () const noexcept {
+    return !writable(enqueue_pos_.load());
+  }
+
+  /**
+  \brief Pops an item from the queue.
+  \return The value that has been extracted from the queue.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  T pop () noexcept(std::is_nothrow_move_constructible<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by move.
+  \param item Value to be moved into the queue.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  void push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by copy.
+  \param item Value to be copied into the queue.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  void push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value);
+
+  /**
+  \brief Pushes the elements of a range in the queue by move.
+  \param first Iterator to the first element to be pushed.
+  \param last Iterator to one past the last element to be pushed.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  template <typename InputIt>
+  void push_n (InputIt first, InputIt last)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pops a block of consecutive items from the queue.
+  Waits until at least one item is available and then extracts as many
+  available items as possible up to a maximum.
+  \param out Iterator where the extracted items are moved.
+  \param max Maximum number of items to be extracted.
+  \return The number of extracted items.
+  \pre max > 0
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  template <typename OutputIt>
+  std::size_t pop_n (OutputIt out, std::size_t max)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element by filling its slot in place.
+  \param fill Callable invoked as fill(slot) to store the element directly in
+  the slot reserved for it. The slot is published when fill returns.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  template <typename Fill>
+  void push_with (Fill && fill);
+
+  /**
+  \brief Pops an element by using it in place.
+  \param use Callable invoked as use(slot) on the front element. The slot is
+  released when use returns.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  template <typename Use>
+  void pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element by filling its slot in place without
+  blocking.
+  \param fill Callable invoked as fill(slot) if a slot can be reserved.
+  \return true if a slot was filled and published, false otherwise.
+  */
+  template <typename Fill>
+  bool try_push_with (Fill && fill);
+
+  /**
+  \brief Tries to pop an element by using it in place without blocking.
+  \param use Callable invoked as use(slot) if an element is available.
+  \return true if an element was used and released, false otherwise.
+  */
+  template <typename Use>
+  bool try_pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element in the queue by move without blocking.
+  \param item Value to be moved into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  \note item is only moved from when the element is pushed.
+  */
+  bool try_push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Tries to push an element in the queue by copy without blocking.
+  \param item Value to be copied into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  */
+  bool try_push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value);
+
+  /**
+  \brief Tries to pop an item from the queue without blocking.
+  \param item Variable where the extracted value is moved.
+  \return true if an item was popped, false if the queue was empty.
+  */
+  bool try_pop (T & item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most until a
+  deadline.
+  \param item Value to be moved into the queue.
+  \param deadline Time point after which the push is abandoned.
+  \return true if the element was pushed, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool push_until (T && item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pops an item from the queue waiting at most until a deadline.
+  \param item Variable where the extracted value is moved.
+  \param deadline Time point after which the pop is abandoned.
+  \return true if an item was popped, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool pop_until (T & item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most a timeout.
+  \param item Value to be moved into the queue.
+  \param timeout Maximum time to wait.
+  \return true if the element was pushed, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool push_for (T && item, std::chrono::duration<Rep,Period> const & timeout) {
+    return push_until(std::move(item), std::chrono::steady_clock::now() + timeout);
+  }
+
+  /**
+  \brief Pops an item from the queue waiting at most a timeout.
+  \param item Variable where the extracted value is moved.
+  \param timeout Maximum time to wait.
+  \return true if an item was popped, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool pop_for (T & item, std::chrono::duration<Rep,Period> const & timeout) {
+    return pop_until(item, std::chrono::steady_clock::now() + timeout);
+  }
+
+private:
+
+  /**
+  \brief A slot of the ring buffer.
+  */
+  struct cell {
+    /// Sequence number for the position that may use the slot next.
+    std::atomic<unsigned long long> sequence;
+    /// Stored value.
+    T value;
+  };
+
+  /**
+  \brief Claims the slot for the next position to write.
+  \return The claimed position.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  unsigned long long claim_write() noexcept;
+
+  /**
+  \brief Claims the slot for the next position to read.
+  \return The claimed position.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  unsigned long long claim_read() noexcept;
+
+  /**
+  \brief Checks if the slot for a position is ready to be written.
+  */
+  bool writable(unsigned long long pos) const noexcept {
+    return buffer_[pos%size_].sequence.load(std::memory_order_acquire) >= pos;
+  }
+
+  /**
+  \brief Checks if the slot for a position is ready to be read.
+  */
+  bool readable(unsigned long long pos) const noexcept {
+    return buffer_[pos%size_].sequence.load(std::memory_order_acquire) >= pos+1;
+  }
+
+  /// Maximum number of elements in the queue.
+  int size_;
+
+  /// Buffer of slots.
+  std::unique_ptr<cell[]> buffer_;
+
+  /// Next position to be claimed by a producer.
+  std::atomic<unsigned long long> enqueue_pos_{0};
+
+  /// Next position to be claimed by a consumer.
+  std::atomic<unsigned long long> dequeue_pos_{0};
+
+  /// Wait policy for consumers waiting on an empty slot.
+  Wait not_empty_{};
+
+  /// Wait policy for producers waiting on a full slot.
+  Wait not_full_{};
+};
+
+template <typename T, typename Wait>
+sequenced_mpmc_queue<T,Wait>::sequenced_mpmc_queue(int size) :
+  size_{std::max(size, 2)},
+  buffer_{std::make_unique<cell[]>(size_)}
+{
+  for (int i=0; i<size_; ++i) {
+    buffer_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <typename T, typename Wait>
+unsigned long long sequenced_mpmc_queue<T,Wait>::claim_write() noexcept
+{
+  auto current = enqueue_pos_.load(std::memory_order_relaxed);
+  for (;;) {
+    auto & slot = buffer_[current%size_];
+    auto seq = slot.sequence.load(std::memory_order_acquire);
+    if (seq == current) {
+      if (enqueue_pos_.compare_exchange_weak(current, current+1,
+          std::memory_order_relaxed))
+      {
+        return current;
+      }
+    }
+    else if (seq < current) {
+      // Slot is still in use by a previous round.
+      not_full_.wait_until([&] {
+        return slot.sequence.load(std::memory_order_acquire) >= current;
+      });
+    }
+    else {
+      // Slot was claimed by another producer.
+      current = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T, typename Wait>
+unsigned long long sequenced_mpmc_queue<T,Wait>::claim_read() noexcept
+{
+  auto current = dequeue_pos_.load(std::memory_order_relaxed);
+  for (;;) {
+    auto & slot = buffer_[current%size_];
+    auto seq = slot.sequence.load(std::memory_order_acquire);
+    if (seq == current+1) {
+      if (dequeue_pos_.compare_exchange_weak(current, current+1,
+          std::memory_order_relaxed))
+      {
+        return current;
+      }
+    }
+    else if (seq < current+1) {
+      // Slot has not been written yet.
+      not_empty_.wait_until([&] {
+        return slot.sequence.load(std::memory_order_acquire) >= current+1;
+      });
+    }
+    else {
+      // Slot was claimed by another consumer.
+      current = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T, typename Wait>
+T sequenced_mpmc_queue<T,Wait>::pop() noexcept(std::is_nothrow_move_constructible<T>::value)
+{
+  auto current = claim_read();
+  auto & slot = buffer_[current%size_];
+  auto item = std::move(slot.value);
+  slot.sequence.store(current + size_, std::memory_order_release);
+  not_full_.notify();
+  return item;
+}
+
+template <typename T, typename Wait>
+void sequenced_mpmc_queue<T,Wait>::push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  push_with([&](T & slot) { slot = std::move(item); });
+}
+
+template <typename T, typename Wait>
+void sequenced_mpmc_queue<T,Wait>::push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value)
+{
+  push_with([&](T & slot) { slot = item; });
+}
+
+template <typename T, typename Wait>
+template <typename Fill>
+void sequenced_mpmc_queue<T,Wait>::push_with(Fill && fill)
+{
+  auto current = claim_write();
+  auto & slot = buffer_[current%size_];
+  fill(slot.value);
+  slot.sequence.store(current+1, std::memory_order_release);
+  not_empty_.notify();
+}
+
+template <typename T, typename Wait>
+template <typename Use>
+void sequenced_mpmc_queue<T,Wait>::pop_with(Use && use)
+{
+  auto current = claim_read();
+  auto & slot = buffer_[current%size_];
+  use(slot.value);
+  slot.sequence.store(current + size_, std::memory_order_release);
+  not_full_.notify();
+}
+
+template <typename T, typename Wait>
+template <typename Fill>
+bool sequenced_mpmc_queue<T,Wait>::try_push_with(Fill && fill)
+{
+  auto current = enqueue_pos_.load(std::memory_order_relaxed);
+  for (;;) {
+    auto & slot = buffer_[current%size_];
+    auto seq = slot.sequence.load(std::memory_order_acquire);
+    if (seq == current) {
+      if (enqueue_pos_.compare_exchange_weak(current, current+1,
+          std::memory_order_relaxed))
+      {
+        fill(slot.value);
+        slot.sequence.store(current+1, std::memory_order_release);
+        not_empty_.notify();
+        return true;
+      }
+    }
+    else if (seq < current) {
+      return false;
+    }
+    else {
+      current = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T, typename Wait>
+template <typename Use>
+bool sequenced_mpmc_queue<T,Wait>::try_pop_with(Use && use)
+{
+  auto current = dequeue_pos_.load(std::memory_order_relaxed);
+  for (;;) {
+    auto & slot = buffer_[current%size_];
+    auto seq = slot.sequence.load(std::memory_order_acquire);
+    if (seq == current+1) {
+      if (dequeue_pos_.compare_exchange_weak(current, current+1,
+          std::memory_order_relaxed))
+      {
+        use(slot.value);
+        slot.sequence.store(current + size_, std::memory_order_release);
+        not_full_.notify();
+        return true;
+      }
+    }
+    else if (seq < current+1) {
+      return false;
+    }
+    else {
+      current = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T, typename Wait>
+bool sequenced_mpmc_queue<T,Wait>::try_push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = std::move(item); });
+}
+
+template <typename T, typename Wait>
+bool sequenced_mpmc_queue<T,Wait>::try_push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = item; });
+}
+
+template <typename T, typename Wait>
+bool sequenced_mpmc_queue<T,Wait>::try_pop(T & item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_pop_with([&](T & slot) { item = std::move(slot); });
+}
+
+template <typename T, typename Wait>
+template <typename Clock, typename Duration>
+bool sequenced_mpmc_queue<T,Wait>::push_until(T && item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  for (;;) {
+    if (try_push(std::move(item))) return true;
+    if (!not_full_.wait_until([&] { return writable(enqueue_pos_.load()); }, deadline)) return false;
+  }
+}
+
+template <typename T, typename Wait>
+template <typename Clock, typename Duration>
+bool sequenced_mpmc_queue<T,Wait>::pop_until(T & item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  for (;;) {
+    if (try_pop(item)) return true;
+    if (!not_empty_.wait_until([&] { return readable(dequeue_pos_.load()); }, deadline)) return false;
+  }
+}
+
+template <typename T, typename Wait>
+template <typename InputIt>
+void sequenced_mpmc_queue<T,Wait>::push_n(InputIt first, InputIt last)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  while (first != last) {
+    auto wanted = static_cast<unsigned long long>(std::distance(first, last));
+    auto current = enqueue_pos_.load(std::memory_order_relaxed);
+    unsigned long long n = 0;
+    while (n < wanted && buffer_[(current+n)%size_].sequence.load(
+        std::memory_order_acquire) == current+n)
+    {
+      n++;
+    }
+    if (n == 0) {
+      auto & slot = buffer_[current%size_];
+      not_full_.wait_until([&] {
+        return slot.sequence.load(std::memory_order_acquire) >= current;
+      });
+      continue;
+    }
+    if (!enqueue_pos_.compare_exchange_weak(current, current+n,
+        std::memory_order_relaxed))
+    {
+      continue;
+    }
+    for (auto i=current; i<current+n; ++i, ++first) {
+      auto & slot = buffer_[i%size_];
+      slot.value = std::move(*first);
+      slot.sequence.store(i+1, std::memory_order_release);
+    }
+    not_empty_.notify();
+  }
+}
+
+template <typename T, typename Wait>
+template <typename OutputIt>
+std::size_t sequenced_mpmc_queue<T,Wait>::pop_n(OutputIt out, std::size_t max)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  for (;;) {
+    auto current = dequeue_pos_.load(std::memory_order_relaxed);
+    unsigned long long n = 0;
+    while (n < max && buffer_[(current+n)%size_].sequence.load(
+        std::memory_order_acquire) == current+n+1)
+    {
+      n++;
+    }
+    if (n == 0) {
+      auto & slot = buffer_[current%size_];
+      not_empty_.wait_until([&] {
+        return slot.sequence.load(std::memory_order_acquire) >= current+1;
+      });
+      continue;
+    }
+    if (!dequeue_pos_.compare_exchange_weak(current, current+n,
+        std::memory_order_relaxed))
+    {
+      continue;
+    }
+    for (auto i=current; i<current+n; ++i, ++out) {
+      auto & slot = buffer_[i%size_];
+      *out = std::move(slot.value);
+      slot.sequence.store(i + size_, std::memory_order_release);
+    }
+    not_full_.notify();
+    return n;
+  }
+}
+
+/**
+\brief A lock-free single producer single consumer queue.
+Each side keeps a cached copy of the index owned by the other side, so that
+the shared indices are only read again when the queue looks full (for the
+producer) or empty (for the consumer).
+\tparam T Element type for the queue.
+\tparam Wait Wait policy used when the queue is not ready.
+\note Exactly one thread may push and exactly one thread may pop.
+*/
+template <typename T, typename Wait = spin_wait>
+class spsc_queue {
+public:
+
+  /// Type alias for element type.
+  using value_type = T;
+
+  /**
+  \brief Constructs a single producer single consumer queue with a given size.
+  \param size Size of the queue.
+  */
+  spsc_queue(int size) :
+    size_{size},
+    buffer_{std::make_unique<T[]>(size)}
+  {}
+
+  /**
+  \brief Move constructs a single producer single consumer queue from another
+  one.
+  \param q The queue to move from.
+  */
+  spsc_queue(spsc_queue && q) noexcept :
+    size_{q.size_},
+    buffer_{std::move(q.buffer_)},
+    head_{q.head_.load()},
+    cached_tail_{q.cached_tail_},
+    tail_{q.tail_.load()},
+    cached_head_{q.cached_head_}
+  {}
+
+  spsc_queue & operator=(spsc_queue && q) noexcept = delete;
+
+  spsc_queue(spsc_queue const & q) noexcept = delete;
+  spsc_queue & operator=(spsc_queue const & q) noexcept = delete;
+
+  /**
+  \brief Checks if the queue is empty.
+  \return true if the queue is empty, false otherwise.
+  */
+  bool empty () const noexcept {
+    return head_.load() == tail_.load();
+  }
+
+  /**
+  \brief Checks if the queue is full.
+  \return true if the queue is full, false otherwise.
+  */
+  bool full () const noexcept {
+    return tail_.load() >= head_.load() + size_;
+  }
+
+  /**
+  \brief Pops an item from the queue.
+  \return The value that has been extracted from the queue.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  T pop () noexcept(std::is_nothrow_move_constructible<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by move.
+  \param item Value to be moved into the queue.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  void push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by copy.
+  \param item Value to be copied into the queue.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  void push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value);
+
+  /**
+  \brief Pushes the elements of a range in the queue by move.
+  \param first Iterator to the first element to be pushed.
+  \param last Iterator to one past the last element to be pushed.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  template <typename InputIt>
+  void push_n (InputIt first, InputIt last)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pops a block of consecutive items from the queue.
+  Waits until at least one item is available and then extracts as many
+  available items as possible up to a maximum.
+  \param out Iterator where the extracted items are moved.
+  \param max Maximum number of items to be extracted.
+  \return The number of extracted items.
+  \pre max > 0
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  template <typename OutputIt>
+  std::size_t pop_n (OutputIt out, std::size_t max)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element by filling its slot in place.
+  \param fill Callable invoked as fill(slot) to store the element directly in
+  the slot reserved for it. The slot is published when fill returns.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  template <typename Fill>
+  void push_with (Fill && fill);
+
+  /**
+  \brief Pops an element by using it in place.
+  \param use Callable invoked as use(slot) on the front element. The slot is
+  released when use returns.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  template <typename Use>
+  void pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element by filling its slot in place without
+  blocking.
+  \param fill Callable invoked as fill(slot) if a slot can be reserved.
+  \return true if a slot was filled and published, false otherwise.
+  */
+  template <typename Fill>
+  bool try_push_with (Fill && fill);
+
+  /**
+  \brief Tries to pop an element by using it in place without blocking.
+  \param use Callable invoked as use(slot) if an element is available.
+  \return true if an element was used and released, false otherwise.
+  */
+  template <typename Use>
+  bool try_pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element in the queue by move without blocking.
+  \param item Value to be moved into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  \note item is only moved from when the element is pushed.
+  */
+  bool try_push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Tries to push an element in the queue by copy without blocking.
+  \param item Value to be copied into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  */
+  bool try_push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value);
+
+  /**
+  \brief Tries to pop an item from the queue without blocking.
+  \param item Variable where the extracted value is moved.
+  \return true if an item was popped, false if the queue was empty.
+  */
+  bool try_pop (T & item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most until a
+  deadline.
+  \param item Value to be moved into the queue.
+  \param deadline Time point after which the push is abandoned.
+  \return true if the element was pushed, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool push_until (T && item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pops an item from the queue waiting at most until a deadline.
+  \param item Variable where the extracted value is moved.
+  \param deadline Time point after which the pop is abandoned.
+  \return true if an item was popped, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool pop_until (T & item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most a timeout.
+  \param item Value to be moved into the queue.
+  \param timeout Maximum time to wait.
+  \return true if the element was pushed, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool push_for (T && item, std::chrono::duration<Rep,Period> const & timeout) {
+    return push_until(std::move(item), std::chrono::steady_clock::now() + timeout);
+  }
+
+  /**
+  \brief Pops an item from the queue waiting at most a timeout.
+  \param item Variable where the extracted value is moved.
+  \param timeout Maximum time to wait.
+  \return true if an item was popped, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool pop_for (T & item, std::chrono::duration<Rep,Period> const & timeout) {
+    return pop_until(item, std::chrono::steady_clock::now() + timeout);
+  }
+
+private:
+
+  /**
+  \brief Waits until there is room for a new element.
+  \return The position to write.
+  */
+  unsigned long long wait_write() noexcept;
+
+  /**
+  \brief Waits until there is an element to be read.
+  \return The position to read.
+  */
+  unsigned long long wait_read() noexcept;
+
+  /// Maximum number of elements in the queue.
+  int size_;
+
+  /// Buffer of elements.
+  std::unique_ptr<T[]> buffer_;
+
+  constexpr static std::size_t cache_line = 64;
+
+  // Consumer and producer fields are kept in separate cache lines, so that
+  // each side only reads the line of the other when its cached index is
+  // exhausted.
+
+  /// Index to next position to read. Only written by the consumer.
+  alignas(cache_line) std::atomic<unsigned long long> head_{0};
+
+  /// Last value of tail_ seen by the consumer.
+  unsigned long long cached_tail_ = 0;
+
+  /// Index to next position to write. Only written by the producer.
+  alignas(cache_line) std::atomic<unsigned long long> tail_{0};
+
+  /// Last value of head_ seen by the producer.
+  unsigned long long cached_head_ = 0;
+
+  /// Wait policy for the consumer waiting on an empty queue.
+  Wait not_empty_{};
+
+  /// Wait policy for the producer waiting on a full queue.
+  Wait not_full_{};
+};
+
+template <typename T, typename Wait>
+unsigned long long spsc_queue<T,Wait>::wait_write() noexcept
+{
+  auto current = tail_.load(std::memory_order_relaxed);
+  if (current >= cached_head_ + size_) {
+    not_full_.wait_until([&] {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      return current < cached_head_ + size_;
+    });
+  }
+  return current;
+}
+
+template <typename T, typename Wait>
+unsigned long long spsc_queue<T,Wait>::wait_read() noexcept
+{
+  auto current = head_.load(std::memory_order_relaxed);
+  if (current >= cached_tail_) {
+    not_empty_.wait_until([&] {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      return current < cached_tail_;
+    });
+  }
+  return current;
+}
+
+template <typename T, typename Wait>
+T spsc_queue<T,Wait>::pop() noexcept(std::is_nothrow_move_constructible<T>::value)
+{
+  auto current = wait_read();
+  auto item = std::move(buffer_[current%size_]);
+  head_.store(current+1, std::memory_order_release);
+  not_full_.notify();
+  return item;
+}
+
+template <typename T, typename Wait>
+void spsc_queue<T,Wait>::push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  push_with([&](T & slot) { slot = std::move(item); });
+}
+
+template <typename T, typename Wait>
+void spsc_queue<T,Wait>::push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value)
+{
+  push_with([&](T & slot) { slot = item; });
+}
+
+template <typename T, typename Wait>
+template <typename Fill>
+void spsc_queue<T,Wait>::push_with(Fill && fill)
+{
+  auto current = wait_write();
+  fill(buffer_[current%size_]);
+  tail_.store(current+1, std::memory_order_release);
+  not_empty_.notify();
+}
+
+template <typename T, typename Wait>
+template <typename Use>
+void spsc_queue<T,Wait>::pop_with(Use && use)
+{
+  auto current = wait_read();
+  use(buffer_[current%size_]);
+  head_.store(current+1, std::memory_order_release);
+  not_full_.notify();
+}
+
+template <typename T, typename Wait>
+template <typename Fill>
+bool spsc_queue<T,Wait>::try_push_with(Fill && fill)
+{
+  auto current = tail_.load(std::memory_order_relaxed);
+  if (current >= cached_head_ + size_) {
+    cached_head_ = head_.load(std::memory_order_acquire);
+    if (current >= cached_head_ + size_) return false;
+  }
+  fill(buffer_[current%size_]);
+  tail_.store(current+1, std::memory_order_release);
+  not_empty_.notify();
+  return true;
+}
+
+template <typename T, typename Wait>
+template <typename Use>
+bool spsc_queue<T,Wait>::try_pop_with(Use && use)
+{
+  auto current = head_.load(std::memory_order_relaxed);
+  if (current >= cached_tail_) {
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+    if (current >= cached_tail_) return false;
+  }
+  use(buffer_[current%size_]);
+  head_.store(current+1, std::memory_order_release);
+  not_full_.notify();
+  return true;
+}
+
+template <typename T, typename Wait>
+bool spsc_queue<T,Wait>::try_push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = std::move(item); });
+}
+
+template <typename T, typename Wait>
+bool spsc_queue<T,Wait>::try_push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = item; });
+}
+
+template <typename T, typename Wait>
+bool spsc_queue<T,Wait>::try_pop(T & item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_pop_with([&](T & slot) { item = std::move(slot); });
+}
+
+template <typename T, typename Wait>
+template <typename Clock, typename Duration>
+bool spsc_queue<T,Wait>::push_until(T && item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  for (;;) {
+    if (try_push(std::move(item))) return true;
+    if (!not_full_.wait_until([&] { return tail_.load(std::memory_order_relaxed) < head_.load(std::memory_order_acquire) + size_; }, deadline)) return false;
+  }
+}
+
+template <typename T, typename Wait>
+template <typename Clock, typename Duration>
+bool spsc_queue<T,Wait>::pop_until(T & item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  for (;;) {
+    if (try_pop(item)) return true;
+    if (!not_empty_.wait_until([&] { return head_.load(std::memory_order_relaxed) < tail_.load(std::memory_order_acquire); }, deadline)) return false;
+  }
+}
+
+template <typename T, typename Wait>
+template <typename InputIt>
+void spsc_queue<T,Wait>::push_n(InputIt first, InputIt last)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  while (first != last) {
+    auto current = wait_write();
+    auto end = cached_head_ + size_;
+    auto i = current;
+    for (; i<end && first!=last; ++i, ++first) {
+      buffer_[i%size_] = std::move(*first);
+    }
+    tail_.store(i, std::memory_order_release);
+    not_empty_.notify();
+  }
+}
+
+template <typename T, typename Wait>
+template <typename OutputIt>
+std::size_t spsc_queue<T,Wait>::pop_n(OutputIt out, std::size_t max)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  auto current = wait_read();
+  auto n = std::min<unsigned long long>(cached_tail_ - current, max);
+  for (auto i=current; i<current+n; ++i, ++out) {
+    *out = std::move(buffer_[i%size_]);
+  }
+  head_.store(current+n, std::memory_order_release);
+  not_full_.notify();
+  return n;
+}
+
+/**
+\brief An unbounded multiple producer multiple consumer queue.
+Elements are stored in a linked list of fixed size segments. Segments are
+allocated when the queue grows and are returned to a small pool when they
+are drained, so that memory is released again once a burst has been consumed.
+An optional soft limit makes producers wait while the queue holds that many
+elements.
+\tparam T Element type for the queue.
+*/
+template <typename T>
+class unbounded_mpmc_queue {
+public:
+
+  /// Type alias for element type.
+  using value_type = T;
+
+  /**
+  \brief Constructs an unbounded queue.
+  \param segment_size Number of elements in each segment.
+  \param limit Soft limit in number of elements (0 means no limit).
+  */
+  unbounded_mpmc_queue(int segment_size, std::size_t limit = 0) :
+    segment_size_{segment_size},
+    limit_{limit},
+    head_{std::make_unique<segment>(segment_size)},
+    tail_{head_.get()}
+  {
+    pool_.reserve(pool_limit);
+  }
+
+  /**
+  \brief Move constructs an unbounded queue from another one.
+  \param q The queue to move from.
+  */
+  unbounded_mpmc_queue(unbounded_mpmc_queue && q) noexcept :
+    segment_size_{q.segment_size_},
+    limit_{q.limit_},
+    head_{std::move(q.head_)},
+    tail_{q.tail_},
+    pool_{std::move(q.pool_)},
+    count_{q.count_}
+  {}
+
+  unbounded_mpmc_queue & operator=(unbounded_mpmc_queue && q) noexcept = delete;
+
+  unbounded_mpmc_queue(unbounded_mpmc_queue const & q) noexcept = delete;
+  unbounded_mpmc_queue & operator=(unbounded_mpmc_queue const & q) noexcept = delete;
+
+  /**
+  \brief Checks if the queue is empty.
+  \return true if the queue is empty, false otherwise.
+  */
+  bool empty () const noexcept {
+    return count_ == 0;
+  }
+
+  /**
+  \brief Checks if the queue has reached its soft limit.
+  \return true if producers must wait, false otherwise.
+  */
+  bool full () const noexcept {
+    return limit_ > 0 && count_ >= limit_;
+  }
+
+  /**
+  \brief Pops an item from the queue.
+  \return The value that has been extracted from the queue.
+  \note This call may block through a mutex if the queue is empty.
+  */
+  T pop () noexcept(std::is_nothrow_move_constructible<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by move.
+  \param item Value to be moved into the queue.
+  \note This call may block through a mutex if the soft limit is reached.
+  */
+  void push (T && item);
+
+  /**
+  \brief Pushes an element in the queue by copy.
+  \param item Value to be copied into the queue.
+  \note This call may block through a mutex if the soft limit is reached.
+  */
+  void push (T const & item);
+
+  /**
+  \brief Pushes the elements of a range in the queue by move.
+  \param first Iterator to the first element to be pushed.
+  \param last Iterator to one past the last element to be pushed.
+  \note This call may block through a mutex if the soft limit is reached.
+  */
+  template <typename InputIt>
+  void push_n (InputIt first, InputIt last);
+
+  /**
+  \brief Pops a block of consecutive items from the queue.
+  Waits until at least one item is available and then extracts as many
+  available items as possible up to a maximum.
+  \param out Iterator where the extracted items are moved.
+  \param max Maximum number of items to be extracted.
+  \return The number of extracted items.
+  \pre max > 0
+  \note This call may block through a mutex if the queue is empty.
+  */
+  template <typename OutputIt>
+  std::size_t pop_n (OutputIt out, std::size_t max)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element by filling its slot in place.
+  \param fill Callable invoked as fill(slot) to store the element directly in
+  the slot reserved for it. The slot is published when fill returns.
+  \note This call may block through a mutex if the soft limit is reached.
+  */
+  template <typename Fill>
+  void push_with (Fill && fill);
+
+  /**
+  \brief Pops an element by using it in place.
+  \param use Callable invoked as use(slot) on the front element. The slot is
+  released when use returns.
+  \note This call may block through a mutex if the queue is empty.
+  */
+  template <typename Use>
+  void pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element by filling its slot in place without
+  blocking.
+  \param fill Callable invoked as fill(slot) if a slot can be reserved.
+  \return true if a slot was filled and published, false otherwise.
+  */
+  template <typename Fill>
+  bool try_push_with (Fill && fill);
+
+  /**
+  \brief Tries to pop an element by using it in place without blocking.
+  \param use Callable invoked as use(slot) if an element is available.
+  \return true if an element was used and released, false otherwise.
+  */
+  template <typename Use>
+  bool try_pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element in the queue by move without blocking.
+  \param item Value to be moved into the queue.
+  \return true if the element was pushed, false if the queue was at its soft limit.
+  \note item is only moved from when the element is pushed.
+  */
+  bool try_push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Tries to push an element in the queue by copy without blocking.
+  \param item Value to be copied into the queue.
+  \return true if the element was pushed, false if the queue was at its soft limit.
+  */
+  bool try_push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value);
+
+  /**
+  \brief Tries to pop an item from the queue without blocking.
+  \param item Variable where the extracted value is moved.
+  \return true if an item was popped, false if the queue was empty.
+  */
+  bool try_pop (T & item) noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most until a
+  deadline.
+  \param item Value to be moved into the queue.
+  \param deadline Time point after which the push is abandoned.
+  \return true if the element was pushed, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool push_until (T && item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pops an item from the queue waiting at most until a deadline.
+  \param item Variable where the extracted value is moved.
+  \param deadline Time point after which the pop is abandoned.
+  \return true if an item was popped, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool pop_until (T & item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most a timeout.
+  \param item Value to be moved into the queue.
+  \param timeout Maximum time to wait.
+  \return true if the element was pushed, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool push_for (T && item, std::chrono::duration<Rep,Period> const & timeout) {
+    return push_until(std::move(item), std::chrono::steady_clock::now() + timeout);
+  }
+
+  /**
+  \brief Pops an item from the queue waiting at most a timeout.
+  \param item Variable where the extracted value is moved.
+  \param timeout Maximum time to wait.
+  \return true if an item was popped, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool pop_for (T & item, std::chrono::duration<Rep,Period> const & timeout) {
+    return pop_until(item, std::chrono::steady_clock::now() + timeout);
+  }
+
+  /// Maximum number of drained segments kept for reuse.
+  constexpr static std::size_t pool_limit = 4;
+
+private:
+
+  /**
+  \brief A segment of the queue.
+  */
+  struct segment {
+    segment(int size) : items{std::make_unique<T[]>(size)} {}
+    /// Elements in the segment.
+    std::unique_ptr<T[]> items;
+    /// Index to next position to read.
+    int read = 0;
+    /// Index to next position to write.
+    int write = 0;
+    /// Next segment in the queue.
+    std::unique_ptr<segment> next{};
+  };
+
+  /**
+  \brief Gets a slot to write at the tail, appending a segment if needed.
+  \return Reference to the slot.
+  \pre mut_ is held.
+  */
+  T & write_slot();
+
+  /**
+  \brief Moves the front element out of the queue.
+  \return The extracted element.
+  \pre mut_ is held and the queue is not empty.
+  */
+  T take_front() noexcept(std::is_nothrow_move_constructible<T>::value) {
+    auto item = std::move(head_->items[head_->read]);
+    release_front();
+    return item;
+  }
+
+  /**
+  \brief Removes the front element, recycling its segment when drained.
+  \pre mut_ is held and the queue is not empty.
+  */
+  void release_front() noexcept;
+
+
+  /// Number of elements in each segment.
+  int segment_size_;
+
+  /// Soft limit in number of elements (0 means no limit).
+  std::size_t limit_;
+
+  /// First segment of the queue.
+  std::unique_ptr<segment> head_;
+
+  /// Last segment of the queue.
+  segment * tail_;
+
+  /// Drained segments kept for reuse.
+  std::vector<std::unique_ptr<segment>> pool_{};
+
+  /// Number of elements in the queue.
+  std::size_t count_ = 0;
+
+  /// Mutex to synchronize access to the queue.
+  std::mutex mut_{};
+
+  /// Condition variable to signal empty queue.
+  std::condition_variable empty_{};
+
+  /// Condition variable to signal that the soft limit was reached.
+  std::condition_variable full_{};
+
+  /// Number of consumers waiting on empty_. Protected by mut_.
+  int empty_waiters_ = 0;
+
+  /// Number of producers waiting on full_. Protected by mut_.
+  int full_waiters_ = 0;
+};
+
+template <typename T>
+constexpr std::size_t unbounded_mpmc_queue<T>::pool_limit;
+
+template <typename T>
+T & unbounded_mpmc_queue<T>::write_slot()
+{
+  if (tail_->write == segment_size_) {
+    std::unique_ptr<segment> fresh;
+    if (pool_.empty()) {
+      fresh = std::make_unique<segment>(segment_size_);
+    }
+    else {
+      fresh = std::move(pool_.back());
+      pool_.pop_back();
+    }
+    tail_->next = std::move(fresh);
+    tail_ = tail_->next.get();
+  }
+  count_++;
+  return tail_->items[tail_->write++];
+}
+
+template <typename T>
+void unbounded_mpmc_queue<T>::release_front() noexcept
+{
+  head_->read++;
+  count_--;
+  if (head_->read == head_->write) {
+    if (head_->next) {
+      auto drained = std::move(head_);
+      head_ = std::move(drained->next);
+      if (pool_.size() < pool_limit) {
+        drained->read = drained->write = 0;
+        pool_.push_back(std::move(drained));
+      }
+    }
+    else {
+      head_->read = head_->write = 0;
+    }
+  }
+}
+
+template <typename T>
+T unbounded_mpmc_queue<T>::pop()
+    noexcept(std::is_nothrow_move_constructible<T>::value)
+{
+  std::unique_lock<std::mutex> lk(mut_);
+  while (count_ == 0) {
+    empty_waiters_++;
+    empty_.wait(lk);
+    empty_waiters_--;
+  }
+  auto item = take_front();
+  auto waiters = full_waiters_;
+  lk.unlock();
+  if (waiters > 0) full_.notify_one();
+  return item;
+}
+
+template <typename T>
+void unbounded_mpmc_queue<T>::push(T && item)
+{
+  push_with([&](T & slot) { slot = std::move(item); });
+}
+
+template <typename T>
+void unbounded_mpmc_queue<T>::push(T const & item)
+{
+  push_with([&](T & slot) { slot = item; });
+}
+
+template <typename T>
+template <typename Fill>
+void unbounded_mpmc_queue<T>::push_with(Fill && fill)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    while (full()) {
+      full_waiters_++;
+      full_.wait(lk);
+      full_waiters_--;
+    }
+    fill(write_slot());
+    waiters = empty_waiters_;
+  }
+  if (waiters > 0) empty_.notify_one();
+}
+
+template <typename T>
+template <typename Use>
+void unbounded_mpmc_queue<T>::pop_with(Use && use)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    while (count_ == 0) {
+      empty_waiters_++;
+      empty_.wait(lk);
+      empty_waiters_--;
+    }
+    use(head_->items[head_->read]);
+    release_front();
+    waiters = full_waiters_;
+  }
+  if (waiters > 0) full_.notify_one();
+}
+
+template <typename T>
+template <typename Fill>
+bool unbounded_mpmc_queue<T>::try_push_with(Fill && fill)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    if (full()) return false;
+    fill(write_slot());
+    waiters = empty_waiters_;
+  }
+  if (waiters > 0) empty_.notify_one();
+  return true;
+}
+
+template <typename T>
+template <typename Use>
+bool unbounded_mpmc_queue<T>::try_pop_with(Use && use)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    if (count_ == 0) return false;
+    use(head_->items[head_->read]);
+    release_front();
+    waiters = full_waiters_;
+  }
+  if (waiters > 0) full_.notify_one();
+  return true;
+}
+
+template <typename T>
+bool unbounded_mpmc_queue<T>::try_push(T && item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = std::move(item); });
+}
+
+template <typename T>
+bool unbounded_mpmc_queue<T>::try_push(T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value)
+{
+  return try_push_with([&](T & slot) { slot = item; });
+}
+
+template <typename T>
+bool unbounded_mpmc_queue<T>::try_pop(T & item) noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  return try_pop_with([&](T & slot) { item = std::move(slot); });
+}
+
+template <typename T>
+template <typename Clock, typename Duration>
+bool unbounded_mpmc_queue<T>::push_until(T && item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    while (full()) {
+      full_waiters_++;
+      auto status = full_.wait_until(lk, deadline);
+      full_waiters_--;
+      if (status == std::cv_status::timeout && full()) return false;
+    }
+    write_slot() = std::move(item);
+    waiters = empty_waiters_;
+  }
+  if (waiters > 0) empty_.notify_one();
+  return true;
+}
+
+template <typename T>
+template <typename Clock, typename Duration>
+bool unbounded_mpmc_queue<T>::pop_until(T & item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    while (count_ == 0) {
+      empty_waiters_++;
+      auto status = empty_.wait_until(lk, deadline);
+      empty_waiters_--;
+      if (status == std::cv_status::timeout && count_ == 0) return false;
+    }
+    item = take_front();
+    waiters = full_waiters_;
+  }
+  if (waiters > 0) full_.notify_one();
+  return true;
+}
+
+template <typename T>
+template <typename InputIt>
+void unbounded_mpmc_queue<T>::push_n(InputIt first, InputIt last)
+{
+  while (first != last) {
+    int waiters;
+    {
+      std::unique_lock<std::mutex> lk(mut_);
+      while (full()) {
+        full_waiters_++;
+        full_.wait(lk);
+        full_waiters_--;
+      }
+      while (first != last && !full()) {
+        write_slot() = std::move(*first);
+        ++first;
+      }
+      waiters = empty_waiters_;
+    }
+    if (waiters > 0) empty_.notify_all();
+  }
+}
+
+template <typename T>
+template <typename OutputIt>
+std::size_t unbounded_mpmc_queue<T>::pop_n(OutputIt out, std::size_t max)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  std::size_t n = 0;
+  int waiters;
+  {
+    std::unique_lock<std::mutex> lk(mut_);
+    while (count_ == 0) {
+      empty_waiters_++;
+      empty_.wait(lk);
+      empty_waiters_--;
+    }
+    while (n < max && count_ > 0) {
+      *out = take_front();
+      ++out;
+      n++;
+    }
+    waiters = full_waiters_;
+  }
+  if (waiters > 0) full_.notify_all();
+  return n;
+}
+
+/**
+\brief A multiple producer multiple consumer queue split in shards.
+Producers deal elements round-robin over the shards. Each consumer pops from
+its own shard and steals from the other shards when its shard is empty, so that
+consumers do not contend on a single queue head.
+\tparam T Element type for the queue.
+\tparam Wait Wait policy used when the queue is not ready.
+*/
+template <typename T, typename Wait = spin_wait>
+class sharded_mpmc_queue {
+public:
+
+  /// Type alias for element type.
+  using value_type = T;
+
+  /**
+  \brief Constructs a sharded queue.
+  \param size Total size of the queue.
+  \param shards Number of shards.
+  */
+  sharded_mpmc_queue(int size, int shards);
+
+  /**
+  \brief Move constructs a sharded queue from another one.
+  \param q The queue to move from.
+  */
+  sharded_mpmc_queue(sharded_mpmc_queue && q) noexcept :
+    shards_{std::move(q.shards_)},
+    next_push_{q.next_push_.load()},
+    next_pop_{q.next_pop_.load()}
+  {}
+
+  sharded_mpmc_queue & operator=(sharded_mpmc_queue && q) noexcept = delete;
+
+  sharded_mpmc_queue(sharded_mpmc_queue const & q) noexcept = delete;
+  sharded_mpmc_queue & operator=(sharded_mpmc_queue const & q) noexcept = delete;
+
+  /**
+  \brief Checks if the queue is empty.
+  \return true if every shard is empty, false otherwise.
+  */
+  bool empty () const noexcept {
+    return std::all_of(shards_.begin(), shards_.end(),
+        [](auto & shard) { return shard.empty(); });
+  }
+
+  /**
+  \brief Checks if the queue is full.
+  \return true if every shard is full, false otherwise.
+  */
+  bool full () const noexcept {
+    return std::all_of(shards_.begin(), shards_.end(),
+        [](auto & shard) { return shard.full(); });
+  }
+
+  /**
+  \brief Pops an item from the queue, starting from the next shard in
+  round-robin order.
+  \return The value that has been extracted from the queue.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  T pop () noexcept(std::is_nothrow_move_constructible<T>::value) {
+    return pop_from(next_pop_++);
+  }
+
+  /**
+  \brief Pops an item from a given shard, stealing from the other shards
+  when that shard is empty.
+  \param shard Index of the preferred shard.
+  \return The value that has been extracted from the queue.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  T pop_from (std::size_t shard)
+      noexcept(std::is_nothrow_move_constructible<T>::value);
+
+  /**
+  \brief Pushes an element in the queue by move.
+  \param item Value to be moved into the queue.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  void push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value) {
+    push_with([&](T & slot) { slot = std::move(item); });
+  }
+
+  /**
+  \brief Pushes an element in the queue by copy.
+  \param item Value to be copied into the queue.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  void push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value) {
+    push_with([&](T & slot) { slot = item; });
+  }
+
+  /**
+  \brief Pushes the elements of a range in the queue by move.
+  \param first Iterator to the first element to be pushed.
+  \param last Iterator to one past the last element to be pushed.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  template <typename InputIt>
+  void push_n (InputIt first, InputIt last)
+      noexcept(std::is_nothrow_move_assignable<T>::value)
+  {
+    for (; first != last; ++first) {
+      push(std::move(*first));
+    }
+  }
+
+  /**
+  \brief Pops a block of items from the queue.
+  Waits until at least one item is available and then extracts as many
+  available items as possible up to a maximum.
+  \param out Iterator where the extracted items are moved.
+  \param max Maximum number of items to be extracted.
+  \return The number of extracted items.
+  \pre max > 0
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  template <typename OutputIt>
+  std::size_t pop_n (OutputIt out, std::size_t max)
+      noexcept(std::is_nothrow_move_assignable<T>::value);
+
+  /**
+  \brief Pushes an element by filling its slot in place.
+  \param fill Callable invoked as fill(slot) to store the element directly in
+  the slot reserved for it. The slot is published when fill returns.
+  \note This call may block using the wait policy if the queue is full.
+  */
+  template <typename Fill>
+  void push_with (Fill && fill);
+
+  /**
+  \brief Pops an element by using it in place.
+  \param use Callable invoked as use(slot) on the front element. The slot is
+  released when use returns.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  template <typename Use>
+  void pop_with (Use && use) {
+    pop_from_with(next_pop_++, std::forward<Use>(use));
+  }
+
+  /**
+  \brief Tries to push an element by filling its slot in place without
+  blocking.
+  \param fill Callable invoked as fill(slot) if a slot can be reserved.
+  \return true if a slot was filled and published, false otherwise.
+  */
+  template <typename Fill>
+  bool try_push_with (Fill && fill);
+
+  /**
+  \brief Tries to pop an element by using it in place without blocking.
+  \param use Callable invoked as use(slot) if an element is available.
+  \return true if an element was used and released, false otherwise.
+  */
+  template <typename Use>
+  bool try_pop_with (Use && use);
+
+  /**
+  \brief Tries to push an element in the queue by move without blocking.
+  \param item Value to be moved into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  \note item is only moved from when the element is pushed.
+  */
+  bool try_push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value) {
+    return try_push_with([&](T & slot) { slot = std::move(item); });
+  }
+
+  /**
+  \brief Tries to push an element in the queue by copy without blocking.
+  \param item Value to be copied into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  */
+  bool try_push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value) {
+    return try_push_with([&](T & slot) { slot = item; });
+  }
+
+  /**
+  \brief Tries to pop an item from the queue without blocking.
+  \param item Variable where the extracted value is moved.
+  \return true if an item was popped, false if the queue was empty.
+  */
+  bool try_pop (T & item) noexcept(std::is_nothrow_move_assignable<T>::value) {
+    return try_pop_with([&](T & slot) { item = std::move(slot); });
+  }
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most until a
+  deadline.
+  \param item Value to be moved into the queue.
+  \param deadline Time point after which the push is abandoned.
+  \return true if the element was pushed, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool push_until (T && item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pops an item from the queue waiting at most until a deadline.
+  \param item Variable where the extracted value is moved.
+  \param deadline Time point after which the pop is abandoned.
+  \return true if an item was popped, false if the deadline was reached.
+  */
+  template <typename Clock, typename Duration>
+  bool pop_until (T & item,
+      std::chrono::time_point<Clock,Duration> const & deadline);
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most a timeout.
+  \param item Value to be moved into the queue.
+  \param timeout Maximum time to wait.
+  \return true if the element was pushed, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool push_for (T && item, std::chrono::duration<Rep,Period> const & timeout) {
+    return push_until(std::move(item), std::chrono::steady_clock::now() + timeout);
+  }
+
+  /**
+  \brief Pops an item from the queue waiting at most a timeout.
+  \param item Variable where the extracted value is moved.
+  \param timeout Maximum time to wait.
+  \return true if an item was popped, false on timeout.
+  */
+  template <typename Rep, typename Period>
+  bool pop_for (T & item, std::chrono::duration<Rep,Period> const & timeout) {
+    return pop_until(item, std::chrono::steady_clock::now() + timeout);
+  }
+
+private:
+
+  /// Type for the shards.
+  using shard_type = sequenced_mpmc_queue<T>;
+
+  /**
+  \brief Pops an element from a given shard or any other shard, using it in
+  place.
+  \note This call may block using the wait policy if the queue is empty.
+  */
+  template <typename Use>
+  void pop_from_with(std::size_t shard, Use && use);
+
+  /**
+  \brief Fills a slot in the first shard with room, starting from a given one.
+  \return true if a slot was filled, false if every shard was full.
+  */
+  template <typename Fill>
+  bool try_push_at(std::size_t shard, Fill && fill);
+
+  /**
+  \brief Uses the front element of the first non empty shard, starting from
+  a given one.
+  \return true if an element was used, false if every shard was empty.
+  */
+  template <typename Use>
+  bool try_pop_at(std::size_t shard, Use && use);
+
+  /// Shards of the queue.
+  std::vector<shard_type> shards_;
+
+  /// Shard where the next push starts.
+  std::atomic<std::size_t> next_push_{0};
+
+  /// Shard where the next pop starts when no shard is given.
+  std::atomic<std::size_t> next_pop_{0};
+
+  /// Wait policy for consumers waiting on an empty queue.
+  Wait not_empty_{};
+
+  /// Wait policy for producers waiting on a full queue.
+  Wait not_full_{};
+};
+
+template <typename T, typename Wait>
+sharded_mpmc_queue<T,Wait>::sharded_mpmc_queue(int size, int shards)
+{
+  auto shard_size = std::max(1, (size + shards - 1) / shards);
+  shards_.reserve(shards);
+  for (int i=0; i<shards; ++i) {
+    shards_.emplace_back(shard_size);
+  }
+}
+
+template <typename T, typename Wait>
+template <typename Fill>
+bool sharded_mpmc_queue<T,Wait>::try_push_at(std::size_t shard, Fill && fill)
+{
+  auto n = shards_.size();
+  for (std::size_t i=0; i<n; ++i) {
+    if (shards_[(shard+i)%n].try_push_with(fill)) return true;
+  }
+  return false;
+}
+
+template <typename T, typename Wait>
+template <typename Use>
+bool sharded_mpmc_queue<T,Wait>::try_pop_at(std::size_t shard, Use && use)
+{
+  auto n = shards_.size();
+  for (std::size_t i=0; i<n; ++i) {
+    if (shards_[(shard+i)%n].try_pop_with(use)) return true;
+  }
+  return false;
+}
+
+template <typename T, typename Wait>
+template <typename Use>
+void sharded_mpmc_queue<T,Wait>::pop_from_with(std::size_t shard, Use && use)
+{
+  not_empty_.wait_until([&] { return try_pop_at(shard, use); });
+  not_full_.notify();
+}
+
+template <typename T, typename Wait>
+T sharded_mpmc_queue<T,Wait>::pop_from(std::size_t shard)
+    noexcept(std::is_nothrow_move_constructible<T>::value)
+{
+  T item;
+  pop_from_with(shard, [&](T & slot) { item = std::move(slot); });
+  return item;
+}
+
+template <typename T, typename Wait>
+template <typename Fill>
+void sharded_mpmc_queue<T,Wait>::push_with(Fill && fill)
+{
+  auto shard = next_push_++;
+  not_full_.wait_until([&] { return try_push_at(shard, fill); });
+  not_empty_.notify();
+}
+
+template <typename T, typename Wait>
+template <typename Fill>
+bool sharded_mpmc_queue<T,Wait>::try_push_with(Fill && fill)
+{
+  if (!try_push_at(next_push_++, fill)) return false;
+  not_empty_.notify();
+  return true;
+}
+
+template <typename T, typename Wait>
+template <typename Use>
+bool sharded_mpmc_queue<T,Wait>::try_pop_with(Use && use)
+{
+  if (!try_pop_at(next_pop_++, use)) return false;
+  not_full_.notify();
+  return true;
+}
+
+template <typename T, typename Wait>
+template <typename OutputIt>
+std::size_t sharded_mpmc_queue<T,Wait>::pop_n(OutputIt out, std::size_t max)
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+{
+  auto move_out = [&](T & slot) { *out = std::move(slot); ++out; };
+  pop_with(move_out);
+  std::size_t n = 1;
+  while (n < max && try_pop_with(move_out)) {
+    n++;
+  }
+  return n;
+}
+
+template <typename T, typename Wait>
+template <typename Clock, typename Duration>
+bool sharded_mpmc_queue<T,Wait>::push_until(T && item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  auto shard = next_push_++;
+  auto fill = [&](T & slot) { slot = std::move(item); };
+  if (!not_full_.wait_until([&] { return try_push_at(shard, fill); }, deadline)) {
+    return false;
+  }
+  not_empty_.notify();
+  return true;
+}
+
+template <typename T, typename Wait>
+template <typename Clock, typename Duration>
+bool sharded_mpmc_queue<T,Wait>::pop_until(T & item,
+    std::chrono::time_point<Clock,Duration> const & deadline)
+{
+  auto shard = next_pop_++;
+  auto use = [&](T & slot) { item = std::move(slot); };
+  if (!not_empty_.wait_until([&] { return try_pop_at(shard, use); }, deadline)) {
+    return false;
+  }
+  not_full_.notify();
+  return true;
+}
+
+/**
+\brief Maximum number of items moved in a single block by the pipeline
+stages draining a queue.
+*/
+constexpr std::size_t queue_batch_size = 16;
+
+/**
+\brief Synchronization mode for queues.
+*/
+enum class queue_mode {
+  /// Lock-free synchronization using atomics. Non-blocking and timed
+  /// operations may still wait for earlier operations to be published.
+  lockfree,
+  /// Mutex based synchronization.
+  blocking,
+  /// Lock-free synchronization using per slot sequence numbers.
+  sequenced,
+  /// Mutex based synchronization over a growable list of segments.
+  unbounded
+};
+
+/**
+\brief Number of shards for a sharded queue.
+*/
+struct queue_shards {
+  /// Number of shards.
+  int count;
+};
+
+/**
+\brief Access pattern guaranteed by the users of a queue.
+*/
+enum class queue_access {
+  /// Any number of producer and consumer threads.
+  multiple,
+  /// A single producer thread and a single consumer thread.
+  single
+};
+
+/**
+\brief A multiple producer multiple consumer queue.
+\tparam T Element type for the queue.
+The mpmc_queue may be constructed providing a synchronization mode 
+(lockfree, blocking, sequenced or unbounded). When the queue is known to be used by a
+single producer and a single consumer, a non-blocking mode uses a
+spsc_queue instead. Non-blocking modes may either spin or back off and park
+waiting threads (see queue_wait).
+*/
+template <typename T>
+class mpmc_queue{
+public:
+  using value_type = T;
+
+  /**
+  \brief Constructs a queue with a given size and a synchronization mode.
+  \param size Size of the queue.
+  \param mode Synchronization mode.
+  \param access Access pattern guaranteed by the users of the queue.
+  \param wait Waiting strategy for non-blocking modes.
+  \param limit Soft limit in number of elements for unbounded mode
+  (0 means no limit).
+  \note In unbounded mode size is the number of elements of each segment.
+  */
+  mpmc_queue(int size, queue_mode mode,
+      queue_access access = queue_access::multiple,
+      queue_wait wait = queue_wait::spin,
+      std::size_t limit = 0);
+
+  /**
+  \brief Constructs a queue split in shards (see sharded_mpmc_queue).
+  \param size Total size of the queue.
+  \param shards Number of shards.
+  \param wait Waiting strategy.
+  */
+  mpmc_queue(int size, queue_shards shards,
+      queue_wait wait = queue_wait::spin);
+
+  /**
+  \brief Move constructs a queue from another one.
+  \param q The queue to move from.
+  */
+  mpmc_queue(mpmc_queue && q); 
+
+  /**
+  \brief Destroys the queue and the concrete queue it holds.
+  */
+  ~mpmc_queue();
 
   mpmc_queue & operator=(mpmc_queue &&) = delete;
 
@@ -350,13 +2934,70 @@ public:
     return pself_const()->empty();
   }
 
+  /**
+  \brief Checks if the queue is full.
+  \return true if the queue is full, false otherwise.
+  */
+  bool full () const noexcept {
+    return pself_const()->full();
+  }
+
+  /**
+  \brief Sets the statistics where the operations on the queue are recorded.
+  \param stats Statistics for the queue (nullptr disables recording).
+  */
+  void set_statistics(std::shared_ptr<queue_statistics> stats) noexcept {
+    stats_ = std::move(stats);
+  }
+
+  /**
+  \brief Sets the credit acquired by the stage issuing the sequence numbers
+  of the items in the queue.
+  \param credit Credit for the items (nullptr if they are not reordered).
+  */
+  void set_reorder_credit(std::shared_ptr<reorder_credit> credit) noexcept {
+    credit_ = std::move(credit);
+  }
+
+  /**
+  \brief Gets the credit to be handed back when the items in the queue are
+  released in order.
+  */
+  std::shared_ptr<reorder_credit> get_reorder_credit() const noexcept {
+    return credit_;
+  }
+
   /**
   \brief Pops an item from the queue.
   \return The value that has been extracted from the queue.
   \note This call may block if the queue is empty.
   */
   T pop () noexcept(std::is_nothrow_move_constructible<T>::value) {
-    return pself()->pop();
+    if (!stats_) return pself()->pop();
+    queue_wait_timer timer{empty()};
+    auto item = pself()->pop();
+    stats_->record_pop_wait(timer.elapsed());
+    stats_->record_pop();
+    return item;
+  }
+
+  /**
+  \brief Pops an item from the queue on behalf of a given consumer.
+  A sharded queue pops from the consumer's shard first and steals from the
+  other shards when it is empty. Any other queue just pops an item.
+  \param consumer Index of the consumer.
+  \return The value that has been extracted from the queue.
+  \note This call may block if the queue is empty.
+  */
+  T pop_from (std::size_t consumer)
+      noexcept(std::is_nothrow_move_constructible<T>::value)
+  {
+    if (!stats_) return pself()->pop_from(consumer);
+    queue_wait_timer timer{empty()};
+    auto item = pself()->pop_from(consumer);
+    stats_->record_pop_wait(timer.elapsed());
+    stats_->record_pop();
+    return item;
   }
 
   /**
@@ -365,29 +3006,207 @@ public:
   \note This call may block if the queue is empty.
   */
   void push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value) {
+    if (!stats_) return pself()->push(std::forward<T>(item));
+    queue_wait_timer timer{full()};
     pself()->push(std::forward<T>(item));
+    stats_->record_push_wait(timer.elapsed());
+    stats_->record_push();
   }
 
   /**
   \brief Pushes an element in the queue by copy.
+  The copy is moved into the queue, so that concrete queues only require
+  movable elements.
   \param item Value to be copied into the queue.
   \note This call may block if the queue is empty.
   */
   void push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value) {
-    pself()->push(item);
+    push(T{item});
+  }
+
+  /**
+  \brief Pushes the elements of a range in the queue by move.
+  \param first Pointer to the first element to be pushed.
+  \param last Pointer to one past the last element to be pushed.
+  \note This call may block if the queue is full.
+  */
+  void push_n (T * first, T * last)
+      noexcept(std::is_nothrow_move_assignable<T>::value)
+  {
+    if (!stats_) return pself()->push_n(first, last);
+    queue_wait_timer timer{full()};
+    pself()->push_n(first, last);
+    stats_->record_push_wait(timer.elapsed());
+    stats_->record_push(last - first);
+  }
+
+  /**
+  \brief Pops a block of consecutive items from the queue.
+  Waits until at least one item is available and then extracts as many
+  available items as possible up to a maximum.
+  \param out Pointer to the buffer where the extracted items are moved.
+  \param max Maximum number of items to be extracted.
+  \return The number of extracted items.
+  \pre max > 0
+  \note This call may block if the queue is empty.
+  */
+  std::size_t pop_n (T * out, std::size_t max)
+      noexcept(std::is_nothrow_move_assignable<T>::value)
+  {
+    if (!stats_) return pself()->pop_n(out, max);
+    queue_wait_timer timer{empty()};
+    auto n = pself()->pop_n(out, max);
+    stats_->record_pop_wait(timer.elapsed());
+    stats_->record_pop(n);
+    return n;
+  }
+
+  /**
+  \brief Pushes an element by filling its slot in place.
+  \param fill Callable invoked as fill(slot) to store the element directly in
+  the slot reserved for it. The slot is published when fill returns.
+  \note This call may block if the queue is full.
+  */
+  template <typename Fill>
+  void push_with (Fill && fill) {
+    if (!stats_) return pself()->push_with(invoke_on_slot<Fill>, &fill);
+    queue_wait_timer timer{full()};
+    pself()->push_with(invoke_on_slot<Fill>, &fill);
+    stats_->record_push_wait(timer.elapsed());
+    stats_->record_push();
+  }
+
+  /**
+  \brief Pops an element by using it in place.
+  \param use Callable invoked as use(slot) on the front element. The slot is
+  released when use returns.
+  \note This call may block if the queue is empty.
+  */
+  template <typename Use>
+  void pop_with (Use && use) {
+    if (!stats_) return pself()->pop_with(invoke_on_slot<Use>, &use);
+    queue_wait_timer timer{empty()};
+    pself()->pop_with(invoke_on_slot<Use>, &use);
+    stats_->record_pop_wait(timer.elapsed());
+    stats_->record_pop();
+  }
+
+  /**
+  \brief Tries to push an element in the queue by move without blocking.
+  \param item Value to be moved into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  \note item is only moved from when the element is pushed.
+  \note In queue_mode::lockfree the call does not wait for room, but may
+  wait for earlier pushes to be published.
+  */
+  bool try_push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value) {
+    auto pushed = pself()->try_push(std::forward<T>(item));
+    if (stats_ && pushed) stats_->record_push();
+    return pushed;
+  }
+
+  /**
+  \brief Tries to push an element in the queue by copy without blocking.
+  \param item Value to be copied into the queue.
+  \return true if the element was pushed, false if the queue was full.
+  */
+  bool try_push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value) {
+    return try_push(T{item});
+  }
+
+  /**
+  \brief Tries to pop an item from the queue without blocking.
+  \param item Variable where the extracted value is moved.
+  \return true if an item was popped, false if the queue was empty.
+  \note In queue_mode::lockfree the call does not wait for items, but may
+  wait for earlier pops to be published.
+  */
+  bool try_pop (T & item) noexcept(std::is_nothrow_move_assignable<T>::value) {
+    auto popped = pself()->try_pop(item);
+    if (stats_ && popped) stats_->record_pop();
+    return popped;
+  }
+
+  /**
+  \brief Pushes an element in the queue by move waiting at most a timeout.
+  \param item Value to be moved into the queue.
+  \param timeout Maximum time to wait.
+  \return true if the element was pushed, false on timeout.
+  \note In queue_mode::lockfree the timeout only bounds the wait for room.
+  */
+  template <typename Rep, typename Period>
+  bool push_for (T && item, std::chrono::duration<Rep,Period> const & timeout) {
+    queue_wait_timer timer{stats_ && full()};
+    auto pushed = pself()->push_until(std::forward<T>(item),
+        std::chrono::steady_clock::now() + 
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+    if (stats_) {
+      stats_->record_push_wait(timer.elapsed());
+      if (pushed) stats_->record_push();
+    }
+    return pushed;
+  }
+
+  /**
+  \brief Pops an item from the queue waiting at most a timeout.
+  \param item Variable where the extracted value is moved.
+  \param timeout Maximum time to wait.
+  \return true if an item was popped, false on timeout.
+  \note In queue_mode::lockfree the timeout only bounds the wait for items.
+  */
+  template <typename Rep, typename Period>
+  bool pop_for (T & item, std::chrono::duration<Rep,Period> const & timeout) {
+    queue_wait_timer timer{stats_ && empty()};
+    auto popped = pself()->pop_until(item,
+        std::chrono::steady_clock::now() + 
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+    if (stats_) {
+      stats_->record_pop_wait(timer.elapsed());
+      if (popped) stats_->record_pop();
+    }
+    return popped;
   }
 
 private:
 
+  /// Type for type erased callables operating on a queue slot.
+  using slot_function = void (*)(void *, T &);
+
+  /// Type for deadlines of timed operations.
+  using deadline_type = std::chrono::steady_clock::time_point;
+
+  /**
+  \brief Invokes a callable passed as a type erased pointer on a slot.
+  */
+  template <typename F>
+  static void invoke_on_slot(void * f, T & slot) {
+    (*static_cast<std::remove_reference_t<F>*>(f))(slot);
+  }
+
   /**
   \brief Interface for polymorphic queue.
   */
   struct base_queue {
     virtual ~base_queue() noexcept = default;
     virtual bool empty() const noexcept = 0;
+    virtual bool full() const noexcept = 0;
     virtual T pop () noexcept(std::is_nothrow_move_constructible<T>::value) = 0;
+    virtual T pop_from (std::size_t consumer)
+        noexcept(std::is_nothrow_move_constructible<T>::value) = 0;
     virtual void push (T && item) noexcept(std::is_nothrow_move_assignable<T>::value) = 0;
-    virtual void push (T const & item) noexcept(std::is_nothrow_copy_assignable<T>::value) = 0;
+    virtual void push_n (T * first, T * last)
+        noexcept(std::is_nothrow_move_assignable<T>::value) = 0;
+    virtual std::size_t pop_n (T * out, std::size_t max)
+        noexcept(std::is_nothrow_move_assignable<T>::value) = 0;
+    virtual void push_with (slot_function fill, void * context) = 0;
+    virtual void pop_with (slot_function use, void * context) = 0;
+    virtual bool try_push (T && item)
+        noexcept(std::is_nothrow_move_assignable<T>::value) = 0;
+    virtual bool try_pop (T & item)
+        noexcept(std::is_nothrow_move_assignable<T>::value) = 0;
+    virtual bool push_until (T && item, deadline_type const & deadline) = 0;
+    virtual bool pop_until (T & item, deadline_type const & deadline) = 0;
+    virtual void move_into(void * buffer) noexcept = 0;
   };
 
   /**
@@ -397,18 +3216,50 @@ private:
   template <typename Q>
   class concrete_queue : public base_queue {
   public:
-    concrete_queue(int size) : queue_{size} {}
+    template <typename ... Args>
+    concrete_queue(Args && ... args) : queue_{std::forward<Args>(args)...} {}
     concrete_queue(const concrete_queue<Q>&) = delete;
     concrete_queue(concrete_queue<Q>&&) = default;
     ~concrete_queue() = default;
     bool empty() const noexcept override { return queue_.empty(); }
+    bool full() const noexcept override { return queue_.full(); }
     T pop () noexcept(std::is_nothrow_move_constructible<T>::value) override
       { return queue_.pop(); }
+    T pop_from (std::size_t consumer)
+        noexcept(std::is_nothrow_move_constructible<T>::value) override
+      { return pop_from_queue(queue_, consumer); }
     void push (T && x) noexcept(std::is_nothrow_move_assignable<T>::value) override
       { queue_.push(std::forward<T>(x)); }
-    void push (T const & x) noexcept(std::is_nothrow_copy_assignable<T>::value) override
-      { queue_.push(x); }
+    void push_n (T * first, T * last)
+        noexcept(std::is_nothrow_move_assignable<T>::value) override
+      { queue_.push_n(first, last); }
+    std::size_t pop_n (T * out, std::size_t max)
+        noexcept(std::is_nothrow_move_assignable<T>::value) override
+      { return queue_.pop_n(out, max); }
+    void push_with (slot_function fill, void * context) override
+      { queue_.push_with([=](T & slot) { fill(context, slot); }); }
+    void pop_with (slot_function use, void * context) override
+      { queue_.pop_with([=](T & slot) { use(context, slot); }); }
+    bool try_push (T && x)
+        noexcept(std::is_nothrow_move_assignable<T>::value) override
+      { return queue_.try_push(std::forward<T>(x)); }
+    bool try_pop (T & x)
+        noexcept(std::is_nothrow_move_assignable<T>::value) override
+      { return queue_.try_pop(x); }
+    bool push_until (T && x, deadline_type const & deadline) override
+      { return queue_.push_until(std::forward<T>(x), deadline); }
+    bool pop_until (T & x, deadline_type const & deadline) override
+      { return queue_.pop_until(x, deadline); }
+    void move_into(void * buffer) noexcept override
+      { new (buffer) concrete_queue{std::move(*this)}; }
   private:
+    template <typename Queue>
+    static T pop_from_queue(Queue & q, std::size_t) { return q.pop(); }
+
+    template <typename Wait>
+    static T pop_from_queue(sharded_mpmc_queue<T,Wait> & q, std::size_t shard)
+      { return q.pop_from(shard); }
+
     Q queue_;
   };
 
@@ -426,40 +3277,92 @@ private:
     return reinterpret_cast<base_queue const*>(&buffer_);
   }
 
-  /// Type for concrete atomic queue.
-  using concrete_atomic_queue = concrete_queue<atomic_mpmc_queue<T>>;
+  /**
+  \brief Constructs in the buffer a queue with a given waiting strategy.
+  \tparam Q Concrete queue template taking an element type and a wait policy.
+  */
+  template <template <typename, typename> class Q, typename ... Args>
+  void construct(queue_wait wait, Args ... args) {
+    switch (wait) {
+      case queue_wait::spin:
+        new (&buffer_) concrete_queue<Q<T,spin_wait>>(args...);
+        break;
+      case queue_wait::backoff:
+        new (&buffer_) concrete_queue<Q<T,backoff_wait>>(args...);
+        break;
+    }
+  }
 
   /// Type for concrete locked queue.
   using concrete_locked_queue = concrete_queue<locked_mpmc_queue<T>>;
 
+  /// Type for concrete unbounded queue.
+  using concrete_unbounded_queue = concrete_queue<unbounded_mpmc_queue<T>>;
+
   /// Buffer that can hold any queue.
   std::aligned_union_t<0,
-      concrete_atomic_queue,
-      concrete_locked_queue> buffer_;
+      concrete_queue<atomic_mpmc_queue<T,spin_wait>>,
+      concrete_queue<atomic_mpmc_queue<T,backoff_wait>>,
+      concrete_locked_queue,
+      concrete_unbounded_queue,
+      concrete_queue<sequenced_mpmc_queue<T,spin_wait>>,
+      concrete_queue<sequenced_mpmc_queue<T,backoff_wait>>,
+      concrete_queue<spsc_queue<T,spin_wait>>,
+      concrete_queue<spsc_queue<T,backoff_wait>>,
+      concrete_queue<sharded_mpmc_queue<T,spin_wait>>,
+      concrete_queue<sharded_mpmc_queue<T,backoff_wait>>> buffer_;
+
+  /// Statistics where operations are recorded (nullptr if disabled).
+  std::shared_ptr<queue_statistics> stats_{};
+
+  /// Credit for the sequence numbers of the items (nullptr if disabled).
+  std::shared_ptr<reorder_credit> credit_{};
 };
 
 template <typename T>
-mpmc_queue<T>::mpmc_queue(int size, queue_mode mode)
+mpmc_queue<T>::mpmc_queue(int size, queue_mode mode, queue_access access,
+    queue_wait wait, std::size_t limit)
 {
+  if (access == queue_access::single &&
+      (mode == queue_mode::lockfree || mode == queue_mode::sequenced))
+  {
+    construct<spsc_queue>(wait, size);
+    return;
+  }
   switch (mode) {
     case queue_mode::lockfree:
-      new (&buffer_) concrete_atomic_queue(size);
+      construct<atomic_mpmc_queue>(wait, size);
       break;
     case queue_mode::blocking:
-      new (&buffer_) concrete_atomic_queue(size);
+      new (&buffer_) concrete_locked_queue(size);
+      break;
+    case queue_mode::sequenced:
+      construct<sequenced_mpmc_queue>(wait, size);
+      break;
+    case queue_mode::unbounded:
+      new (&buffer_) concrete_unbounded_queue(size, limit);
       break;
   }
 }
 
 template <typename T>
-mpmc_queue<T>::mpmc_queue(mpmc_queue && q) 
+mpmc_queue<T>::mpmc_queue(int size, queue_shards shards, queue_wait wait)
 {
-  if (auto * patomic = dynamic_cast<concrete_atomic_queue*>(q.pself())) {
-    new (&buffer_) concrete_atomic_queue{std::move(*patomic)};
-  }
-  else if (auto * plocked = dynamic_cast<concrete_locked_queue*>(q.pself())) {
-    new (&buffer_) concrete_locked_queue{std::move(*plocked)};
-  }
+  construct<sharded_mpmc_queue>(wait, size, shards.count);
+}
+
+template <typename T>
+mpmc_queue<T>::mpmc_queue(mpmc_queue && q) :
+  stats_{std::move(q.stats_)},
+  credit_{std::move(q.credit_)}
+{
+  q.pself()->move_into(&buffer_);
+}
+
+template <typename T>
+mpmc_queue<T>::~mpmc_queue()
+{
+  pself()->~base_queue();
 }
 
 /**
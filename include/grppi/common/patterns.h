@@ -24,6 +24,8 @@
 #include "filter_pattern.h"
 #include "pipeline_pattern.h"
 #include "reduce_pattern.h"
+#include "keyed_reduce_pattern.h"
+#include "time_reduce_pattern.h"
 #include "iteration_pattern.h"
 #include "context.h"
 
@@ -77,6 +79,9 @@ constexpr bool is_no_pattern =
   !is_filter<T> && 
   !is_pipeline<T> &&
   !is_reduce<T> &&
+  !is_reduce_by_key<T> &&
+  !is_keyed_reduce_stream<T> &&
+  !is_reduce_by_time<T> &&
   !is_iteration<T>&&
   !is_context<T>;
 
@@ -89,6 +94,119 @@ using requires_no_pattern = std::enable_if_t<is_no_pattern<T>,int>;
 template <typename T>
 using requires_pattern = std::enable_if_t<is_pattern<T>, int>;
 
+template <typename T>
+class mpmc_queue;
+
+namespace internal {
+
+template <typename Stage>
+struct keeps_order_numbers : std::true_type {};
+
+template <typename ... Stages>
+struct keeps_all_order_numbers : std::true_type {};
+
+template <typename Stage, typename ... Stages>
+struct keeps_all_order_numbers<Stage, Stages...> : std::integral_constant<bool,
+  keeps_order_numbers<std::decay_t<Stage>>::value &&
+  keeps_all_order_numbers<Stages...>::value> {};
+
+template <typename ... Stages>
+struct keeps_order_numbers<pipeline_t<Stages...>> : 
+  keeps_all_order_numbers<Stages...> {};
+
+template <typename C, typename I>
+struct keeps_order_numbers<reduce_t<C,I>> : std::false_type {};
+
+template <typename P>
+struct keeps_order_numbers<filter_t<P>> : std::false_type {};
+
+template <typename K, typename C, typename I>
+struct keeps_order_numbers<reduce_by_key_t<K,C,I>> : std::false_type {};
+
+template <typename R>
+struct keeps_order_numbers<keyed_reduce_stream<R>> : std::false_type {};
+
+template <typename T, typename C, typename I>
+struct keeps_order_numbers<reduce_by_time_t<T,C,I>> : std::false_type {};
+
+template <typename E, typename T>
+struct keeps_order_numbers<context_t<E,T>> : 
+  keeps_order_numbers<std::decay_t<T>> {};
+
+template <typename Stages>
+struct reaches_next_reorder_buffer;
+
+template <typename Stage, typename Next>
+struct reaches_reorder_buffer : std::conditional_t<
+  std::is_same<Next, std::tuple<>>::value,
+  std::true_type,
+  reaches_next_reorder_buffer<Next>> {};
+
+template <>
+struct reaches_next_reorder_buffer<std::tuple<>> : std::false_type {};
+
+template <typename Stage, typename ... Stages>
+struct reaches_next_reorder_buffer<std::tuple<Stage,Stages...>> : 
+  reaches_reorder_buffer<std::decay_t<Stage>, std::tuple<Stages...>> {};
+
+template <typename F, typename Next>
+struct reaches_reorder_buffer<farm_t<F>, Next> : 
+  reaches_next_reorder_buffer<Next> {};
+
+template <typename P, typename Next>
+struct reaches_reorder_buffer<filter_t<P>, Next> : std::true_type {};
+
+template <typename T, typename P, typename Next>
+struct reaches_reorder_buffer<iteration_t<T,P>, Next> : 
+  reaches_next_reorder_buffer<Next> {};
+
+template <typename ... Stages, typename ... Next>
+struct reaches_reorder_buffer<pipeline_t<Stages...>, std::tuple<Next...>> : 
+  reaches_next_reorder_buffer<std::tuple<Stages..., Next...>> {};
+
+template <typename C, typename I, typename Next>
+struct reaches_reorder_buffer<reduce_t<C,I>, Next> : std::false_type {};
+
+template <typename K, typename C, typename I, typename Next>
+struct reaches_reorder_buffer<reduce_by_key_t<K,C,I>, Next> : 
+  std::false_type {};
+
+template <typename R, typename Next>
+struct reaches_reorder_buffer<keyed_reduce_stream<R>, Next> : 
+  std::false_type {};
+
+template <typename T, typename C, typename I, typename Next>
+struct reaches_reorder_buffer<reduce_by_time_t<T,C,I>, Next> : 
+  std::false_type {};
+
+// Items of a context only keep going to the next stages with their
+// sequence numbers when the inner stages do not issue new ones
+template <typename E, typename T, typename Next>
+struct reaches_reorder_buffer<context_t<E,T>, Next> : 
+  reaches_reorder_buffer<std::decay_t<T>, std::conditional_t<
+      keeps_order_numbers<std::decay_t<T>>::value, Next, std::tuple<>>> {};
+
+template <typename T, typename Next>
+struct reaches_reorder_buffer<mpmc_queue<T>, Next> : std::false_type {};
+
+}
+
+/**
+\brief Determines if the items of a stage keep their sequence numbers
+after going through it.
+*/
+template <typename Stage>
+constexpr bool keeps_order_numbers =
+  internal::keeps_order_numbers<std::decay_t<Stage>>::value;
+
+/**
+\brief Determines if items sent to a list of stages reach an ordered
+consumer or filter that releases them with their current sequence numbers.
+*/
+template <typename ... Stages>
+constexpr bool reaches_reorder_buffer =
+  internal::reaches_next_reorder_buffer<std::tuple<Stages...>>::value;
+
 /**
 \brief Determines the return type after applying a list of
 transformers (stages) on a input type
@@ -102,7 +220,7 @@ struct stage_return_type{
 \brief Determines the return type of applying a function on a input type.
 */
 template <typename Input, typename Transformer>
-using result_type = typename std::result_of<Transformer(Input)>::type; 
+using result_type = item_result_t<Transformer,Input>; 
 
 /**
 \brief Determines the return type of applying a function on a input type.
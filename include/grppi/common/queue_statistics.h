@@ -0,0 +1,199 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_QUEUE_STATISTICS_H
+#define GRPPI_COMMON_QUEUE_STATISTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace grppi {
+
+/**
+\addtogroup communication
+@{
+*/
+
+/**
+\brief Snapshot of the counters of a queue.
+*/
+struct queue_counters {
+  /// Number of elements pushed.
+  unsigned long long pushes = 0;
+  /// Number of elements popped.
+  unsigned long long pops = 0;
+  /// Maximum number of elements observed in the queue.
+  unsigned long long high_water_mark = 0;
+  /// Time spent by producers blocked on a full queue.
+  std::chrono::nanoseconds push_wait{0};
+  /// Time spent by consumers blocked on an empty queue.
+  std::chrono::nanoseconds pop_wait{0};
+};
+
+/**
+\brief Counters of a queue updated by concurrent producers and consumers.
+Counters are relaxed atomics, so that the occupancy derived from them is an
+approximation while the queue is in use.
+*/
+class queue_statistics {
+public:
+
+  /**
+  \brief Records pushed elements.
+  \param n Number of pushed elements.
+  */
+  void record_push(unsigned long long n = 1) noexcept {
+    auto pushed = pushes_.fetch_add(n, std::memory_order_relaxed) + n;
+    auto popped = pops_.load(std::memory_order_relaxed);
+    if (pushed <= popped) return;
+    auto occupancy = pushed - popped;
+    auto mark = high_water_mark_.load(std::memory_order_relaxed);
+    while (occupancy > mark &&
+        !high_water_mark_.compare_exchange_weak(mark, occupancy,
+            std::memory_order_relaxed)) {}
+  }
+
+  /**
+  \brief Records popped elements.
+  \param n Number of popped elements.
+  */
+  void record_pop(unsigned long long n = 1) noexcept {
+    pops_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /**
+  \brief Records time spent by a producer waiting on a full queue.
+  */
+  void record_push_wait(std::chrono::nanoseconds t) noexcept {
+    push_wait_.fetch_add(t.count(), std::memory_order_relaxed);
+  }
+
+  /**
+  \brief Records time spent by a consumer waiting on an empty queue.
+  */
+  void record_pop_wait(std::chrono::nanoseconds t) noexcept {
+    pop_wait_.fetch_add(t.count(), std::memory_order_relaxed);
+  }
+
+  /**
+  \brief Gets a snapshot of the counters.
+  */
+  queue_counters counters() const noexcept {
+    queue_counters c;
+    c.pushes = pushes_.load(std::memory_order_relaxed);
+    c.pops = pops_.load(std::memory_order_relaxed);
+    c.high_water_mark = high_water_mark_.load(std::memory_order_relaxed);
+    c.push_wait = std::chrono::nanoseconds{
+        push_wait_.load(std::memory_order_relaxed)};
+    c.pop_wait = std::chrono::nanoseconds{
+        pop_wait_.load(std::memory_order_relaxed)};
+    return c;
+  }
+
+private:
+  std::atomic<unsigned long long> pushes_{0};
+  std::atomic<unsigned long long> pops_{0};
+  std::atomic<unsigned long long> high_water_mark_{0};
+  std::atomic<std::chrono::nanoseconds::rep> push_wait_{0};
+  std::atomic<std::chrono::nanoseconds::rep> pop_wait_{0};
+};
+
+/**
+\brief Timer measuring how long an operation waits on a queue.
+The clock is only read when the queue was not ready on entry, so that
+operations taking the fast path do not pay for timing.
+*/
+class queue_wait_timer {
+public:
+
+  /**
+  \brief Starts the timer.
+  \param active true if the operation may need to wait.
+  */
+  explicit queue_wait_timer(bool active) noexcept :
+    active_{active},
+    start_{active ? std::chrono::steady_clock::now() :
+        std::chrono::steady_clock::time_point{}}
+  {}
+
+  /**
+  \brief Gets the time elapsed since the timer was started.
+  \return Elapsed time, or zero if the timer is not active.
+  */
+  std::chrono::nanoseconds elapsed() const noexcept {
+    if (!active_) return std::chrono::nanoseconds{0};
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_);
+  }
+
+private:
+  bool active_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+\brief Set of statistics for the queues created by an execution policy.
+Statistics outlive their queues, so that they can be queried after a run.
+*/
+class queue_statistics_registry {
+public:
+
+  /**
+  \brief Adds statistics for a new queue.
+  \return Shared pointer to the statistics of the queue.
+  */
+  std::shared_ptr<queue_statistics> add() {
+    auto stats = std::make_shared<queue_statistics>();
+    std::lock_guard<std::mutex> lk{mut_};
+    stats_.push_back(stats);
+    return stats;
+  }
+
+  /**
+  \brief Gets a snapshot of the counters of every queue in creation order.
+  */
+  std::vector<queue_counters> counters() const {
+    std::lock_guard<std::mutex> lk{mut_};
+    std::vector<queue_counters> result;
+    result.reserve(stats_.size());
+    for (auto & s : stats_) {
+      result.push_back(s->counters());
+    }
+    return result;
+  }
+
+  /**
+  \brief Removes the statistics of every queue.
+  */
+  void clear() {
+    std::lock_guard<std::mutex> lk{mut_};
+    stats_.clear();
+  }
+
+private:
+  mutable std::mutex mut_{};
+  std::vector<std::shared_ptr<queue_statistics>> stats_{};
+};
+
+/**
+@}
+*/
+
+}
+
+#endif
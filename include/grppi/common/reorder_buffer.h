@@ -0,0 +1,250 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_REORDER_BUFFER_H
+#define GRPPI_COMMON_REORDER_BUFFER_H
+
+#include "optional.h"
+#include "wait_policy.h"
+
+#include <vector>
+#include <cstddef>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+
+namespace grppi {
+
+/**
+\addtogroup communication
+@{
+*/
+
+/**
+\brief Buffer restoring the order of a stream of items with sequence numbers.
+
+Items are inserted in any order and released in increasing order of their
+sequence numbers, with no gaps. Each item is stored in the slot
+`order % capacity`, so that inserting and releasing an item takes constant
+time.
+
+The capacity bounds the distance between the next item to be released and
+any buffered item, and the buffer never grows. Stages issuing sequence
+numbers keep their items within that distance through a reorder_credit
+handed back by the thread releasing the items.
+\tparam T Type of the buffered items.
+*/
+template <typename T>
+class reorder_buffer {
+public:
+
+  using value_type = T;
+
+  /**
+  \brief Constructs an empty buffer.
+  \param capacity Capacity of the buffer (rounded up to a power of two).
+  \param first Sequence number of the first item to be released.
+  */
+  explicit reorder_buffer(std::size_t capacity, long first = 0);
+
+  /**
+  \brief Inserts an item.
+  \param order Sequence number of the item.
+  \param item Item to be inserted.
+  \pre order is not lower than next() and has not been inserted yet.
+  \pre order - next() is lower than capacity().
+  */
+  void insert(long order, T && item);
+
+  /**
+  \brief Checks if the next item in sequence is available.
+  */
+  bool ready() const noexcept {
+    return static_cast<bool>(slots_[index(next_)]);
+  }
+
+  /**
+  \brief Releases the next item in sequence.
+  \pre ready() is true.
+  \return The released item.
+  */
+  T release();
+
+  /**
+  \brief Releases every available item that follows the last released one.
+  \param consume Callable invoked with each released item in sequence order.
+  \return Number of released items.
+  */
+  template <typename Consumer>
+  std::size_t release_ready(Consumer && consume);
+
+  /**
+  \brief Sequence number of the next item to be released.
+  */
+  long next() const noexcept { return next_; }
+
+  /**
+  \brief Number of buffered items.
+  */
+  std::size_t size() const noexcept { return count_; }
+
+  /**
+  \brief Checks if the buffer has no items.
+  */
+  bool empty() const noexcept { return count_ == 0; }
+
+  /**
+  \brief Capacity of the buffer.
+  */
+  std::size_t capacity() const noexcept { return slots_.size(); }
+
+private:
+  std::size_t index(long order) const noexcept {
+    return static_cast<std::size_t>(order) & (slots_.size() - 1);
+  }
+
+private:
+  std::vector<grppi::optional<T>> slots_;
+  long next_;
+  std::size_t count_ = 0;
+};
+
+/**
+\brief Credit bounding how far ahead of a reorder_buffer items are issued.
+
+The thread releasing items from a reorder_buffer publishes the sequence
+number of the next item to be released. A stage issuing sequence numbers
+acquires each one before sending its item, and only waits while the item
+is at a distance of capacity or more from the published number. As the
+published number only grows, acquiring is a single atomic load unless the
+issuer is that far ahead.
+*/
+class reorder_credit {
+public:
+
+  /**
+  \brief Constructs a credit where no item has been released yet.
+  \param capacity Maximum distance between an issued item and the next item
+  to be released.
+  */
+  explicit reorder_credit(std::size_t capacity) noexcept :
+    capacity_{static_cast<long>(capacity)}
+  {}
+
+  /**
+  \brief Checks if a sequence number can be issued without waiting.
+  \param order Sequence number of the item to be issued.
+  */
+  bool available(long order) const noexcept {
+    return order - released_.load(std::memory_order_acquire) < capacity_;
+  }
+
+  /**
+  \brief Waits until a sequence number can be issued.
+  \param order Sequence number of the item to be issued.
+  \param cancelled Predicate checked while waiting, that abandons waiting
+  when it returns true.
+  */
+  template <typename Cancelled>
+  void acquire(long order, Cancelled && cancelled);
+
+  /**
+  \brief Hands back the credit of the items that have been released.
+  \param next Sequence number of the next item to be released.
+  */
+  void release(long next) noexcept {
+    released_.store(next, std::memory_order_release);
+    wait_.notify();
+  }
+
+  /**
+  \brief Maximum distance between an issued item and the next item to be
+  released.
+  */
+  std::size_t capacity() const noexcept {
+    return static_cast<std::size_t>(capacity_);
+  }
+
+private:
+  const long capacity_;
+  std::atomic<long> released_{0};
+  backoff_wait wait_{};
+};
+
+/**
+@}
+*/
+
+template <typename T>
+reorder_buffer<T>::reorder_buffer(std::size_t capacity, long first) :
+  slots_{},
+  next_{first}
+{
+  std::size_t c = 1;
+  while (c < capacity) { c <<= 1; }
+  slots_.resize(c);
+}
+
+template <typename T>
+void reorder_buffer<T>::insert(long order, T && item)
+{
+  assert(order >= next_ && order - next_ < static_cast<long>(slots_.size()));
+  slots_[index(order)].emplace(std::move(item));
+  count_++;
+}
+
+template <typename T>
+T reorder_buffer<T>::release()
+{
+  auto & slot = slots_[index(next_)];
+  T item{std::move(*slot)};
+  slot = grppi::optional<T>{};
+  count_--;
+  next_++;
+  return item;
+}
+
+template <typename T>
+template <typename Consumer>
+std::size_t reorder_buffer<T>::release_ready(Consumer && consume)
+{
+  std::size_t released = 0;
+  for (;;) {
+    auto & slot = slots_[index(next_)];
+    if (!slot) return released;
+    consume(*slot);
+    slot = grppi::optional<T>{};
+    count_--;
+    next_++;
+    released++;
+  }
+}
+
+template <typename Cancelled>
+void reorder_credit::acquire(long order, Cancelled && cancelled)
+{
+  if (available(order)) return;
+  // Cancellation is checked periodically as nobody notifies it
+  auto fits = [&] { return available(order); };
+  while (!wait_.wait_until(fits,
+      std::chrono::steady_clock::now() + std::chrono::milliseconds{1}))
+  {
+    if (cancelled()) return;
+  }
+}
+
+}
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_SAMPLE_SORT_H
+#define GRPPI_COMMON_SAMPLE_SORT_H
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <utility>
+
+namespace grppi {
+
+namespace detail {
+
+/**
+\brief Computes the number of blocks for a sample sort.
+Blocks are sized to fit in a cache of cache_bytes, with at least one block
+per thread and not much more than a few blocks per thread, as splitters and
+bucket bounds grow with the square of the number of blocks.
+*/
+template <typename T>
+std::size_t sample_sort_blocks(std::size_t size, std::size_t nthreads,
+                               std::size_t cache_bytes)
+{
+  constexpr std::size_t min_block_size = 1024;
+  const auto by_cache = (size * sizeof(T) + cache_bytes - 1) / cache_bytes;
+  auto nblocks = std::min(std::max(nthreads, by_cache), 8 * nthreads);
+  return std::min(nblocks, size / min_block_size);
+}
+
+/**
+\brief Merges pairs of consecutive sorted runs from src into dst.
+Each merge is split in pieces so that every round has about as many
+independent tasks as runs, even when only two runs are left.
+\param runs Bounds of the sorted runs. Updated with the merged runs.
+*/
+template <typename SourceIt, typename DestIt, typename Compare,
+          typename ParallelFor>
+void merge_runs(SourceIt src, DestIt dst, std::vector<std::size_t> & runs,
+                Compare & comp, std::size_t ntasks, ParallelFor & parallel_for)
+{
+  const auto nruns = runs.size() - 1;
+  const auto npairs = (nruns + 1) / 2;
+  const auto npieces = std::max<std::size_t>(1, ntasks / npairs);
+
+  parallel_for(npairs * npieces, [&](std::size_t task) {
+    const auto pair = task / npieces;
+    const auto piece = task % npieces;
+    const auto a_first = runs[2*pair];
+    const auto a_last = runs[2*pair+1];
+    if (2*pair+1 == nruns) {
+      // Odd run without pair is moved by its first piece
+      if (piece == 0) {
+        std::move(src + a_first, src + a_last, dst + a_first);
+      }
+      return;
+    }
+    const auto b_first = a_last;
+    const auto b_last = runs[2*pair+2];
+
+    // Splits the longer run evenly and the other one by searching
+    auto split = [&](std::size_t p) {
+      if (p == 0) return std::make_pair(a_first, b_first);
+      if (p == npieces) return std::make_pair(a_last, b_last);
+      if (a_last - a_first >= b_last - b_first) {
+        const auto i = a_first + (a_last - a_first) * p / npieces;
+        const auto j = std::lower_bound(src + b_first, src + b_last,
+            src[i], comp) - src;
+        return std::make_pair(i, static_cast<std::size_t>(j));
+      }
+      else {
+        const auto j = b_first + (b_last - b_first) * p / npieces;
+        const auto i = std::lower_bound(src + a_first, src + a_last,
+            src[j], comp) - src;
+        return std::make_pair(static_cast<std::size_t>(i), j);
+      }
+    };
+
+    const auto from = split(piece);
+    const auto to = split(piece + 1);
+    const auto out = a_first + (from.first - a_first) + (from.second - b_first);
+    std::merge(
+        std::make_move_iterator(src + from.first),
+        std::make_move_iterator(src + to.first),
+        std::make_move_iterator(src + from.second),
+        std::make_move_iterator(src + to.second),
+        dst + out, comp);
+  });
+
+  std::vector<std::size_t> merged;
+  merged.reserve(npairs + 1);
+  for (std::size_t i=0; i<nruns; i+=2) { merged.push_back(runs[i]); }
+  merged.push_back(runs.back());
+  runs.swap(merged);
+}
+
+}
+
+/**
+\brief Sorts a sequence in parallel with a sample sort.
+
+The sequence is moved to an auxiliary buffer, split in blocks that fit in
+cache, and each block is sorted in parallel. Regular samples from the
+sorted blocks select the splitters of the buckets, and the bounds of every
+bucket in every block are found by binary search. Blocks are then scattered
+back to the sequence, where each bucket is sorted in parallel.
+
+When duplicated keys make buckets too unbalanced, the sorted blocks are
+instead merged in parallel rounds, alternating between the buffer and the
+sequence. Either way, the auxiliary buffer is the only extra storage
+proportional to the sequence size.
+
+\tparam RandomIt Random access iterator type of the sequence.
+\tparam Compare Callable type for the comparison.
+\tparam ParallelFor Callable type for the parallel loop.
+\param first Iterator to the first element of the sequence.
+\param last Iterator to one past the end of the sequence.
+\param comp Comparison callable object.
+\param nthreads Number of threads available to parallel_for.
+\param parallel_for Operation taking a number of iterations n and a
+callable, that invokes the callable for each index in [0,n).
+\param cache_bytes Size of the cache that a block should fit in.
+*/
+template <typename RandomIt, typename Compare, typename ParallelFor>
+void sample_sort(RandomIt first, RandomIt last, Compare && comp,
+                 std::size_t nthreads, ParallelFor && parallel_for,
+                 std::size_t cache_bytes = 256 * 1024)
+{
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  const auto size = static_cast<std::size_t>(std::distance(first, last));
+  const auto nblocks =
+      detail::sample_sort_blocks<value_type>(size, nthreads, cache_bytes);
+  if (nblocks < 2) {
+    std::sort(first, last, comp);
+    return;
+  }
+
+  std::vector<value_type> buffer(std::make_move_iterator(first),
+      std::make_move_iterator(last));
+  const auto buf = buffer.begin();
+
+  std::vector<std::size_t> blocks(nblocks + 1);
+  for (std::size_t b=0; b<nblocks; ++b) { blocks[b] = size * b / nblocks; }
+  blocks[nblocks] = size;
+
+  parallel_for(nblocks, [&](std::size_t b) {
+    std::sort(buf + blocks[b], buf + blocks[b+1], comp);
+  });
+
+  // Regular samples from every sorted block select the splitters
+  const auto nsplitters = nblocks - 1;
+  std::vector<std::size_t> samples;
+  samples.reserve(nblocks * nsplitters);
+  for (std::size_t b=0; b<nblocks; ++b) {
+    const auto length = blocks[b+1] - blocks[b];
+    for (std::size_t k=1; k<nblocks; ++k) {
+      samples.push_back(blocks[b] + length * k / nblocks);
+    }
+  }
+  std::sort(samples.begin(), samples.end(),
+      [&](std::size_t x, std::size_t y) { return comp(buf[x], buf[y]); });
+  std::vector<std::size_t> splitters(nsplitters);
+  for (std::size_t k=0; k<nsplitters; ++k) {
+    splitters[k] = samples[(k+1) * samples.size() / nblocks];
+  }
+
+  // Bounds of every bucket in every block
+  const auto stride = nblocks + 1;
+  std::vector<std::size_t> cuts(nblocks * stride);
+  parallel_for(nblocks, [&](std::size_t b) {
+    auto * block_cuts = &cuts[b * stride];
+    block_cuts[0] = blocks[b];
+    block_cuts[nblocks] = blocks[b+1];
+    for (std::size_t k=1; k<nblocks; ++k) {
+      block_cuts[k] = std::lower_bound(buf + block_cuts[k-1],
+          buf + blocks[b+1], buf[splitters[k-1]], comp) - buf;
+    }
+  });
+
+  // Position of every bucket of every block in the sorted sequence
+  std::vector<std::size_t> buckets(nblocks + 1, 0);
+  std::vector<std::size_t> targets(nblocks * nblocks);
+  std::size_t largest = 0;
+  for (std::size_t k=0; k<nblocks; ++k) {
+    auto position = buckets[k];
+    for (std::size_t b=0; b<nblocks; ++b) {
+      targets[b * nblocks + k] = position;
+      position += cuts[b*stride + k + 1] - cuts[b*stride + k];
+    }
+    buckets[k+1] = position;
+    largest = std::max(largest, position - buckets[k]);
+  }
+
+  if (largest > 2 * size / nblocks) {
+    // Too many duplicated keys: merge the sorted blocks
+    bool in_buffer = true;
+    while (blocks.size() > 2) {
+      if (in_buffer) {
+        detail::merge_runs(buf, first, blocks, comp, nblocks, parallel_for);
+      }
+      else {
+        detail::merge_runs(first, buf, blocks, comp, nblocks, parallel_for);
+      }
+      in_buffer = !in_buffer;
+    }
+    if (in_buffer) {
+      parallel_for(nblocks, [&](std::size_t b) {
+        const auto from = size * b / nblocks;
+        const auto to = size * (b+1) / nblocks;
+        std::move(buf + from, buf + to, first + from);
+      });
+    }
+    return;
+  }
+
+  parallel_for(nblocks, [&](std::size_t b) {
+    for (std::size_t k=0; k<nblocks; ++k) {
+      std::move(buf + cuts[b*stride + k], buf + cuts[b*stride + k + 1],
+          first + targets[b * nblocks + k]);
+    }
+  });
+
+  parallel_for(nblocks, [&](std::size_t k) {
+    std::sort(first + buckets[k], first + buckets[k+1], comp);
+  });
+}
+
+}
+
+#endif
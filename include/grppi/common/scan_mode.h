@@ -0,0 +1,33 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_SCAN_MODE_H
+#define GRPPI_COMMON_SCAN_MODE_H
+
+namespace grppi {
+
+/**
+\brief Kind of prefix computed by a scan.
+*/
+enum class scan_mode {
+  /// Element i of the output combines input elements [0,i].
+  inclusive,
+  /// Element i of the output combines input elements [0,i).
+  exclusive
+};
+
+}
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_TIME_REDUCE_PATTERN_H
+#define GRPPI_COMMON_TIME_REDUCE_PATTERN_H
+
+#include <map>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace grppi {
+
+/**
+\brief Timestamp extractor giving the arrival time of an item.
+Used by time based reductions over processing time.
+*/
+struct processing_time {
+  template <typename Item>
+  std::chrono::milliseconds operator()(const Item &) const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+  }
+};
+
+/**
+\brief Representation of a time based reduce pattern.
+Represents a reduction of the items falling in windows of time, that can be
+used as a stage on a pipeline. Window k spans the timestamps in
+[k*slide, k*slide+window).
+
+Every window only keeps its partial result, combined as items arrive, so
+the state is bounded by the number of overlapping windows and does not
+depend on the input rate. A window is reduced once the watermark passes its
+end. The watermark is the largest timestamp seen, advanced by the time
+elapsed since the last arrival when the input goes quiet. Items arriving
+for windows already reduced are discarded. At the end of the stream, the
+windows still open are reduced by flush().
+\tparam Timestamper Callable type returning the timestamp of an item.
+\tparam Combiner Callable type combining a result with an item.
+\tparam Identity Identity value for the combiner.
+*/
+template <typename Timestamper, typename Combiner, typename Identity>
+class reduce_by_time_t {
+public:
+
+  using result_type = std::decay_t<Identity>;
+
+  /**
+  \brief Construct a time based reduction pattern object.
+  \param window Duration of every window.
+  \param slide Time between window starts. Windows are tumbling when equal
+  to the window duration.
+  \param timestamp_op Timestamp extractor.
+  \param id Identity value.
+  \param combine_op Combiner used for the reduction.
+  */
+  reduce_by_time_t(std::chrono::milliseconds window,
+                   std::chrono::milliseconds slide,
+                   Timestamper && timestamp_op, Identity id,
+                   Combiner && combine_op) :
+    window_{std::max<long long>(1, window.count())},
+    slide_{slide.count() > 0 ? slide.count() : window_},
+    timestamper_{std::forward<Timestamper>(timestamp_op)},
+    identity_{id}, combiner_{std::forward<Combiner>(combine_op)}
+  {}
+
+  /**
+  \brief Get the time between window starts.
+  Backends waiting for items should not wait longer than this before
+  advancing the watermark with advance().
+  */
+  std::chrono::milliseconds slide() const noexcept {
+    return std::chrono::milliseconds{slide_};
+  }
+
+  /**
+  \brief Adds an item to the windows spanning its timestamp.
+  Then reduces the windows passed by the watermark.
+  \param item Item to be added.
+  \param emit_op Callable invoked with the result of every reduced window.
+  */
+  template <typename Item, typename Emitter>
+  void add_item(const Item & item, Emitter && emit_op);
+
+  /**
+  \brief Advances the watermark by the time elapsed since the last arrival.
+  Then reduces the windows passed by the watermark.
+  \param now Current time.
+  \param emit_op Callable invoked with the result of every reduced window.
+  */
+  template <typename Emitter>
+  void advance(std::chrono::steady_clock::time_point now, Emitter && emit_op);
+
+  /**
+  \brief Reduces every open window at the end of the stream.
+  The watermark is then reset, so that a new stream may be processed.
+  \param emit_op Callable invoked with the result of every reduced window.
+  */
+  template <typename Emitter>
+  void flush(Emitter && emit_op);
+
+  /**
+  \brief Number of windows with a partial result.
+  */
+  std::size_t open_windows() const noexcept { return windows_.size(); }
+
+private:
+  template <typename Emitter>
+  void close(long long watermark, Emitter && emit_op);
+
+  static long long floor_div(long long x, long long y) noexcept {
+    return x / y - ((x % y != 0) && ((x < 0) != (y < 0)));
+  }
+
+private:
+  long long window_;
+  long long slide_;
+  std::decay_t<Timestamper> timestamper_;
+  result_type identity_;
+  std::decay_t<Combiner> combiner_;
+
+  // Partial result of every open window, by window index
+  std::map<long long, result_type> windows_{};
+  bool started_ = false;
+  long long max_time_ = 0;
+  long long watermark_ = std::numeric_limits<long long>::min();
+  std::chrono::steady_clock::time_point last_arrival_{};
+};
+
+template <typename Timestamper, typename Combiner, typename Identity>
+template <typename Item, typename Emitter>
+void reduce_by_time_t<Timestamper,Combiner,Identity>::add_item(
+    const Item & item, Emitter && emit_op)
+{
+  using namespace std::chrono;
+  const auto now = steady_clock::now();
+  const long long t = duration_cast<milliseconds>(timestamper_(item)).count();
+
+  // Windows k with k*slide <= t < k*slide + window
+  const auto last = floor_div(t, slide_);
+  for (auto k = floor_div(t - window_, slide_) + 1; k <= last; ++k) {
+    if (k * slide_ + window_ <= watermark_) continue;
+    auto it = windows_.find(k);
+    if (it == windows_.end()) {
+      it = windows_.emplace(k, identity_).first;
+    }
+    it->second = combiner_(it->second, item);
+  }
+
+  if (!started_ || t > max_time_) max_time_ = t;
+  started_ = true;
+  last_arrival_ = now;
+  close(max_time_, std::forward<Emitter>(emit_op));
+}
+
+template <typename Timestamper, typename Combiner, typename Identity>
+template <typename Emitter>
+void reduce_by_time_t<Timestamper,Combiner,Identity>::advance(
+    std::chrono::steady_clock::time_point now, Emitter && emit_op)
+{
+  using namespace std::chrono;
+  if (!started_) return;
+  const auto idle = duration_cast<milliseconds>(now - last_arrival_).count();
+  close(max_time_ + std::max<long long>(0, idle),
+      std::forward<Emitter>(emit_op));
+}
+
+template <typename Timestamper, typename Combiner, typename Identity>
+template <typename Emitter>
+void reduce_by_time_t<Timestamper,Combiner,Identity>::flush(
+    Emitter && emit_op)
+{
+  close(std::numeric_limits<long long>::max(),
+      std::forward<Emitter>(emit_op));
+  started_ = false;
+  max_time_ = 0;
+  watermark_ = std::numeric_limits<long long>::min();
+}
+
+template <typename Timestamper, typename Combiner, typename Identity>
+template <typename Emitter>
+void reduce_by_time_t<Timestamper,Combiner,Identity>::close(
+    long long watermark, Emitter && emit_op)
+{
+  watermark_ = std::max(watermark_, watermark);
+  while (!windows_.empty() &&
+         windows_.begin()->first * slide_ + window_ <= watermark_) {
+    auto result = std::move(windows_.begin()->second);
+    windows_.erase(windows_.begin());
+    emit_op(std::move(result));
+  }
+}
+
+namespace internal {
+
+template<typename T>
+struct is_reduce_by_time : std::false_type {};
+
+template <typename T, typename C, typename I>
+struct is_reduce_by_time<reduce_by_time_t<T,C,I>> :std::true_type {};
+
+}
+
+template <typename T>
+constexpr bool is_reduce_by_time =
+    internal::is_reduce_by_time<std::decay_t<T>>();
+
+template <typename T>
+using requires_reduce_by_time = std::enable_if_t<is_reduce_by_time<T>,int>;
+
+} // end namespace grppi
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_TREE_COMBINE_H
+#define GRPPI_COMMON_TREE_COMBINE_H
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace grppi {
+
+/**
+\brief Combines partial results in a binary tree.
+
+Partial results are combined pairwise in log2(n) rounds. In each round
+the pairs are independent and are combined through parallel_for. Each
+pair combines its left and right elements in that order, so the result
+only requires an associative combiner.
+
+\tparam T Type of the partial results.
+\tparam Combiner Callable type for the combination.
+\tparam ParallelFor Callable type for the parallel loop.
+\param partials Partial results. They are overwritten.
+\param combine_op Combiner operation.
+\param parallel_for Operation taking a number of iterations n and a
+callable, that invokes the callable for each index in [0,n).
+\pre partials is not empty.
+\return The combination of all the partial results.
+*/
+template <typename T, typename Combiner, typename ParallelFor>
+T tree_combine(std::vector<T> & partials, Combiner && combine_op,
+               ParallelFor && parallel_for)
+{
+  const auto size = partials.size();
+  for (std::size_t stride = 1; stride < size; stride *= 2) {
+    const auto npairs = (size - stride + 2*stride - 1) / (2*stride);
+    auto combine_pair = [&partials, &combine_op, stride](std::size_t k) {
+      const auto i = 2 * stride * k;
+      partials[i] = combine_op(partials[i], partials[i+stride]);
+    };
+    if (npairs == 1) {
+      combine_pair(0);
+    }
+    else {
+      parallel_for(npairs, combine_pair);
+    }
+  }
+  return std::move(partials[0]);
+}
+
+}
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_COMMON_WAIT_POLICY_H
+#define GRPPI_COMMON_WAIT_POLICY_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace grppi {
+
+/**
+\addtogroup communication
+@{
+*/
+
+/**
+\brief Waiting strategy used by lock-free queues.
+*/
+enum class queue_wait {
+  /// Busy waiting until the queue is ready.
+  spin,
+  /// Bounded spinning, then yielding and finally parking the thread.
+  backoff
+};
+
+namespace internal {
+
+/**
+\brief Hints the processor that the calling thread is spinning.
+*/
+inline void cpu_relax() noexcept {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_ia32_pause();
+#endif
+}
+
+} // namespace internal
+
+/**
+\brief Wait policy that busy waits until a condition holds.
+*/
+class spin_wait {
+public:
+
+  /**
+  \brief Waits until a condition holds.
+  \param ready Predicate to be evaluated until it returns true.
+  */
+  template <typename Predicate>
+  void wait_until(Predicate && ready) noexcept {
+    while (!ready()) {}
+  }
+
+  /**
+  \brief Waits until a condition holds or a deadline is reached.
+  \param ready Predicate to be evaluated until it returns true.
+  \param deadline Time point after which waiting is abandoned.
+  \return The last value returned by ready.
+  */
+  template <typename Predicate, typename Clock, typename Duration>
+  bool wait_until(Predicate && ready,
+      std::chrono::time_point<Clock,Duration> const & deadline) noexcept
+  {
+    while (!ready()) {
+      if (Clock::now() >= deadline) return ready();
+      internal::cpu_relax();
+    }
+    return true;
+  }
+
+  /**
+  \brief Notifies waiting threads that the condition may hold.
+  \note Spinning threads need no notification.
+  */
+  void notify() noexcept {}
+};
+
+/**
+\brief Wait policy that spins for a bounded time, then yields and finally
+parks the waiting thread.
+
+Parked threads sleep on an event count. A notifier only takes the lock when
+there is at least one parked thread, so notifications are cheap when
+nobody waits.
+*/
+class backoff_wait {
+public:
+
+  backoff_wait() noexcept = default;
+
+  /**
+  \brief Move constructs a wait policy.
+  \pre No thread may be waiting on the policy being moved.
+  */
+  backoff_wait(backoff_wait &&) noexcept : backoff_wait{} {}
+
+  backoff_wait & operator=(backoff_wait &&) = delete;
+  backoff_wait(backoff_wait const &) = delete;
+  backoff_wait & operator=(backoff_wait const &) = delete;
+
+  /**
+  \brief Waits until a condition holds.
+  \param ready Predicate to be evaluated until it returns true.
+  */
+  template <typename Predicate>
+  void wait_until(Predicate && ready) noexcept;
+
+  /**
+  \brief Waits until a condition holds or a deadline is reached.
+  \param ready Predicate to be evaluated until it returns true.
+  \param deadline Time point after which waiting is abandoned.
+  \return The last value returned by ready.
+  */
+  template <typename Predicate, typename Clock, typename Duration>
+  bool wait_until(Predicate && ready,
+      std::chrono::time_point<Clock,Duration> const & deadline) noexcept;
+
+  /**
+  \brief Notifies waiting threads that the condition may hold.
+  \note Must be called after the change that may make the condition hold.
+  */
+  void notify() noexcept;
+
+  /// Number of spinning iterations before yielding.
+  constexpr static int spin_limit = 128;
+
+  /// Number of yielding iterations before parking.
+  constexpr static int yield_limit = 16;
+
+private:
+  /// Number of parked or about to park threads.
+  std::atomic<int> waiters_{0};
+
+  /// Event counter incremented on every notification to parked threads.
+  std::atomic<unsigned long long> epoch_{0};
+
+  /// Mutex protecting parking.
+  std::mutex mut_{};
+
+  /// Condition variable where threads are parked.
+  std::condition_variable parked_{};
+};
+
+template <typename Predicate>
+void backoff_wait::wait_until(Predicate && ready) noexcept
+{
+  for (int i=0; i<spin_limit; ++i) {
+    if (ready()) return;
+    internal::cpu_relax();
+  }
+  for (int i=0; i<yield_limit; ++i) {
+    if (ready()) return;
+    std::this_thread::yield();
+  }
+  for (;;) {
+    waiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto epoch = epoch_.load();
+    if (ready()) {
+      waiters_.fetch_sub(1);
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lk{mut_};
+      parked_.wait(lk, [&] { return epoch_.load() != epoch; });
+    }
+    waiters_.fetch_sub(1);
+    if (ready()) return;
+  }
+}
+
+template <typename Predicate, typename Clock, typename Duration>
+bool backoff_wait::wait_until(Predicate && ready,
+    std::chrono::time_point<Clock,Duration> const & deadline) noexcept
+{
+  for (int i=0; i<spin_limit; ++i) {
+    if (ready()) return true;
+    internal::cpu_relax();
+  }
+  for (int i=0; i<yield_limit; ++i) {
+    if (ready()) return true;
+    if (Clock::now() >= deadline) return false;
+    std::this_thread::yield();
+  }
+  for (;;) {
+    waiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto epoch = epoch_.load();
+    if (ready()) {
+      waiters_.fetch_sub(1);
+      return true;
+    }
+    bool notified;
+    {
+      std::unique_lock<std::mutex> lk{mut_};
+      notified = parked_.wait_until(lk, deadline,
+          [&] { return epoch_.load() != epoch; });
+    }
+    waiters_.fetch_sub(1);
+    if (ready()) return true;
+    if (!notified) return false;
+  }
+}
+
+inline void backoff_wait::notify() noexcept
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiters_.load(std::memory_order_relaxed) == 0) return;
+  {
+    std::lock_guard<std::mutex> lk{mut_};
+    epoch_++;
+  }
+  parked_.notify_all();
+}
+
+/**
+@}
+*/
+
+}
+
+#endif
@@ -116,6 +116,62 @@ public:
           Identity && identity,
           Transformer && transform_op, Combiner && combine_op) const;
 
+  /**
+  \brief Applies a map/reduce by key operation to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam KeyTransformer Callable object type for the key operation.
+  \tparam ValueTransformer Callable object type for the value operation.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param key_op Key callable object.
+  \param value_op Value callable object.
+  \param combine_op Combination callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \return A vector of pairs with every key and its combined value.
+  */
+  template <typename InputIterator, typename KeyTransformer,
+            typename ValueTransformer, typename Combiner>
+  auto map_reduce_by_key(InputIterator first, std::size_t sequence_size,
+                         KeyTransformer && key_op,
+                         ValueTransformer && value_op,
+                         Combiner && combine_op) const;
+
+  /**
+  \brief Applies a scan to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam OutputIterator Iterator type for the output sequence.
+  \tparam Identity Type for the identity value.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param first_out Iterator to the first element of the output sequence.
+  \param identity Identity value for the combination.
+  \param combine_op Combination callable object.
+  \param mode Inclusive or exclusive scan.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \pre Iterators in the range `[first_out,first_out+sequence_size)` are valid. 
+  */
+  template <typename InputIterator, typename OutputIterator, 
+            typename Identity, typename Combiner>
+  void scan(InputIterator first, std::size_t sequence_size,
+            OutputIterator first_out,
+            Identity && identity, Combiner && combine_op,
+            scan_mode mode) const;
+
+  /**
+  \brief Sorts a sequence of data items.
+  \tparam RandomIterator Random access iterator type for the sequence.
+  \tparam Compare Callable object type for the comparison.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the sequence.
+  \param comp Comparison callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  */
+  template <typename RandomIterator, typename Compare>
+  void sort(RandomIterator first, std::size_t sequence_size,
+            Compare && comp) const;
+
   /**
   \brief Applies a stencil to multiple sequences leaving the result in
   another sequence.
@@ -246,6 +302,13 @@ constexpr bool supports_reduce<dynamic_execution>() { return true; }
 template <>
 constexpr bool supports_map_reduce<dynamic_execution>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the map-reduce by key pattern.
+\note Specialization for dynamic_execution.
+*/
+template <>
+constexpr bool supports_map_reduce_by_key<dynamic_execution>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the stencil pattern.
 \note Specialization for dynamic_execution.
@@ -253,6 +316,20 @@ constexpr bool supports_map_reduce<dynamic_execution>() { return true; }
 template <>
 constexpr bool supports_stencil<dynamic_execution>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the scan pattern.
+\note Specialization for dynamic_execution.
+*/
+template <>
+constexpr bool supports_scan<dynamic_execution>() { return true; }
+
+/**
+\brief Determines if an execution policy supports the sort pattern.
+\note Specialization for dynamic_execution.
+*/
+template <>
+constexpr bool supports_sort<dynamic_execution>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the divide/conquer pattern.
 \note Specialization for dynamic_execution.
@@ -354,6 +431,46 @@ auto dynamic_execution::map_reduce(
       std::forward<Combiner>(combine_op));
 }
 
+template <typename RandomIterator, typename Compare>
+void dynamic_execution::sort(
+    RandomIterator first, 
+    std::size_t sequence_size,
+    Compare && comp) const
+{
+  GRPPI_TRY_PATTERN_ALL(sort, first, sequence_size, 
+      std::forward<Compare>(comp));
+}
+
+template <typename InputIterator, typename KeyTransformer,
+          typename ValueTransformer, typename Combiner>
+auto dynamic_execution::map_reduce_by_key(
+    InputIterator first, 
+    std::size_t sequence_size,
+    KeyTransformer && key_op,
+    ValueTransformer && value_op,
+    Combiner && combine_op) const
+{
+  GRPPI_TRY_PATTERN_ALL(map_reduce_by_key, first, sequence_size,
+      std::forward<KeyTransformer>(key_op),
+      std::forward<ValueTransformer>(value_op),
+      std::forward<Combiner>(combine_op));
+}
+
+template <typename InputIterator, typename OutputIterator, 
+          typename Identity, typename Combiner>
+void dynamic_execution::scan(
+    InputIterator first, 
+    std::size_t sequence_size,
+    OutputIterator first_out,
+    Identity && identity,
+    Combiner && combine_op,
+    scan_mode mode) const
+{
+  GRPPI_TRY_PATTERN_ALL(scan, first, sequence_size, first_out,
+      std::forward<Identity>(identity), std::forward<Combiner>(combine_op),
+      mode);
+}
+
 template <typename ... InputIterators, typename OutputIterator,
           typename StencilTransformer, typename Neighbourhood>
 void dynamic_execution::stencil(
@@ -24,6 +24,7 @@
 #include "ordered_stream_filter.h"
 #include "unordered_stream_filter.h"
 #include "iteration_nodes.h"
+#include "time_reduce_node.h"
 #include "../../common/mpmc_queue.h"
 
 
@@ -335,6 +336,39 @@ private:
     }
   }
 
+  template <typename Input, typename Timestamper, typename Combiner,
+          typename Identity,
+          template <typename T, typename C, typename I> class TimeReduce,
+          typename ... OtherTransformers,
+          requires_reduce_by_time<TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  auto add_stages(TimeReduce<Timestamper,Combiner,Identity> & reduce_obj,
+      OtherTransformers && ... other_transform_ops) 
+  {
+    return this->template add_stages<Input>(std::move(reduce_obj),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Input, typename Timestamper, typename Combiner,
+          typename Identity,
+          template <typename T, typename C, typename I> class TimeReduce,
+          typename ... OtherTransformers,
+          requires_reduce_by_time<TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  auto add_stages(TimeReduce<Timestamper,Combiner,Identity> && reduce_obj,
+      OtherTransformers && ... other_transform_ops) 
+  {
+    static_assert(!std::is_void<Input>::value,
+        "Reduce must take non-void argument");
+
+    // Windows are reduced as items arrive, so the stage is a single node
+    using reducer_type = TimeReduce<Timestamper,Combiner,Identity>;
+    using node_type = time_reduce_node<Input,reducer_type>;
+    using output_type = typename reducer_type::result_type;
+    auto p_node = std::make_unique<node_type>(
+        std::forward<reducer_type>(reduce_obj));
+    add_node(std::move(p_node));
+    add_stages<output_type>(std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
   /**
   \brief Adds a stage with an iteration object.
   \note This version takes iteration by l-value reference.
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_FF_DETAIL_TIME_REDUCE_NODE_H
+#define GRPPI_FF_DETAIL_TIME_REDUCE_NODE_H
+
+#include "fastflow_allocator.h"
+
+#include <ff/allocator.hpp>
+#include <ff/node.hpp>
+
+namespace grppi {
+
+namespace detail_ff {
+
+/**
+\brief Fastflow node for a time based stream reduce.
+Every item may close several windows, whose results are sent out in order.
+Windows still open at the end of the stream are reduced before it is
+propagated.
+\tparam Item Data type for the input value.
+\tparam Reducer Type of the time based reduce pattern object.
+*/
+template <typename Item, typename Reducer>
+class time_reduce_node : public ff::ff_node_t<Item,typename Reducer::result_type> {
+public:
+  using result_type = typename Reducer::result_type;
+
+  time_reduce_node(Reducer && reducer) :
+      reducer_{std::move(reducer)}
+  {}
+
+  result_type * svc(Item * p_item) {
+    reducer_.add_item(*p_item, [this](result_type && result) {
+      this->ff_send_out(new (ff_arena) result_type{std::move(result)});
+    });
+    operator delete(p_item, ff_arena);
+    return this->GO_ON;
+  }
+
+  void eosnotify(ssize_t) override {
+    reducer_.flush([this](result_type && result) {
+      this->ff_send_out(new (ff_arena) result_type{std::move(result)});
+    });
+  }
+
+private:
+  Reducer reducer_;
+};
+
+} // namespace detail_ff
+
+} // namespace grppi
+
+#endif
@@ -22,10 +22,15 @@
 
 #include "../common/iterator.h"
 #include "../common/execution_traits.h"
+#include "../common/scan_mode.h"
+#include "../common/sample_sort.h"
+#include "../common/hash_aggregation.h"
 
 #include <type_traits>
 #include <tuple>
 #include <thread>
+#include <vector>
+#include <algorithm>
 
 #include <ff/parallel_for.hpp>
 #include <ff/dc.hpp>
@@ -156,6 +161,66 @@ public:
       Transformer && transform_op,
       Combiner && combine_op) const;
 
+  /**
+    \brief Applies a map/reduce by key operation to a sequence of data items.
+    \tparam InputIterator Iterator type for the input sequence.
+    \tparam KeyTransformer Callable object type for the key operation.
+    \tparam ValueTransformer Callable object type for the value operation.
+    \tparam Combiner Callable object type for the combination.
+    \param first Iterator to the first element of the sequence.
+    \param sequence_size Size of the input sequence.
+    \param key_op Key callable object.
+    \param value_op Value callable object.
+    \param combine_op Combination callable object.
+    \pre Iterators in the range `[first,first+sequence_size)` are valid.
+    \return A vector of pairs with every key and its combined value.
+   */
+  template <typename InputIterator, typename KeyTransformer,
+            typename ValueTransformer, typename Combiner>
+  auto map_reduce_by_key(InputIterator first,
+      std::size_t sequence_size,
+      KeyTransformer && key_op,
+      ValueTransformer && value_op,
+      Combiner && combine_op) const;
+
+  /**
+    \brief Applies a scan to a sequence of data items.
+    \tparam InputIterator Iterator type for the input sequence.
+    \tparam OutputIterator Iterator type for the output sequence.
+    \tparam Identity Type for the identity value.
+    \tparam Combiner Callable object type for the combination.
+    \param first Iterator to the first element of the sequence.
+    \param sequence_size Size of the input sequence.
+    \param first_out Iterator to the first element of the output sequence.
+    \param identity Identity value for the combination.
+    \param combine_op Combination callable object.
+    \param mode Inclusive or exclusive scan.
+    \pre Iterators in the range `[first,first+sequence_size)` are valid.
+    \pre Iterators in the range `[first_out,first_out+sequence_size)` are valid.
+   */
+  template <typename InputIterator, typename OutputIterator,
+            typename Identity, typename Combiner>
+  void scan(InputIterator first,
+      std::size_t sequence_size,
+      OutputIterator first_out,
+      Identity && identity,
+      Combiner && combine_op,
+      scan_mode mode) const;
+
+  /**
+    \brief Sorts a sequence of data items.
+    \tparam RandomIterator Random access iterator type for the sequence.
+    \tparam Compare Callable object type for the comparison.
+    \param first Iterator to the first element of the sequence.
+    \param sequence_size Size of the sequence.
+    \param comp Comparison callable object.
+    \pre Iterators in the range `[first,first+sequence_size)` are valid.
+   */
+  template <typename RandomIterator, typename Compare>
+  void sort(RandomIterator first,
+      std::size_t sequence_size,
+      Compare && comp) const;
+
   /**
     \brief Applies a transformation to multiple sequences leaving the result in
     another sequence.
@@ -283,6 +348,13 @@ constexpr bool supports_reduce<parallel_execution_ff>() { return true; }
 template <>
 constexpr bool supports_map_reduce<parallel_execution_ff>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the map-reduce by key pattern.
+\note Specialization for parallel_execution_ff when GRPPI_FF is enabled.
+*/
+template <>
+constexpr bool supports_map_reduce_by_key<parallel_execution_ff>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the stencil pattern.
 \note Specialization for parallel_execution_ff when GRPPI_FF is enabled.
@@ -290,6 +362,20 @@ constexpr bool supports_map_reduce<parallel_execution_ff>() { return true; }
 template <>
 constexpr bool supports_stencil<parallel_execution_ff>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the scan pattern.
+\note Specialization for parallel_execution_ff when GRPPI_FF is enabled.
+*/
+template <>
+constexpr bool supports_scan<parallel_execution_ff>() { return true; }
+
+/**
+\brief Determines if an execution policy supports the sort pattern.
+\note Specialization for parallel_execution_ff when GRPPI_FF is enabled.
+*/
+template <>
+constexpr bool supports_sort<parallel_execution_ff>() { return true; }
+
 /*
 \brief Determines if an execution policy supports the divide_conquer pattern.
 \note Specialization for parallel_execution_ff when GRPPI_FF is enabled.
@@ -356,6 +442,100 @@ auto parallel_execution_ff::map_reduce(std::tuple<InputIterators...> firsts,
       std::forward<Combiner>(combine_op));
 }
 
+template <typename InputIterator, typename OutputIterator,
+          typename Identity, typename Combiner>
+void parallel_execution_ff::scan(InputIterator first,
+    std::size_t sequence_size,
+    OutputIterator first_out,
+    Identity && identity,
+    Combiner && combine_op,
+    scan_mode mode) const
+{
+  using result_type = std::decay_t<Identity>;
+  const long nchunks = std::max(1L, 
+      std::min<long>(concurrency_degree_, sequence_size));
+  const long chunk_size = sequence_size / nchunks;
+  auto chunk_bounds = [=](long id) {
+    const long begin = chunk_size * id;
+    const long end = (id+1 == nchunks) ? sequence_size : begin + chunk_size;
+    return std::make_pair(begin, end);
+  };
+
+  // First pass: reduce every chunk
+  std::vector<result_type> offsets(nchunks, identity);
+  ff::ParallelFor pf{concurrency_degree_, true};
+  pf.parallel_for(0, nchunks-1,
+    [&](long id) {
+      auto b = chunk_bounds(id);
+      auto it = std::next(first, b.first);
+      for (long i=b.first; i!=b.second; ++i) {
+        offsets[id] = combine_op(offsets[id], *it++);
+      }
+    },
+    concurrency_degree_);
+
+  // Exclusive scan of chunk reductions gives the offset of each chunk
+  result_type carry{identity};
+  for (auto & o : offsets) {
+    auto next = combine_op(carry, o);
+    o = std::move(carry);
+    carry = std::move(next);
+  }
+
+  // Second pass: scan every chunk from its offset
+  pf.parallel_for(0, nchunks,
+    [&](long id) {
+      auto b = chunk_bounds(id);
+      auto in = std::next(first, b.first);
+      auto out = std::next(first_out, b.first);
+      result_type result{offsets[id]};
+      for (long i=b.first; i!=b.second; ++i) {
+        if (mode == scan_mode::exclusive) {
+          auto item = *in++;
+          *out++ = result;
+          result = combine_op(result, item);
+        }
+        else {
+          result = combine_op(result, *in++);
+          *out++ = result;
+        }
+      }
+    },
+    concurrency_degree_);
+}
+
+template <typename InputIterator, typename KeyTransformer,
+          typename ValueTransformer, typename Combiner>
+auto parallel_execution_ff::map_reduce_by_key(InputIterator first,
+    std::size_t sequence_size,
+    KeyTransformer && key_op,
+    ValueTransformer && value_op,
+    Combiner && combine_op) const
+{
+  ff::ParallelFor pf{concurrency_degree_, true};
+  return hash_map_reduce_by_key(first, sequence_size,
+      std::forward<KeyTransformer>(key_op),
+      std::forward<ValueTransformer>(value_op),
+      std::forward<Combiner>(combine_op),
+      concurrency_degree_,
+      [&pf,this](std::size_t n, auto && f) {
+        pf.parallel_for(0, n, [&f](long i) { f(i); }, concurrency_degree_);
+      });
+}
+
+template <typename RandomIterator, typename Compare>
+void parallel_execution_ff::sort(RandomIterator first,
+    std::size_t sequence_size,
+    Compare && comp) const
+{
+  ff::ParallelFor pf{concurrency_degree_, true};
+  sample_sort(first, std::next(first, sequence_size),
+      std::forward<Compare>(comp), concurrency_degree_,
+      [&pf,this](std::size_t n, auto && f) {
+        pf.parallel_for(0, n, [&f](long i) { f(i); }, concurrency_degree_);
+      });
+}
+
 template <typename ... InputIterators, typename OutputIterator,
           typename StencilTransformer, typename Neighbourhood>
 void parallel_execution_ff::stencil(std::tuple<InputIterators...> firsts,
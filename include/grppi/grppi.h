@@ -22,7 +22,10 @@
 // Includes for data parallel patterns
 #include "map.h"
 #include "mapreduce.h"
+#include "mapreduce_by_key.h"
 #include "reduce.h"
+#include "scan.h"
+#include "sort.h"
 #include "stencil.h"
 
 namespace grppi {
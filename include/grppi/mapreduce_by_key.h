@@ -0,0 +1,109 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_MAPREDUCE_BY_KEY_H
+#define GRPPI_MAPREDUCE_BY_KEY_H
+
+#include <utility>
+
+#include "grppi/common/range_concept.h"
+#include "grppi/common/iterator_traits.h"
+#include "grppi/common/execution_traits.h"
+
+namespace grppi {
+
+/**
+\addtogroup data_patterns
+@{
+\defgroup mapreduce_by_key_pattern Map/reduce by key pattern
+\brief Interface for applying the \ref md_map-reduce-by-key.
+@{
+*/
+
+/**
+\brief Invoke \ref md_map-reduce-by-key on a data sequence.
+\tparam Execution Execution type.
+\tparam InputIterator Iterator type used for the input sequence.
+\tparam KeyTransformer Callable type for the key operation.
+\tparam ValueTransformer Callable type for the value operation.
+\tparam Combiner Callable type for the combination of values.
+\param ex Execution policy object.
+\param first Iterator to the first element in the input sequence.
+\param last Iterator to one past the end of the input sequence.
+\param key_op Operation returning the key of an element.
+\param value_op Operation returning the value of an element.
+\param combine_op Combination of two values with the same key.
+\return A vector with a pair for every different key and its combined
+value, in unspecified order.
+*/
+template <typename Execution, typename InputIterator,
+          typename KeyTransformer, typename ValueTransformer,
+          typename Combiner,
+          requires_iterator<InputIterator> = 0>
+auto map_reduce_by_key(const Execution & ex,
+                       InputIterator first, InputIterator last,
+                       KeyTransformer && key_op,
+                       ValueTransformer && value_op,
+                       Combiner && combine_op)
+{
+  static_assert(supports_map_reduce_by_key<Execution>(),
+    "map/reduce by key not supported on execution type");
+  return ex.map_reduce_by_key(first, std::distance(first,last),
+      std::forward<KeyTransformer>(key_op),
+      std::forward<ValueTransformer>(value_op),
+      std::forward<Combiner>(combine_op));
+}
+
+/**
+\brief Invoke \ref md_map-reduce-by-key on a data range.
+\tparam Execution Execution type.
+\tparam InputRange Range type used for the input sequence.
+\tparam KeyTransformer Callable type for the key operation.
+\tparam ValueTransformer Callable type for the value operation.
+\tparam Combiner Callable type for the combination of values.
+\param ex Execution policy object.
+\param rin Range for the input sequence.
+\param key_op Operation returning the key of an element.
+\param value_op Operation returning the value of an element.
+\param combine_op Combination of two values with the same key.
+\return A vector with a pair for every different key and its combined
+value, in unspecified order.
+*/
+template <typename Execution, typename InputRange,
+          typename KeyTransformer, typename ValueTransformer,
+          typename Combiner,
+          meta::requires<range_concept,InputRange> = 0>
+auto map_reduce_by_key(const Execution & ex,
+                       InputRange && rin,
+                       KeyTransformer && key_op,
+                       ValueTransformer && value_op,
+                       Combiner && combine_op)
+{
+  static_assert(supports_map_reduce_by_key<Execution>(),
+    "map/reduce by key not supported on execution type");
+  return ex.map_reduce_by_key(rin.begin(), rin.size(),
+      std::forward<KeyTransformer>(key_op),
+      std::forward<ValueTransformer>(value_op),
+      std::forward<Combiner>(combine_op));
+}
+
+/**
+@}
+@}
+*/
+
+}
+
+#endif
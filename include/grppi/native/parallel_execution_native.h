@@ -17,8 +17,17 @@
 #define GRPPI_NATIVE_PARALLEL_EXECUTION_NATIVE_H
 
 #include "worker_pool.h"
+#include "thread_pool.h"
+#include "work_stealing.h"
 #include "../common/optional.h"
 #include "../common/mpmc_queue.h"
+#include "../common/reorder_buffer.h"
+#include "../common/tree_combine.h"
+#include "../common/fused_stage.h"
+#include "../common/cancellation.h"
+#include "../common/scan_mode.h"
+#include "../common/sample_sort.h"
+#include "../common/hash_aggregation.h"
 #include "../common/iterator.h"
 #include "../common/execution_traits.h"
 #include "../common/configuration.h"
@@ -26,12 +35,17 @@
 #include <thread>
 #include <atomic>
 #include <algorithm>
+#include <numeric>
 #include <vector>
+#include <memory>
 #include <type_traits>
 #include <tuple>
 #include <sstream>
 #include <cstdlib>
 #include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <cassert>
 
 namespace grppi {
 
@@ -40,69 +54,214 @@ namespace grppi {
 
 A thread table provides a simple way to offer thread indices (starting from 0).
 
-When a thread registers itself in the registry, its id is added to the vector 
-of identifiers. When a thread deregisters itself from the registry its entry
-is modified to contain the empty thread id.
+When a thread registers itself in the registry, it gets the lowest index
+released by a deregistered thread or, if none is available, a new index.
+Indices are therefore unique among the currently registered threads and
+stay below the maximum number of threads registered at the same time.
 
-To get an integer index, users may call `current_index`, which provides the order
-number of the calling thread in the registry.
+To get an integer index, users may call `current_index`, which provides the
+index of the calling thread without locking the registry, as the index is
+kept in thread local storage. The registration most recently used by the
+thread is looked up first, so that the lookup does not search the
+registrations of the thread unless it alternates between registries.
 
-\note This class is thread safe by means of using a spin-lock.
+At most 65536 threads may be registered at the same time.
+
+\note This class is thread safe. Released indices are kept in a lock-free
+free list.
 */
 class thread_registry {
 public:
   thread_registry() = default;
 
   /**
-  \brief Adds the current thread id in the registry.
+  \brief Destructs the registry.
+  \pre No thread is currently registered.
+  */
+  ~thread_registry();
+
+  thread_registry(thread_registry const &) = delete;
+  thread_registry & operator=(thread_registry const &) = delete;
+
+  /**
+  \brief Adds the current thread in the registry.
+  \note A thread already registered keeps its index.
+  \throw std::bad_alloc if the registration cannot be stored.
+  \throw std::runtime_error if too many threads are registered.
   */
-  void register_thread() noexcept;
+  void register_thread();
 
   /**
-  \brief Removes current thread id from the registry.
+  \brief Removes current thread from the registry.
   */
   void deregister_thread() noexcept;
 
   /**
   \brief Integer index for current thread
-  \return Integer value with the registration order of current thread.
+  \return Integer value with the index of current thread (-1 if not
+  registered).
   \pre Current thread is registered.
   */
   int current_index() const noexcept;
 
 private:
-  mutable std::atomic_flag lock_ = ATOMIC_FLAG_INIT;
-  std::vector<std::thread::id> ids_{};
+
+  /// Registration of the current thread in a registry.
+  struct registration {
+    thread_registry const * registry;
+    int index;
+    int depth;
+  };
+
+  /// Registrations of the current thread.
+  struct thread_registrations {
+    std::vector<registration> regs;
+    /// Position of the most recently used registration.
+    std::size_t last = 0;
+  };
+
+  static thread_registrations & registrations() noexcept {
+    static thread_local thread_registrations regs;
+    return regs;
+  }
+
+  /// Registration of the current thread in this registry, or nullptr.
+  registration * find_registration() const noexcept;
+
+  int acquire_index();
+  void release_index(int index) noexcept;
+  std::atomic<int> & next_free(int index) noexcept;
+
+  constexpr static int chunk_size = 256;
+  constexpr static int max_chunks = 256;
+  constexpr static int max_threads = chunk_size * max_chunks;
+
+  /// Next never used index.
+  std::atomic<int> next_index_{0};
+
+  /// Head of the free list of indices tagged with a version counter.
+  std::atomic<std::uint64_t> free_head_{0};
+
+  /// Links of the free list, allocated in chunks when needed.
+  std::atomic<std::atomic<int>*> chunks_[max_chunks] = {};
 };
 
-inline void thread_registry::register_thread() noexcept 
+inline thread_registry::~thread_registry()
 {
-  using namespace std;
-  while (lock_.test_and_set(memory_order_acquire)) {}
-  auto this_id = this_thread::get_id();
-  ids_.push_back(this_id);
-  lock_.clear(memory_order_release);
+  for (auto & c : chunks_) { delete [] c.load(); }
+}
+
+inline void thread_registry::register_thread()
+{
+  auto current = find_registration();
+  if (current) {
+    current->depth++;
+    return;
+  }
+  // Store the registration before taking an index, so that a failed
+  // allocation does not lose the index
+  auto & t = registrations();
+  t.regs.push_back({this, -1, 1});
+  t.last = t.regs.size() - 1;
+  try {
+    t.regs.back().index = acquire_index();
+  }
+  catch (...) {
+    t.regs.pop_back();
+    throw;
+  }
 }
 
 inline void thread_registry::deregister_thread() noexcept
 {
-  using namespace std;
-  while (lock_.test_and_set(memory_order_acquire)) {}
-  auto this_id = this_thread::get_id();
-  auto current = find(begin(ids_), end(ids_), this_id);
-  *current = {}; //Empty thread
-  lock_.clear(memory_order_release);
+  auto current = find_registration();
+  if (!current) return;
+  if (--current->depth > 0) return;
+  release_index(current->index);
+  auto & regs = registrations().regs;
+  regs.erase(regs.begin() + (current - regs.data()));
 }
 
 inline int thread_registry::current_index() const noexcept
+{
+  auto current = find_registration();
+  return current ? current->index : -1;
+}
+
+inline thread_registry::registration * 
+thread_registry::find_registration() const noexcept
+{
+  auto & t = registrations();
+  if (t.last < t.regs.size() && t.regs[t.last].registry == this) {
+    return &t.regs[t.last];
+  }
+  for (std::size_t i=0; i<t.regs.size(); ++i) {
+    if (t.regs[i].registry == this) {
+      t.last = i;
+      return &t.regs[i];
+    }
+  }
+  return nullptr;
+}
+
+inline int thread_registry::acquire_index()
+{
+  using namespace std;
+  auto head = free_head_.load(memory_order_acquire);
+  for (;;) {
+    int index = static_cast<int>(head & 0xffffffffu) - 1;
+    if (index < 0) {
+      index = next_index_.load(memory_order_relaxed);
+      do {
+        if (index >= max_threads) {
+          throw std::runtime_error{"Too many threads registered"};
+        }
+      }
+      while (!next_index_.compare_exchange_weak(index, index + 1,
+          memory_order_relaxed));
+      return index;
+    }
+    auto next = next_free(index).load(memory_order_relaxed);
+    auto tag = (head >> 32) + 1;
+    auto new_head = (tag << 32) | static_cast<std::uint64_t>(next + 1);
+    if (free_head_.compare_exchange_weak(head, new_head,
+        memory_order_acquire, memory_order_acquire)) {
+      return index;
+    }
+  }
+}
+
+inline void thread_registry::release_index(int index) noexcept
 {
   using namespace std;
-  while (lock_.test_and_set(memory_order_acquire)) {}
-  auto this_id = this_thread::get_id();
-  auto current = find(begin(ids_), end(ids_), this_id);
-  auto index = distance(begin(ids_), current);
-  lock_.clear(memory_order_release);
-  return index;
+  auto head = free_head_.load(memory_order_relaxed);
+  std::uint64_t new_head;
+  do {
+    next_free(index).store(static_cast<int>(head & 0xffffffffu) - 1,
+        memory_order_relaxed);
+    auto tag = (head >> 32) + 1;
+    new_head = (tag << 32) | static_cast<std::uint64_t>(index + 1);
+  }
+  while (!free_head_.compare_exchange_weak(head, new_head,
+      memory_order_release, memory_order_relaxed));
+}
+
+inline std::atomic<int> & thread_registry::next_free(int index) noexcept
+{
+  assert(index >= 0 && index < max_threads);
+  auto & chunk = chunks_[index / chunk_size];
+  auto links = chunk.load(std::memory_order_acquire);
+  if (!links) {
+    auto fresh = new std::atomic<int>[chunk_size];
+    if (chunk.compare_exchange_strong(links, fresh, 
+        std::memory_order_acq_rel, std::memory_order_acquire)) {
+      links = fresh;
+    }
+    else {
+      delete [] fresh;
+    }
+  }
+  return links[index % chunk_size];
 }
 
 /**
@@ -169,12 +328,31 @@ public:
     ordering_{ordering}
   {}
 
+  /**
+  \brief Copy constructs a native parallel execution policy.
+  The copy shares the thread pool and the queue statistics of the original
+  policy.
+  */
   parallel_execution_native(const parallel_execution_native & ex) :
-      parallel_execution_native{ex.concurrency_degree_, ex.ordering_}
+      concurrency_degree_{ex.concurrency_degree_},
+      ordering_{ex.ordering_},
+      thread_pool_{ex.thread_pool_},
+      schedule_{ex.schedule_},
+      schedule_chunk_{ex.schedule_chunk_},
+      stage_fusion_{ex.stage_fusion_},
+      cancellation_{ex.cancellation_},
+      queue_size_{ex.queue_size_},
+      queue_mode_{ex.queue_mode_},
+      queue_wait_{ex.queue_wait_},
+      queue_limit_{ex.queue_limit_},
+      reorder_capacity_{ex.reorder_capacity_},
+      farm_distribution_{ex.farm_distribution_},
+      queue_statistics_{ex.queue_statistics_}
   {}
 
   /**
   \brief Set number of grppi threads.
+  The thread pool keeps this number of threads from the next launched task.
   */
   void set_concurrency_degree(int degree) noexcept { concurrency_degree_ = degree; }
 
@@ -198,6 +376,51 @@ public:
   */
   bool is_ordered() const noexcept { return ordering_; }
 
+  /**
+  \brief Sets how data patterns split sequences among threads.
+  \param schedule Scheduling of chunks.
+  \param chunk Size of chunks for dynamic scheduling and minimum size for
+  guided scheduling (0 selects a default size).
+  */
+  void set_schedule(loop_schedule schedule, std::size_t chunk = 0) noexcept {
+    schedule_ = schedule;
+    schedule_chunk_ = chunk;
+  }
+
+  /**
+  \brief Gets how data patterns split sequences among threads.
+  */
+  loop_schedule schedule() const noexcept { return schedule_; }
+
+  /**
+  \brief Enables or disables the fusion of consecutive pipeline stages.
+  When enabled, consecutive stages that are not patterns run in a single
+  thread, without queues among them. This should be used when stages are 
+  too lightweight to pay for their communication.
+  */
+  void set_stage_fusion(bool enabled) noexcept { stage_fusion_ = enabled; }
+
+  /**
+  \brief Are consecutive pipeline stages fused.
+  */
+  bool is_stage_fusion() const noexcept { return stage_fusion_; }
+
+  /**
+  \brief Attaches a cancellation token checked by the patterns.
+  Once cancelled, pipeline generators stop, items in flight are discarded
+  and data patterns stop claiming chunks.
+  */
+  void set_cancellation_token(cancellation_token const & token) noexcept {
+    cancellation_ = &token;
+  }
+
+  /**
+  \brief Checks if cancellation was requested through the attached token.
+  */
+  bool is_cancelled() const noexcept {
+    return cancellation_ && cancellation_->is_cancelled();
+  }
+
   /**
   \brief Get a manager object for registration/deregistration in the
   thread index table for current thread.
@@ -206,6 +429,13 @@ public:
     return native_thread_manager{thread_registry_}; 
   }
 
+  /**
+  \brief Get the pool of persistent threads where tasks are launched.
+  The pool is shared by all the copies of the execution policy, and keeps
+  the number of threads of the policy that launched the last task.
+  */
+  thread_pool & pool() const noexcept { return *thread_pool_; }
+
   /**
   \brief Get index of current thread in the thread table
   \pre The current thread is currently registered.
@@ -224,6 +454,59 @@ public:
     queue_mode_ = mode;
   }
 
+  /**
+  \brief Gets the size of the queues built through make_queue<T>()
+  */
+  int get_queue_size() const noexcept { return queue_size_; }
+
+  /**
+  \brief Gets the mode of the queues built through make_queue<T>()
+  */
+  queue_mode get_queue_mode() const noexcept { return queue_mode_; }
+
+  /**
+  \brief Sets the waiting strategy for the non-blocking queues built through
+  make_queue<T>()
+  */
+  void set_queue_wait(queue_wait wait) noexcept {
+    queue_wait_ = wait;
+  }
+
+  /**
+  \brief Gets the waiting strategy for the non-blocking queues built through
+  make_queue<T>()
+  */
+  queue_wait get_queue_wait() const noexcept { return queue_wait_; }
+
+  /**
+  \brief Sets the soft limit in number of elements for the queues built
+  through make_queue<T>() in unbounded mode (0 means no limit).
+  */
+  void set_queue_limit(std::size_t limit) noexcept {
+    queue_limit_ = limit;
+  }
+
+  /**
+  \brief Gets the soft limit for the queues built through make_queue<T>()
+  in unbounded mode.
+  */
+  std::size_t get_queue_limit() const noexcept { return queue_limit_; }
+
+  /**
+  \brief Sets the capacity of the reorder buffers of ordered stages.
+  A stage issuing sequence numbers does not send an item until it is within
+  that distance of the next item to be released in order, so that reorder
+  buffers never grow.
+  */
+  void set_reorder_capacity(int capacity) noexcept {
+    reorder_capacity_ = capacity;
+  }
+
+  /**
+  \brief Gets the capacity of the reorder buffers of ordered stages.
+  */
+  int get_reorder_capacity() const noexcept { return reorder_capacity_; }
+
   /**
   \brief Makes a communication queue for elements of type T.
   Constructs a queue using the attributes that can be set via 
@@ -232,7 +515,28 @@ public:
   */
   template <typename T>
   mpmc_queue<T> make_queue() const {
-    return {queue_size_, queue_mode_};
+    mpmc_queue<T> queue{queue_size_, queue_mode_, queue_access::multiple,
+        queue_wait_, queue_limit_};
+    attach_statistics(queue);
+    return queue;
+  }
+
+  /**
+  \brief Enables or disables statistics for the queues built from now on.
+  Enabling statistics discards the counters of previously built queues.
+  */
+  void set_queue_statistics(bool enabled) {
+    queue_statistics_ = enabled ?
+        std::make_shared<queue_statistics_registry>() : nullptr;
+  }
+
+  /**
+  \brief Gets the counters of the queues built while statistics were enabled.
+  \return Counters of every queue in creation order (empty if disabled).
+  */
+  std::vector<queue_counters> get_queue_statistics() const {
+    if (!queue_statistics_) return {};
+    return queue_statistics_->counters();
   }
   
   /**
@@ -260,6 +564,124 @@ public:
     return std::move(make_queue<T>());
   }
 
+  /**
+  \brief Makes a communication queue for elements of type T feeding a farm
+  if the queue has not been created in an outer pattern.
+  The queue is sharded when the farm distribution is sharded.
+  \tparam T Element type for the queue.
+  \tparam Farm Type of the next transformer.
+  \tparam Transformers List of the transformers after the next one.
+  */
+  template <typename T, typename Farm, typename ... Transformers,
+            requires_farm<Farm> = 0>
+  mpmc_queue<T> get_output_queue(Farm && farm_obj, Transformers && ...) const {
+    return make_farm_queue<T>(farm_obj);
+  }
+
+  /**
+  \brief Sets how items are distributed among the workers of a farm.
+  With farm_distribution::sharded the queue feeding a farm has one shard
+  per worker and idle workers steal from other shards.
+  */
+  void set_farm_distribution(farm_distribution distribution) noexcept {
+    farm_distribution_ = distribution;
+  }
+
+  /**
+  \brief Gets how items are distributed among the workers of a farm.
+  */
+  farm_distribution get_farm_distribution() const noexcept {
+    return farm_distribution_;
+  }
+
+  /**
+  \brief Makes a communication queue for elements of type T split in shards.
+  Constructs a queue using the attributes that can be set via
+  set_queue_attributes(). The value is returned via move semantics.
+  \tparam T Element type for the queue.
+  \param shards Number of shards.
+  */
+  template <typename T>
+  mpmc_queue<T> make_sharded_queue(int shards) const {
+    mpmc_queue<T> queue{queue_size_, queue_shards{shards}, queue_wait_};
+    attach_statistics(queue);
+    return queue;
+  }
+
+  /**
+  \brief Makes a communication queue for elements of type T that is only
+  used by a single producer and a single consumer.
+  Constructs a queue using the attributes that can be set via
+  set_queue_attributes(). The value is returned via move semantics.
+  \tparam T Element type for the queue.
+  */
+  template <typename T>
+  mpmc_queue<T> make_spsc_queue() const {
+    mpmc_queue<T> queue{queue_size_, queue_mode_, queue_access::single,
+        queue_wait_, queue_limit_};
+    attach_statistics(queue);
+    return queue;
+  }
+
+  /**
+  \brief Returns the reference of a communication queue for elements of type T
+  if the queue has been created in an outer pattern.
+  Returns the reference of the queue received as argument.
+  \tparam T Element type for the queue.
+  \tparam Transformers List of the next transformers.
+  \param queue Reference of a queue of type T
+  */
+  template <typename T, typename ... Transformers>
+  mpmc_queue<T>& get_single_producer_queue(mpmc_queue<T> & queue,
+      Transformers && ...) const
+  {
+    return queue;
+  }
+
+  /**
+  \brief Makes a communication queue for elements of type T written by a
+  single thread, if the queue has not been created in an outer pattern.
+  When the next transformer is consumed by a single thread the queue is a
+  single producer single consumer queue. Otherwise, make_queue is used.
+  \tparam T Element type for the queue.
+  \tparam Transformer Type of the next transformer.
+  \tparam Transformers List of the transformers after the next one.
+  */
+  template <typename T, typename Transformer, typename ... Transformers,
+            std::enable_if_t<!is_farm<Transformer>, int> = 0>
+  mpmc_queue<T> get_single_producer_queue(Transformer &&,
+      Transformers && ...) const
+  {
+    return is_single_consumer_stage<Transformer>() ?
+        make_spsc_queue<T>() : make_queue<T>();
+  }
+
+  /**
+  \brief Makes a communication queue for elements of type T written by a
+  single thread and feeding a farm, if the queue has not been created in an
+  outer pattern.
+  \tparam T Element type for the queue.
+  \tparam Farm Type of the next transformer.
+  \tparam Transformers List of the transformers after the next one.
+  */
+  template <typename T, typename Farm, typename ... Transformers,
+            requires_farm<Farm> = 0>
+  mpmc_queue<T> get_single_producer_queue(Farm && farm_obj,
+      Transformers && ...) const
+  {
+    return make_farm_queue<T>(farm_obj);
+  }
+
+  /**
+  \brief Makes a communication queue for elements of type T written by a
+  single thread when there are no more transformers.
+  \tparam T Element type for the queue.
+  */
+  template <typename T>
+  mpmc_queue<T> get_single_producer_queue() const {
+    return make_queue<T>();
+  }
+
   /**
   \brief Applies a transformation to multiple sequences leaving the result in
   another sequence by chunks according to concurrency degree.
@@ -317,6 +739,62 @@ public:
                   Identity && identity,
                   Transformer && transform_op, Combiner && combine_op) const;
 
+  /**
+  \brief Applies a map/reduce by key operation to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam KeyTransformer Callable object type for the key operation.
+  \tparam ValueTransformer Callable object type for the value operation.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param key_op Key callable object.
+  \param value_op Value callable object.
+  \param combine_op Combination callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \return A vector of pairs with every key and its combined value.
+  */
+  template <typename InputIterator, typename KeyTransformer,
+            typename ValueTransformer, typename Combiner>
+  auto map_reduce_by_key(InputIterator first, std::size_t sequence_size,
+                         KeyTransformer && key_op,
+                         ValueTransformer && value_op,
+                         Combiner && combine_op) const;
+
+  /**
+  \brief Applies a scan to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam OutputIterator Iterator type for the output sequence.
+  \tparam Identity Type for the identity value.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param first_out Iterator to the first element of the output sequence.
+  \param identity Identity value for the combination.
+  \param combine_op Combination callable object.
+  \param mode Inclusive or exclusive scan.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \pre Iterators in the range `[first_out,first_out+sequence_size)` are valid. 
+  */
+  template <typename InputIterator, typename OutputIterator, 
+            typename Identity, typename Combiner>
+  void scan(InputIterator first, std::size_t sequence_size,
+            OutputIterator first_out,
+            Identity && identity, Combiner && combine_op,
+            scan_mode mode) const;
+
+  /**
+  \brief Sorts a sequence of data items.
+  \tparam RandomIterator Random access iterator type for the sequence.
+  \tparam Compare Callable object type for the comparison.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the sequence.
+  \param comp Comparison callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  */
+  template <typename RandomIterator, typename Compare>
+  void sort(RandomIterator first, std::size_t sequence_size,
+            Compare && comp) const;
+
   /**
   \brief Applies a stencil to multiple sequences leaving the result in
   another sequence.
@@ -412,20 +890,21 @@ public:
 
 private:
 
-  template <typename Input, typename Divider, typename Solver, typename Combiner>
-  auto divide_conquer(Input && input, 
-                      Divider && divide_op, 
-                      Solver && solve_op, 
-                      Combiner && combine_op,
-                      std::atomic<int> & num_threads) const; 
-
- template <typename Input, typename Divider,typename Predicate, typename Solver, typename Combiner>
-  auto divide_conquer(Input && input,
-                      Divider && divide_op,
-                      Predicate && predicate_op,
-                      Solver && solve_op,
-                      Combiner && combine_op,
-                      std::atomic<int> & num_threads) const;
+  /**
+  \brief Solves a divide/conquer problem with work-stealing among the
+  threads of the policy.
+  \tparam Result Type of the solution.
+  \param input Input problem to be solved.
+  \param expand_op Operation taking a problem and a split operation, that
+  either solves the problem or returns the result of split for its
+  subproblems.
+  \param combine_op Combiner operation.
+  */
+  template <typename Result, typename Input, typename Expander,
+            typename Combiner>
+  Result work_stealing_divide_conquer(Input && input,
+                                      Expander && expand_op,
+                                      Combiner && combine_op) const;
 
 
   template <typename Queue, typename Consumer,
@@ -540,6 +1019,54 @@ private:
   void do_pipeline(Queue && input_queue, Reduce<Combiner,Identity> && reduce_obj,
                    OtherTransformers && ... other_transform_ops) const;
 
+  template <typename Queue, typename KeyExtractor, typename Combiner,
+            typename Identity,
+            template <typename K, typename C, typename I> class KeyedReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_key<
+                KeyedReduce<KeyExtractor,Combiner,Identity>> = 0>
+  void do_pipeline(Queue & input_queue,
+                   KeyedReduce<KeyExtractor,Combiner,Identity> & reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const
+  {
+    do_pipeline(input_queue, std::move(reduce_obj),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Queue, typename KeyExtractor, typename Combiner,
+            typename Identity,
+            template <typename K, typename C, typename I> class KeyedReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_key<
+                KeyedReduce<KeyExtractor,Combiner,Identity>> = 0>
+  void do_pipeline(Queue & input_queue,
+                   KeyedReduce<KeyExtractor,Combiner,Identity> && reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const;
+
+  template <typename Queue, typename Timestamper, typename Combiner,
+            typename Identity,
+            template <typename T, typename C, typename I> class TimeReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_time<
+                TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  void do_pipeline(Queue & input_queue,
+                   TimeReduce<Timestamper,Combiner,Identity> & reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const
+  {
+    do_pipeline(input_queue, std::move(reduce_obj),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Queue, typename Timestamper, typename Combiner,
+            typename Identity,
+            template <typename T, typename C, typename I> class TimeReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_time<
+                TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  void do_pipeline(Queue & input_queue,
+                   TimeReduce<Timestamper,Combiner,Identity> && reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const;
+
   template <typename Queue, typename Transformer, typename Predicate,
             template <typename T, typename P> class Iteration,
             typename ... OtherTransformers,
@@ -611,24 +1138,193 @@ private:
       std::tuple<Transformers...> && transform_ops,
       std::index_sequence<I...>) const;
 
-private: 
+  /**
+  \brief Makes the queue feeding a farm according to the farm distribution.
+  */
+  template <typename T, typename Farm>
+  mpmc_queue<T> make_farm_queue(Farm & farm_obj) const {
+    return (farm_distribution_ == farm_distribution::sharded) ?
+        make_sharded_queue<T>(farm_obj.cardinality()) : make_queue<T>();
+  }
 
-  mutable thread_registry thread_registry_{};
-  
-  configuration<> config_{};
+  /**
+  \brief Runs a farm worker that pops items on behalf of a consumer index.
+  Once the end of stream is found, the worker drains items that may still
+  wait in other shards of the input queue.
+  \param input_queue Input queue of the farm.
+  \param worker Index of the worker.
+  \param process_op Operation applied to every item.
+  \return Number of end of stream items taken from the queue.
+  */
+  template <typename Queue, typename Processor>
+  int farm_worker(Queue & input_queue, std::size_t worker,
+      Processor && process_op) const;
 
-  int concurrency_degree_ = config_.concurrency_degree();
-  
-  bool ordering_ = config_.ordering();
-  
-  int queue_size_ = config_.queue_size();
+private:
 
-  queue_mode queue_mode_ = config_.mode();
-};
+  /**
+  \brief Determines if a stage pops its input queue from a single thread.
+  Iterations are excluded as they also push back into their input queue.
+  */
+  template <typename Transformer>
+  static constexpr bool is_single_consumer_stage() {
+    return is_no_pattern<Transformer> ||
+        is_filter<Transformer> ||
+        is_reduce<Transformer>;
+  }
 
-/**
-\brief Metafunction that determines if type E is parallel_execution_native
-\tparam Execution policy type.
+  /**
+  \brief Records the operations on a queue if statistics are enabled.
+  */
+  template <typename T>
+  void attach_statistics(mpmc_queue<T> & queue) const {
+    if (queue_statistics_) queue.set_statistics(queue_statistics_->add());
+  }
+
+  /**
+  \brief Attaches a reorder credit to a queue when ordering is enabled and
+  the next stages restore the order of its items.
+  \return The credit to acquire before sending an item (nullptr if none).
+  */
+  template <typename T, typename ... Transformers>
+  std::shared_ptr<reorder_credit> make_reorder_credit(mpmc_queue<T> & queue,
+      Transformers && ...) const
+  {
+    if (!is_ordered() || !reaches_reorder_buffer<Transformers...>) {
+      return nullptr;
+    }
+    auto credit = std::make_shared<reorder_credit>(
+        static_cast<std::size_t>(reorder_capacity_));
+    queue.set_reorder_credit(credit);
+    return credit;
+  }
+
+  /**
+  \brief Splits a sequence in chunks according to the schedule.
+  \param size Size of the sequence.
+  \return Offsets of the chunk boundaries, starting by 0 and ending by size.
+  There is at least one chunk.
+  */
+  std::vector<std::size_t> make_chunks(std::size_t size) const;
+
+  /**
+  \brief Processes the chunks of a sequence in the threads of the policy.
+  Threads claim chunks in increasing order, and skip them once the
+  execution is cancelled.
+  \param bounds Offsets of the chunk boundaries.
+  \param process_chunk Operation taking the index, offset and size of a
+  chunk.
+  */
+  template <typename ChunkProcessor>
+  void for_each_chunk(std::vector<std::size_t> const & bounds,
+                      ChunkProcessor && process_chunk) const;
+
+  /**
+  \brief Invokes an operation for every index in [0,n) in the threads of
+  the policy.
+  Threads claim indices in increasing order through an atomic counter.
+  */
+  template <typename F>
+  void for_each_index(std::size_t n, F && f) const;
+
+  /**
+  \brief Runs a transformer stage in its own task feeding the next stages.
+  */
+  template <typename Queue, typename Transformer, typename ... OtherTransformers>
+  void do_transform_stage(Queue & input_queue, Transformer && transform_op,
+      OtherTransformers && ... other_transform_ops) const;
+
+  /**
+  \brief Fuses a stage with every following stage that is not a pattern
+  and runs the resulting stage.
+  */
+  template <typename Queue, typename Transformer>
+  void fuse_stages(Queue & input_queue, Transformer && transform_op) const
+  {
+    do_pipeline(input_queue, std::forward<Transformer>(transform_op));
+  }
+
+  template <typename Queue, typename Transformer, typename Next,
+            typename ... OtherTransformers>
+  void fuse_stages(Queue & input_queue, Transformer && transform_op,
+      Next && next_op, OtherTransformers && ... other_transform_ops) const
+  {
+    using fusable = std::integral_constant<bool,
+        is_no_pattern<Next> && !is_queue<std::decay_t<Next>>>;
+    fuse_next(fusable{}, input_queue, 
+        std::forward<Transformer>(transform_op), std::forward<Next>(next_op),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Queue, typename Transformer, typename Next,
+            typename ... OtherTransformers>
+  void fuse_next(std::true_type, Queue & input_queue, 
+      Transformer && transform_op, Next && next_op,
+      OtherTransformers && ... other_transform_ops) const
+  {
+    fuse_stages(input_queue, 
+        fused_stage_t<Transformer,Next>{std::forward<Transformer>(transform_op),
+            std::forward<Next>(next_op)},
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Queue, typename Transformer, typename T>
+  void fuse_next(std::false_type, Queue & input_queue, 
+      Transformer && transform_op, mpmc_queue<T> & output_queue) const
+  {
+    do_pipeline(input_queue, std::forward<Transformer>(transform_op),
+        output_queue);
+  }
+
+  template <typename Queue, typename Transformer, 
+            typename ... OtherTransformers>
+  void fuse_next(std::false_type, Queue & input_queue, 
+      Transformer && transform_op,
+      OtherTransformers && ... other_transform_ops) const
+  {
+    do_transform_stage(input_queue, std::forward<Transformer>(transform_op),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  mutable thread_registry thread_registry_{};
+  
+  configuration<> config_{};
+
+  int concurrency_degree_ = config_.concurrency_degree();
+  
+  bool ordering_ = config_.ordering();
+
+  std::shared_ptr<thread_pool> thread_pool_ =
+      std::make_shared<thread_pool>(concurrency_degree_);
+
+  loop_schedule schedule_ = config_.schedule();
+
+  std::size_t schedule_chunk_ = config_.schedule_chunk();
+
+  bool stage_fusion_ = config_.stage_fusion_enabled();
+
+  cancellation_token const * cancellation_ = nullptr;
+  
+  int queue_size_ = config_.queue_size();
+
+  queue_mode queue_mode_ = config_.mode();
+
+  queue_wait queue_wait_ = config_.wait_mode();
+
+  std::size_t queue_limit_ = config_.queue_limit();
+
+  int reorder_capacity_ = config_.reorder_capacity();
+
+  farm_distribution farm_distribution_ = config_.distribution();
+
+  std::shared_ptr<queue_statistics_registry> queue_statistics_ =
+      config_.queue_statistics_enabled() ?
+          std::make_shared<queue_statistics_registry>() : nullptr;
+};
+
+/**
+\brief Metafunction that determines if type E is parallel_execution_native
+\tparam Execution policy type.
 */
 template <typename E>
 constexpr bool is_parallel_execution_native() {
@@ -663,6 +1359,13 @@ constexpr bool supports_reduce<parallel_execution_native>() { return true; }
 template <>
 constexpr bool supports_map_reduce<parallel_execution_native>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the map-reduce by key pattern.
+\note Specialization for parallel_execution_native.
+*/
+template <>
+constexpr bool supports_map_reduce_by_key<parallel_execution_native>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the stencil pattern.
 \note Specialization for parallel_execution_native.
@@ -670,6 +1373,20 @@ constexpr bool supports_map_reduce<parallel_execution_native>() { return true; }
 template <>
 constexpr bool supports_stencil<parallel_execution_native>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the scan pattern.
+\note Specialization for parallel_execution_native.
+*/
+template <>
+constexpr bool supports_scan<parallel_execution_native>() { return true; }
+
+/**
+\brief Determines if an execution policy supports the sort pattern.
+\note Specialization for parallel_execution_native.
+*/
+template <>
+constexpr bool supports_sort<parallel_execution_native>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the divide/conquer pattern.
 \note Specialization for parallel_execution_native.
@@ -703,22 +1420,11 @@ void parallel_execution_native::map(
     }
   };
 
-  const int chunk_size = sequence_size / concurrency_degree_;
-  
-  {
-    worker_pool workers{concurrency_degree_};
-    for (int i=0; i!=concurrency_degree_-1; ++i) {
-      const auto delta = chunk_size * i;
-      const auto chunk_firsts = iterators_next(firsts,delta);
-      const auto chunk_first_out = next(first_out, delta);
-      workers.launch(*this, process_chunk, chunk_firsts, chunk_size, chunk_first_out);
-    }
-
-    const auto delta = chunk_size * (concurrency_degree_ - 1);
-    const auto chunk_firsts = iterators_next(firsts,delta);
-    const auto chunk_first_out = next(first_out, delta);
-    process_chunk(chunk_firsts, sequence_size - delta, chunk_first_out);
-  } // Pool synch
+  for_each_chunk(make_chunks(sequence_size),
+    [&](std::size_t, std::size_t offset, std::size_t size) {
+      process_chunk(iterators_next(firsts, offset), size, 
+          next(first_out, offset));
+    });
 }
 
 template <typename InputIterator, typename Identity, typename Combiner>
@@ -728,33 +1434,19 @@ auto parallel_execution_native::reduce(
     Combiner && combine_op) const
 {
   using result_type = std::decay_t<Identity>;
-  std::vector<result_type> partial_results(concurrency_degree_);
+  const auto bounds = make_chunks(sequence_size);
+  std::vector<result_type> partial_results(bounds.size()-1, identity);
 
   constexpr sequential_execution seq;
-  auto process_chunk = [&](InputIterator f, std::size_t sz, std::size_t id) {
-    partial_results[id] = seq.reduce(f,sz, std::forward<Identity>(identity), 
-        std::forward<Combiner>(combine_op));
-  };
-
-  const auto chunk_size = sequence_size / concurrency_degree_;
-
-  { 
-    worker_pool workers{concurrency_degree_};
-    for (int i=0; i<concurrency_degree_-1; ++i) {
-      const auto delta = chunk_size * i;
-      const auto chunk_first = std::next(first,delta);
-      workers.launch(*this, process_chunk, chunk_first, chunk_size, i);
-    }
-
-    const auto delta = chunk_size * (concurrency_degree_-1);
-    const auto chunk_first = std::next(first, delta);
-    const auto chunk_sz = sequence_size - delta;
-    process_chunk(chunk_first, chunk_sz, concurrency_degree_-1);
-  } // Pool synch
-
-  return seq.reduce(std::next(partial_results.begin()), 
-      partial_results.size()-1, std::forward<result_type>(partial_results[0]), 
-      std::forward<Combiner>(combine_op));
+  for_each_chunk(bounds, 
+    [&](std::size_t id, std::size_t offset, std::size_t size) {
+      partial_results[id] = seq.reduce(std::next(first, offset), size,
+          std::forward<Identity>(identity), 
+          std::forward<Combiner>(combine_op));
+    });
+
+  return tree_combine(partial_results, std::forward<Combiner>(combine_op),
+      [this](std::size_t n, auto && f) { this->for_each_index(n, f); });
 }
 
 template <typename ... InputIterators, typename Identity, 
@@ -766,34 +1458,92 @@ auto parallel_execution_native::map_reduce(
     Transformer && transform_op, Combiner && combine_op) const
 {
   using result_type = std::decay_t<Identity>;
-  std::vector<result_type> partial_results(concurrency_degree_);
+  const auto bounds = make_chunks(sequence_size);
+  std::vector<result_type> partial_results(bounds.size()-1, identity);
 
   constexpr sequential_execution seq;
-  auto process_chunk = [&](auto f, std::size_t sz, std::size_t id) {
-    partial_results[id] = seq.map_reduce(f, sz,
-        std::forward<Identity>(identity),
-        std::forward<Transformer>(transform_op),
-        std::forward<Combiner>(combine_op));
-  };
+  for_each_chunk(bounds, 
+    [&](std::size_t id, std::size_t offset, std::size_t size) {
+      partial_results[id] = seq.map_reduce(iterators_next(firsts, offset), 
+          size, std::forward<Identity>(identity),
+          std::forward<Transformer>(transform_op),
+          std::forward<Combiner>(combine_op));
+    });
+
+  return tree_combine(partial_results, std::forward<Combiner>(combine_op),
+      [this](std::size_t n, auto && f) { this->for_each_index(n, f); });
+}
 
-  const auto chunk_size = sequence_size / concurrency_degree_;
+template <typename RandomIterator, typename Compare>
+void parallel_execution_native::sort(
+    RandomIterator first, 
+    std::size_t sequence_size,
+    Compare && comp) const
+{
+  sample_sort(first, std::next(first, sequence_size), 
+      std::forward<Compare>(comp), concurrency_degree_,
+      [this](std::size_t n, auto && f) { this->for_each_index(n, f); });
+}
 
-  {
-    worker_pool workers{concurrency_degree_};
-    for(int i=0;i<concurrency_degree_-1;++i){    
-      const auto delta = chunk_size * i;
-      const auto chunk_firsts = iterators_next(firsts,delta);
-      workers.launch(*this, process_chunk, chunk_firsts, chunk_size, i);
-    }
+template <typename InputIterator, typename KeyTransformer,
+          typename ValueTransformer, typename Combiner>
+auto parallel_execution_native::map_reduce_by_key(
+    InputIterator first, 
+    std::size_t sequence_size,
+    KeyTransformer && key_op,
+    ValueTransformer && value_op,
+    Combiner && combine_op) const
+{
+  return hash_map_reduce_by_key(first, make_chunks(sequence_size),
+      std::forward<KeyTransformer>(key_op),
+      std::forward<ValueTransformer>(value_op),
+      std::forward<Combiner>(combine_op),
+      concurrency_degree_,
+      [this](std::size_t n, auto && f) { this->for_each_index(n, f); });
+}
+
+template <typename InputIterator, typename OutputIterator, 
+          typename Identity, typename Combiner>
+void parallel_execution_native::scan(
+    InputIterator first, 
+    std::size_t sequence_size,
+    OutputIterator first_out,
+    Identity && identity,
+    Combiner && combine_op,
+    scan_mode mode) const
+{
+  using result_type = std::decay_t<Identity>;
+  constexpr sequential_execution seq;
+  const auto bounds = make_chunks(sequence_size);
+  const auto nchunks = bounds.size() - 1;
+  if (nchunks == 1) {
+    seq.scan(first, sequence_size, first_out, identity, combine_op, mode);
+    return;
+  }
 
-    const auto delta = chunk_size * (concurrency_degree_-1);
-    const auto chunk_firsts = iterators_next(firsts, delta);
-    process_chunk(chunk_firsts, sequence_size - delta, concurrency_degree_-1);
-  } // Pool synch
+  // First pass: reduce every chunk but the last one
+  std::vector<result_type> offsets(nchunks, identity);
+  for_each_chunk(bounds, 
+    [&](std::size_t id, std::size_t offset, std::size_t size) {
+      if (id+1 == nchunks) return;
+      offsets[id] = seq.reduce(std::next(first, offset), size, 
+          identity, combine_op);
+    });
+
+  // Exclusive scan of chunk reductions gives the offset of each chunk
+  result_type carry{identity};
+  for (auto & o : offsets) {
+    auto next = combine_op(carry, o);
+    o = std::move(carry);
+    carry = std::move(next);
+  }
 
-  return seq.reduce(partial_results.begin(), 
-     partial_results.size(), std::forward<Identity>(identity),
-     std::forward<Combiner>(combine_op));
+  // Second pass: scan every chunk from its offset
+  for_each_chunk(bounds, 
+    [&](std::size_t id, std::size_t offset, std::size_t size) {
+      seq.scan(std::next(first, offset), size, std::next(first_out, offset),
+          offsets[id], combine_op, mode);
+    });
 }
 
 template <typename ... InputIterators, typename OutputIterator,
@@ -813,22 +1563,11 @@ void parallel_execution_native::stencil(
       std::forward<Neighbourhood>(neighbour_op));
   };
 
-  const auto chunk_size = sequence_size / concurrency_degree_;
-  {
-    worker_pool workers{concurrency_degree_};
-
-    for (int i=0; i!=concurrency_degree_-1; ++i) {
-      const auto delta = chunk_size * i;
-      const auto chunk_firsts = iterators_next(firsts,delta);
-      const auto chunk_out = std::next(first_out,delta);
-      workers.launch(*this, process_chunk, chunk_firsts, chunk_size, chunk_out);
-    }
-
-    const auto delta = chunk_size * (concurrency_degree_ - 1);
-    const auto chunk_firsts = iterators_next(firsts,delta);
-    const auto chunk_out = std::next(first_out,delta);
-    process_chunk(chunk_firsts, sequence_size - delta, chunk_out);
-  } // Pool synch
+  for_each_chunk(make_chunks(sequence_size),
+    [&](std::size_t, std::size_t offset, std::size_t size) {
+      process_chunk(iterators_next(firsts, offset), size, 
+          std::next(first_out, offset));
+    });
 }
 
 template <typename Input, typename Divider, typename Solver, typename Combiner>
@@ -838,11 +1577,19 @@ auto parallel_execution_native::divide_conquer(
     Solver && solve_op, 
     Combiner && combine_op) const
 {
-  std::atomic<int> num_threads{concurrency_degree_-1};
+  using result_type =
+      std::decay_t<typename std::result_of<Solver(Input)>::type>;
 
-  return divide_conquer(std::forward<Input>(problem), std::forward<Divider>(divide_op), 
-        std::forward<Solver>(solve_op), std::forward<Combiner>(combine_op),
-        num_threads);
+  return work_stealing_divide_conquer<result_type>(
+      std::forward<Input>(problem),
+      [&](auto && input, auto && split) -> result_type {
+        auto subproblems = divide_op(std::forward<Input>(input));
+        if (subproblems.size()<=1) { 
+          return solve_op(std::forward<Input>(input)); 
+        }
+        return split(subproblems);
+      },
+      std::forward<Combiner>(combine_op));
 }
 
 
@@ -854,12 +1601,19 @@ auto parallel_execution_native::divide_conquer(
     Solver && solve_op,
     Combiner && combine_op) const
 {
-  std::atomic<int> num_threads{concurrency_degree_-1};
+  using result_type =
+      std::decay_t<typename std::result_of<Solver(Input)>::type>;
 
-  return divide_conquer(std::forward<Input>(problem), std::forward<Divider>(divide_op),
-        std::forward<Predicate>(predicate_op),
-        std::forward<Solver>(solve_op), std::forward<Combiner>(combine_op),
-        num_threads);
+  return work_stealing_divide_conquer<result_type>(
+      std::forward<Input>(problem),
+      [&](auto && input, auto && split) -> result_type {
+        if (predicate_op(input)) { 
+          return solve_op(std::forward<Input>(input)); 
+        }
+        auto subproblems = divide_op(std::forward<Input>(input));
+        return split(subproblems);
+      },
+      std::forward<Combiner>(combine_op));
 }
 
 template <typename Generator, typename ... Transformers>
@@ -870,135 +1624,181 @@ void parallel_execution_native::pipeline(
   using namespace std;
   using result_type = decay_t<typename result_of<Generator()>::type>;
   using output_type = pair<result_type,long>;
-  auto output_queue = make_queue<output_type>();
-
-  thread generator_task([&,this]() {
-    auto manager = thread_manager();
+  auto output_queue =
+    get_single_producer_queue<output_type>(transform_ops...);
+  auto credit = make_reorder_credit(output_queue, transform_ops...);
 
+  worker_pool workers{1};
+  workers.launch(*this, [&]() {
     long order = 0;
     for (;;) {
-      auto item{generate_op()};
-      output_queue.push(make_pair(item, order));
+      auto item = is_cancelled() ? result_type{} : generate_op();
+      bool end = !item;
+      if (credit && !end) {
+        credit->acquire(order, [this] { return is_cancelled(); });
+      }
+      output_queue.push_with([&](output_type & slot) {
+        slot.first = std::move(item);
+        slot.second = order;
+      });
       order++;
-      if (!item) break;
+      if (end) break;
     }
   });
 
   do_pipeline(output_queue, forward<Transformers>(transform_ops)...);
-  generator_task.join();
+  workers.wait();
 }
 
 // PRIVATE MEMBERS
 
-template <typename Input, typename Divider, typename Solver, typename Combiner>
-auto parallel_execution_native::divide_conquer(
-    Input && input, 
-    Divider && divide_op, 
-    Solver && solve_op, 
-    Combiner && combine_op,
-    std::atomic<int> & num_threads) const
+template <typename F>
+void parallel_execution_native::for_each_index(std::size_t n, F && f) const
 {
-  constexpr sequential_execution seq;
-  if (num_threads.load() <=0) {
-    return seq.divide_conquer(std::forward<Input>(input), 
-        std::forward<Divider>(divide_op), std::forward<Solver>(solve_op), 
-        std::forward<Combiner>(combine_op));
-  }
-
-  auto subproblems = divide_op(std::forward<Input>(input));
-  if (subproblems.size()<=1) { return solve_op(std::forward<Input>(input)); }
-
-  using subresult_type = 
-      std::decay_t<typename std::result_of<Solver(Input)>::type>;
-  std::vector<subresult_type> partials(subproblems.size()-1);
-
-  auto process_subproblem = [&,this](auto it, std::size_t div) {
-    partials[div] = this->divide_conquer(std::forward<Input>(*it), 
-        std::forward<Divider>(divide_op), std::forward<Solver>(solve_op), 
-        std::forward<Combiner>(combine_op), num_threads);
+  std::atomic<std::size_t> next_index{0};
+  auto process_indices = [&]() {
+    for (;;) {
+      auto i = next_index.fetch_add(1, std::memory_order_relaxed);
+      if (i >= n) return;
+      f(i);
+    }
   };
 
-  int division = 0;
-
-  worker_pool workers{num_threads.load()};
-  auto i = subproblems.begin() + 1;
-  while (i!=subproblems.end() && num_threads.load()>0) {
-    workers.launch(*this,process_subproblem, i++, division++);
-    num_threads--;
+  const auto nworkers = std::min<std::size_t>(n, 
+      static_cast<std::size_t>(std::max(concurrency_degree_, 1)));
+  worker_pool workers{static_cast<int>(nworkers) - 1};
+  for (std::size_t i=1; i<nworkers; ++i) {
+    workers.launch(*this, process_indices);
   }
-
-  while (i!=subproblems.end()) {
-    partials[division] = seq.divide_conquer(std::forward<Input>(*i++), 
-        std::forward<Divider>(divide_op), std::forward<Solver>(solve_op), 
-        std::forward<Combiner>(combine_op));
-  }
-
-  auto subresult = divide_conquer(std::forward<Input>(*subproblems.begin()), 
-      std::forward<Divider>(divide_op), std::forward<Solver>(solve_op), 
-      std::forward<Combiner>(combine_op), num_threads);
-
+  process_indices();
   workers.wait();
-
-  return seq.reduce(partials.begin(), partials.size(), 
-      std::forward<subresult_type>(subresult), std::forward<Combiner>(combine_op));
 }
 
-template <typename Input, typename Divider,typename Predicate, typename Solver, typename Combiner>
-auto parallel_execution_native::divide_conquer(
-    Input && input,
-    Divider && divide_op,
-    Predicate && predicate_op,
-    Solver && solve_op,
-    Combiner && combine_op,
-    std::atomic<int> & num_threads) const
+inline std::vector<std::size_t> parallel_execution_native::make_chunks(
+    std::size_t size) const
 {
-  constexpr sequential_execution seq;
-  if (num_threads.load() <=0) {
-    return seq.divide_conquer(std::forward<Input>(input),
-        std::forward<Divider>(divide_op),
-        std::forward<Predicate>(predicate_op),
-        std::forward<Solver>(solve_op),
-        std::forward<Combiner>(combine_op));
+  const auto nthreads = static_cast<std::size_t>(
+      std::max(concurrency_degree_, 1));
+  std::vector<std::size_t> bounds{0};
+  switch (schedule_) {
+    case loop_schedule::static_chunks:
+      for (std::size_t i=1; i<=nthreads; ++i) {
+        bounds.push_back(size * i / nthreads);
+      }
+      break;
+    case loop_schedule::dynamic_chunks: {
+      // By default, about eight chunks per thread
+      const auto chunk = schedule_chunk_ > 0 ? 
+          schedule_chunk_ : std::max<std::size_t>(size / (8*nthreads), 1);
+      for (std::size_t offset = chunk; offset < size; offset += chunk) {
+        bounds.push_back(offset);
+      }
+      bounds.push_back(size);
+      break;
+    }
+    case loop_schedule::guided_chunks: {
+      // Chunks proportional to the remaining elements
+      const auto min_chunk = std::max<std::size_t>(schedule_chunk_, 1);
+      std::size_t offset = 0;
+      do {
+        offset += std::max((size - offset) / nthreads, min_chunk);
+        bounds.push_back(std::min(offset, size));
+      } 
+      while (offset < size);
+      break;
+    }
   }
+  return bounds;
+}
 
-  if (predicate_op(input)) { return solve_op(std::forward<Input>(input)); }
-  auto subproblems = divide_op(std::forward<Input>(input));
+template <typename ChunkProcessor>
+void parallel_execution_native::for_each_chunk(
+    std::vector<std::size_t> const & bounds,
+    ChunkProcessor && process_chunk) const
+{
+  for_each_index(bounds.size() - 1, [&](std::size_t i) {
+    if (is_cancelled()) return;
+    process_chunk(i, bounds[i], bounds[i+1] - bounds[i]);
+  });
+}
 
-  using subresult_type =
-      std::decay_t<typename std::result_of<Solver(Input)>::type>;
-  std::vector<subresult_type> partials(subproblems.size()-1);
+template <typename Result, typename Input, typename Expander,
+          typename Combiner>
+Result parallel_execution_native::work_stealing_divide_conquer(
+    Input && problem,
+    Expander && expand_op,
+    Combiner && combine_op) const
+{
+  using namespace std;
+  using input_type = decay_t<Input>;
 
-  auto process_subproblem = [&,this](auto it, std::size_t div) {
-    partials[div] = this->divide_conquer(std::forward<Input>(*it),
-        std::forward<Divider>(divide_op), std::forward<Predicate>(predicate_op),
-        std::forward<Solver>(solve_op),
-        std::forward<Combiner>(combine_op), num_threads);
+  struct task {
+    input_type input;
+    Result * result;
+    atomic<int> * pending;
   };
 
-  int division = 0;
+  work_stealing_scheduler<task> scheduler{concurrency_degree_};
+
+  // Runs available tasks until ready holds, waiting for a task to be pushed
+  // or completed when there is none
+  auto help_until = [&](auto & solve_task, int worker, auto && ready) {
+    while (!ready()) {
+      const auto seen = scheduler.events();
+      auto t = scheduler.take(worker);
+      if (!t) {
+        scheduler.wait(seen, ready);
+        continue;
+      }
+      *t->result = solve_task(solve_task, t->input, worker);
+      t->pending->fetch_sub(1, memory_order_release);
+      scheduler.signal();
+    }
+  };
 
-  worker_pool workers{num_threads.load()};
-  auto i = subproblems.begin() + 1;
-  while (i!=subproblems.end() && num_threads.load()>0) {
-    workers.launch(*this,process_subproblem, i++, division++);
-    num_threads--;
-  }
+  // Subproblems other than the first one are pushed in the deque of the 
+  // worker to be stolen, while the first one is solved in place.
+  auto solve_task = [&](auto & self, auto && input, int worker) -> Result {
+    return expand_op(input, [&](auto & subproblems) -> Result {
+      const auto n = subproblems.size();
+      vector<Result> partials(n-1);
+      atomic<int> pending{static_cast<int>(n-1)};
+      vector<task> children;
+      children.reserve(n-1);
+      for (std::size_t i=1; i<n; ++i) {
+        children.push_back(task{std::move(subproblems[i]), &partials[i-1], 
+            &pending});
+      }
+      for (auto & child : children) {
+        scheduler.push(worker, &child);
+      }
 
-  while (i!=subproblems.end()) {
-    partials[division] = seq.divide_conquer(std::forward<Input>(*i++),
-        std::forward<Divider>(divide_op), std::forward<Predicate>(predicate_op), std::forward<Solver>(solve_op),
-        std::forward<Combiner>(combine_op));
-  }
+      auto result = self(self, *subproblems.begin(), worker);
+      help_until(self, worker, 
+          [&] { return pending.load(memory_order_acquire) == 0; });
+      for (auto & partial : partials) {
+        result = combine_op(result, partial);
+      }
+      return result;
+    });
+  };
 
-  auto subresult = divide_conquer(std::forward<Input>(*subproblems.begin()),
-      std::forward<Divider>(divide_op), std::forward<Predicate>(predicate_op), std::forward<Solver>(solve_op),
-      std::forward<Combiner>(combine_op), num_threads);
+  atomic<bool> done{false};
+  worker_pool workers{concurrency_degree_-1};
+  for (int i=1; i<concurrency_degree_; ++i) {
+    workers.launch(*this, [&](int worker) {
+      help_until(solve_task, worker, 
+          [&] { return done.load(memory_order_acquire); });
+    }, i);
+  }
 
+  auto result = solve_task(solve_task, problem, 0);
+  done.store(true, memory_order_release);
+  scheduler.signal();
   workers.wait();
-
-  return seq.reduce(partials.begin(), partials.size(),
-      std::forward<subresult_type>(subresult), std::forward<Combiner>(combine_op));
+  return result;
 }
+
 template <typename Queue, typename Consumer,
           requires_no_pattern<Consumer>>
 void parallel_execution_native::do_pipeline(
@@ -1009,41 +1809,32 @@ void parallel_execution_native::do_pipeline(
   using input_type = typename Queue::value_type;
 
   auto manager = thread_manager();
+  vector<input_type> batch(queue_batch_size);
   if (!is_ordered()) {
     for (;;) {
-      auto item = input_queue.pop();
-      if (!item.first) break;
-      consume_op(*item.first);
+      auto n = input_queue.pop_n(batch.data(), batch.size());
+      for (std::size_t i=0; i<n; ++i) {
+        if (!batch[i].first) return;
+        if (is_cancelled()) continue;
+        invoke_on_item(consume_op, *batch[i].first);
+      }
     }
-    return;
   }
-  vector<input_type> elements;
-  long current = 0;
+  using value_type = typename input_type::first_type::value_type;
+  reorder_buffer<value_type> pending{
+      static_cast<std::size_t>(reorder_capacity_)};
+  auto credit = input_queue.get_reorder_credit();
   for (;;) {
-    auto item = input_queue.pop();
-    if (!item.first) break;
-    if(current == item.second){
-      consume_op(*item.first);
-      current ++;
-    }
-    else {
-      elements.push_back(item);
-    }
-    auto it = find_if(elements.begin(), elements.end(), 
-       [&](auto x) { return x.second== current; });
-    if(it != elements.end()){
-      consume_op(*it->first);
-      elements.erase(it);
-      current++;
-    }
-  }
-  while (elements.size()>0) {
-    auto it = find_if(elements.begin(), elements.end(), 
-       [&](auto x) { return x.second== current; });
-    if(it != elements.end()){
-      consume_op(*it->first);
-      elements.erase(it);
-      current++;
+    auto n = input_queue.pop_n(batch.data(), batch.size());
+    for (std::size_t i=0; i<n; ++i) {
+      auto & item = batch[i];
+      if (!item.first) return;
+      if (is_cancelled()) continue;
+      pending.insert(item.second, std::move(*item.first));
+      auto released = pending.release_ready([&](value_type & value) { 
+        invoke_on_item(consume_op, value); 
+      });
+      if (credit && released) credit->release(pending.next());
     }
   }
 }
@@ -1060,8 +1851,10 @@ void parallel_execution_native::do_pipeline(Inqueue & input_queue, Transformer &
   for (;;) {
     auto item{input_queue.pop()}; 
     if(!item.first) break;
-    auto out = output_item_value_type{transform_op(*item.first)};
-    output_queue.push(make_pair(out,item.second)) ;
+    if (is_cancelled()) continue;
+    output_queue.push(make_pair(
+        output_item_value_type{invoke_on_item(transform_op, *item.first)},
+        item.second));
   }
 }
 
@@ -1074,34 +1867,90 @@ void parallel_execution_native::do_pipeline(
     Queue & input_queue, 
     Transformer && transform_op,
     OtherTransformers && ... other_transform_ops) const
+{
+  if (stage_fusion_) {
+    fuse_stages(input_queue, std::forward<Transformer>(transform_op),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+  else {
+    do_transform_stage(input_queue, std::forward<Transformer>(transform_op),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+}
+
+template <typename Queue, typename Transformer, 
+          typename ... OtherTransformers>
+void parallel_execution_native::do_transform_stage(
+    Queue & input_queue, 
+    Transformer && transform_op,
+    OtherTransformers && ... other_transform_ops) const
 {
   using namespace std;
 
   using input_item_type = typename Queue::value_type;
   using input_item_value_type = typename input_item_type::first_type::value_type;
   using transform_result_type = 
-      decay_t<typename result_of<Transformer(input_item_value_type)>::type>;
+      decay_t<item_result_t<Transformer,input_item_value_type>>;
   using output_item_value_type = grppi::optional<transform_result_type>;
   using output_item_type = pair<output_item_value_type,long>;
 
   decltype(auto) output_queue =
-    get_output_queue<output_item_type>(other_transform_ops...);
+    get_single_producer_queue<output_item_type>(other_transform_ops...);
+  output_queue.set_reorder_credit(input_queue.get_reorder_credit());
 
-  thread task([&,this]() {
-    auto manager = thread_manager();
-
-    for (;;) {
-      auto item{input_queue.pop()};
-      if (!item.first) break;
-      auto out = output_item_value_type{transform_op(*item.first)};
-      output_queue.push(make_pair(out, item.second));
+  worker_pool workers{1};
+  workers.launch(*this, [&]() {
+    vector<input_item_type> batch(queue_batch_size);
+    vector<output_item_type> results;
+    results.reserve(queue_batch_size);
+    bool end_of_stream = false;
+    while (!end_of_stream) {
+      auto n = input_queue.pop_n(batch.data(), batch.size());
+      for (std::size_t i=0; i<n; ++i) {
+        auto & item = batch[i];
+        if (!item.first) {
+          end_of_stream = true;
+          break;
+        }
+        if (is_cancelled()) continue;
+        results.emplace_back(
+            output_item_value_type{invoke_on_item(transform_op, *item.first)},
+            item.second);
+      }
+      output_queue.push_n(results.data(), results.data() + results.size());
+      results.clear();
     }
     output_queue.push(make_pair(output_item_value_type{},-1));
   });
 
   do_pipeline(output_queue, 
       forward<OtherTransformers>(other_transform_ops)...);
-  task.join();
+  workers.wait();
+}
+
+template <typename Queue, typename Processor>
+int parallel_execution_native::farm_worker(
+    Queue & input_queue,
+    std::size_t worker,
+    Processor && process_op) const
+{
+  auto item{input_queue.pop_from(worker)};
+  while (item.first) {
+    process_op(item);
+    item = input_queue.pop_from(worker);
+  }
+
+  // With a sharded queue other shards may still hold items.
+  int markers = 1;
+  while (input_queue.try_pop(item)) {
+    if (item.first) {
+      process_op(item);
+    }
+    else {
+      markers++;
+    }
+  }
+  return markers;
 }
 
 template <typename Queue, typename FarmTransformer,
@@ -1113,13 +1962,19 @@ void parallel_execution_native::do_pipeline(
 {
   using namespace std;
 
+  using input_item_type = typename Queue::value_type;
+
+  atomic<int> next_worker{0};
   auto farm_task = [&](int) {
-    auto item{input_queue.pop()}; 
-    while (item.first) {
-      farm_obj(*item.first);
-      item = input_queue.pop();
+    auto markers = farm_worker(input_queue, next_worker++,
+        [&](input_item_type & item) { 
+          if (!is_cancelled()) {
+            invoke_on_item(farm_obj.transformer(), *item.first);
+          }
+        });
+    for (int i=0; i<markers; ++i) {
+      input_queue.push(input_item_type{});
     }
-    input_queue.push(item);
   };
 
   auto ntasks = farm_obj.cardinality();
@@ -1148,6 +2003,9 @@ void parallel_execution_native::do_pipeline(Queue & input_queue,
 
   decltype(auto) output_queue =
     get_output_queue<output_item_type>(other_ops...);
+  if (keeps_order_numbers<Transformer>) {
+    output_queue.set_reorder_credit(input_queue.get_reorder_credit());
+  }
   
   auto context_task = [&]() {
     context_op.execution_policy().pipeline(input_queue, context_op.transformer(), output_queue);
@@ -1184,16 +2042,26 @@ void parallel_execution_native::do_pipeline(
 
   decltype(auto) output_queue = 
     get_output_queue<output_item_type>(other_transform_ops...);
+  output_queue.set_reorder_credit(input_queue.get_reorder_credit());
 
   atomic<int> done_threads{0};
+  atomic<int> next_worker{0};
 
   auto farm_task = [&](int nt) {
-    do_pipeline(input_queue, farm_obj.transformer(), output_queue);
-    done_threads++;
-    if (done_threads == nt) {
+    auto markers = farm_worker(input_queue, next_worker++,
+        [&](input_item_type & item) {
+          if (is_cancelled()) return;
+          output_queue.push(make_pair(
+              output_optional_type{
+                  invoke_on_item(farm_obj.transformer(), *item.first)},
+              item.second));
+        });
+    if (++done_threads == nt) {
       output_queue.push(make_pair(output_optional_type{}, -1));
     }else{
-      input_queue.push(input_item_type{});
+      for (int i=0; i<markers; ++i) {
+        input_queue.push(input_item_type{});
+      }
     }
   };
 
@@ -1219,119 +2087,251 @@ void parallel_execution_native::do_pipeline(
 
   using input_item_type = typename Queue::value_type;
   using input_value_type = typename input_item_type::first_type;
-  auto filter_queue = make_queue<input_item_type>();
 
+  decltype(auto) output_queue =
+    get_single_producer_queue<input_item_type>(other_transform_ops...);
+  auto output_credit = make_reorder_credit(output_queue, other_transform_ops...);
+
+  // Discarded items are only recorded as gaps in the reorder buffer, so
+  // that no item is forwarded for them. Kept items are sent before waiting
+  // for credit, as the next stages may need them to hand it back.
   auto filter_task = [&,this]() {
-    auto manager = thread_manager();
-    auto item{input_queue.pop()};
-    while (item.first) {
-      if (filter_obj(*item.first)) {
-        filter_queue.push(item);
-      }
-      else {
-        filter_queue.push(make_pair(input_value_type{}, item.second));
+    vector<input_item_type> batch(queue_batch_size);
+    vector<input_item_type> kept;
+    kept.reserve(queue_batch_size);
+    reorder_buffer<input_value_type> pending{
+        static_cast<std::size_t>(reorder_capacity_)};
+    auto input_credit = input_queue.get_reorder_credit();
+    auto send_kept = [&] {
+      output_queue.push_n(kept.data(), kept.data() + kept.size());
+      kept.clear();
+    };
+    long order = 0;
+    bool end_of_stream = false;
+    while (!end_of_stream) {
+      auto n = input_queue.pop_n(batch.data(), batch.size());
+      for (std::size_t i=0; i<n; ++i) {
+        auto & item = batch[i];
+        if (!item.first) {
+          end_of_stream = true;
+          break;
+        }
+        if (!is_ordered()) {
+          if (filter_obj(*item.first)) kept.push_back(std::move(item));
+          continue;
+        }
+        if (is_cancelled()) continue;
+        if (!filter_obj(*item.first)) item.first = input_value_type{};
+        pending.insert(item.second, std::move(item.first));
+        auto released = pending.release_ready([&](input_value_type & value) {
+          if (!value) return;
+          if (output_credit && !output_credit->available(order)) {
+            send_kept();
+            output_credit->acquire(order, [this] { return is_cancelled(); });
+          }
+          kept.emplace_back(std::move(value), order++);
+        });
+        if (input_credit && released) input_credit->release(pending.next());
       }
-      item = input_queue.pop();
+      send_kept();
     }
-    filter_queue.push(make_pair(input_value_type{}, -1));
+    output_queue.push(make_pair(input_value_type{}, -1));
   };
-  thread filter_thread{filter_task};
 
+  worker_pool workers{1};
+  workers.launch(*this, filter_task);
+  do_pipeline(output_queue, forward<OtherTransformers>(other_transform_ops)...);
+  workers.wait();
+}
+
+template <typename Queue, typename Combiner, typename Identity,
+          template <typename C, typename I> class Reduce,
+          typename ... OtherTransformers,
+          requires_reduce<Reduce<Combiner,Identity>>>
+void parallel_execution_native::do_pipeline(
+    Queue && input_queue, 
+    Reduce<Combiner,Identity> && reduce_obj,
+    OtherTransformers && ... other_transform_ops) const
+{
+  using namespace std;
+
+  using output_item_value_type = grppi::optional<decay_t<Identity>>;
+  using output_item_type = pair<output_item_value_type,long>;
   decltype(auto) output_queue =
-    get_output_queue<input_item_type>(other_transform_ops...);
-
-  thread ordering_thread;
-  if (is_ordered()) {
-    auto ordering_task = [&]() {
-      auto manager = thread_manager();
-      vector<input_item_type> elements;
-      int current = 0;
-      long order = 0;
-      auto item{filter_queue.pop()};
-      for (;;) {
-        if(!item.first && item.second == -1) break; 
-        if (item.second == current) {
-          if (item.first) {
-            output_queue.push(make_pair(item.first,order));
-            order++;
-          }
-          current++;
-        }
-        else {
-          elements.push_back(item);
+    get_single_producer_queue<output_item_type>(other_transform_ops...);
+  auto credit = make_reorder_credit(output_queue, other_transform_ops...);
+
+  auto reduce_task = [&,this]() {
+    using input_item_type = typename decay_t<Queue>::value_type;
+    vector<input_item_type> batch(queue_batch_size);
+    long order = 0;
+    bool end_of_stream = false;
+    while (!end_of_stream) {
+      auto n = input_queue.pop_n(batch.data(), batch.size());
+      for (std::size_t i=0; i<n; ++i) {
+        auto & item = batch[i];
+        if (!item.first) {
+          end_of_stream = true;
+          break;
         }
-        auto it = find_if(elements.begin(), elements.end(), 
-           [&](auto x) { return x.second== current; });
-        if(it != elements.end()){
-          if (it->first) {
-            output_queue.push(make_pair(it->first,order));
-            order++;
-          }       
-          elements.erase(it);
-          current++;
+        reduce_obj.add_item(std::forward<Identity>(*item.first));
+        if (reduce_obj.reduction_needed()) {
+          constexpr sequential_execution seq;
+          auto red = reduce_obj.reduce_window(seq);
+          if (credit) {
+            credit->acquire(order, [this] { return is_cancelled(); });
+          }
+          output_queue.push(make_pair(std::move(red), order++));
         }
-        item = filter_queue.pop();
       }
-      while (elements.size()>0) {
-        auto it = find_if(elements.begin(), elements.end(), 
-           [&](auto x) { return x.second== current; });
-        if(it != elements.end()){
-          if (it->first) {
-            output_queue.push(make_pair(it->first,order));
-            order++;
-          }       
-          elements.erase(it);
-          current++;
+    }
+    output_queue.push(make_pair(output_item_value_type{}, -1));
+  };
+  worker_pool workers{1};
+  workers.launch(*this, reduce_task);
+  do_pipeline(output_queue, forward<OtherTransformers>(other_transform_ops)...);
+  workers.wait();
+}
+
+template <typename Queue, typename KeyExtractor, typename Combiner,
+          typename Identity,
+          template <typename K, typename C, typename I> class KeyedReduce,
+          typename ... OtherTransformers,
+          requires_reduce_by_key<KeyedReduce<KeyExtractor,Combiner,Identity>>>
+void parallel_execution_native::do_pipeline(
+    Queue & input_queue, 
+    KeyedReduce<KeyExtractor,Combiner,Identity> && reduce_obj,
+    OtherTransformers && ... other_transform_ops) const
+{
+  using namespace std;
+
+  using input_item_type = typename Queue::value_type;
+  using input_value_type = typename input_item_type::first_type::value_type;
+  using reduce_type = KeyedReduce<KeyExtractor,Combiner,Identity>;
+  using key_type = typename reduce_type::template key_type<input_value_type>;
+  using result_type = 
+      typename reduce_type::template result_type<input_value_type>;
+  using output_item_value_type = grppi::optional<result_type>;
+  using output_item_type = pair<output_item_value_type,long>;
+  decltype(auto) output_queue =
+    get_output_queue<output_item_type>(other_transform_ops...);
+  auto credit = make_reorder_credit(output_queue, other_transform_ops...);
+
+  // Every replica owns the windows of the keys routed to its queue
+  using routed_type = grppi::optional<pair<key_type,input_value_type>>;
+  const int nreplicas = reduce_obj.replicas();
+  vector<mpmc_queue<routed_type>> replica_queues;
+  replica_queues.reserve(nreplicas);
+  for (int i=0; i<nreplicas; ++i) {
+    replica_queues.push_back(make_spsc_queue<routed_type>());
+  }
+
+  auto route_task = [&]() {
+    vector<input_item_type> batch(queue_batch_size);
+    bool end_of_stream = false;
+    while (!end_of_stream) {
+      auto n = input_queue.pop_n(batch.data(), batch.size());
+      for (std::size_t i=0; i<n; ++i) {
+        auto & item = batch[i];
+        if (!item.first) {
+          end_of_stream = true;
+          break;
         }
+        if (is_cancelled()) continue;
+        auto key = reduce_obj.key(*item.first);
+        const auto replica = reduce_obj.replica(key);
+        replica_queues[replica].push(routed_type{
+            make_pair(std::move(key), std::move(*item.first))});
+      }
+    }
+    for (auto & queue : replica_queues) {
+      queue.push(routed_type{});
+    }
+  };
+
+  atomic<long> order{0};
+  atomic<int> done_replicas{0};
+  auto replica_task = [&](int replica) {
+    auto windows = reduce_obj.template make_windows<input_value_type>();
+    auto emit = [&](key_type const & key, auto && result) {
+      const long item_order = order++;
+      if (credit) {
+        credit->acquire(item_order, [this] { return is_cancelled(); });
       }
-      output_queue.push(item);
+      output_queue.push(make_pair(
+          output_item_value_type{make_pair(key, std::move(result))},
+          item_order));
     };
+    for (;;) {
+      auto item = replica_queues[replica].pop();
+      if (!item) break;
+      windows.add_item(std::move(item->first), std::move(item->second), emit);
+    }
+    if (++done_replicas == nreplicas) {
+      output_queue.push(make_pair(output_item_value_type{}, -1));
+    }
+  };
 
-    ordering_thread = thread{ordering_task};
-    do_pipeline(output_queue, forward<OtherTransformers>(other_transform_ops)...);
-    filter_thread.join();
-    ordering_thread.join();
-  }
-  else {
-    do_pipeline(filter_queue, forward<OtherTransformers>(other_transform_ops)...);
-    filter_thread.join();
+  worker_pool workers{nreplicas + 1};
+  workers.launch(*this, route_task);
+  for (int i=0; i<nreplicas; ++i) {
+    workers.launch(*this, replica_task, i);
   }
+  do_pipeline(output_queue, forward<OtherTransformers>(other_transform_ops)...);
+  workers.wait();
 }
 
-template <typename Queue, typename Combiner, typename Identity,
-          template <typename C, typename I> class Reduce,
+template <typename Queue, typename Timestamper, typename Combiner,
+          typename Identity,
+          template <typename T, typename C, typename I> class TimeReduce,
           typename ... OtherTransformers,
-          requires_reduce<Reduce<Combiner,Identity>>>
+          requires_reduce_by_time<TimeReduce<Timestamper,Combiner,Identity>>>
 void parallel_execution_native::do_pipeline(
-    Queue && input_queue, 
-    Reduce<Combiner,Identity> && reduce_obj,
+    Queue & input_queue, 
+    TimeReduce<Timestamper,Combiner,Identity> && reduce_obj,
     OtherTransformers && ... other_transform_ops) const
 {
   using namespace std;
 
-  using output_item_value_type = grppi::optional<decay_t<Identity>>;
+  using input_item_type = typename Queue::value_type;
+  using result_type = 
+      typename TimeReduce<Timestamper,Combiner,Identity>::result_type;
+  using output_item_value_type = grppi::optional<result_type>;
   using output_item_type = pair<output_item_value_type,long>;
+
   decltype(auto) output_queue =
-    get_output_queue<output_item_type>(other_transform_ops...);
+    get_single_producer_queue<output_item_type>(other_transform_ops...);
+  auto credit = make_reorder_credit(output_queue, other_transform_ops...);
 
+  // Waits at most a slide for the next item, so that the watermark keeps
+  // advancing and windows are reduced when the input goes quiet
   auto reduce_task = [&,this]() {
-    auto manager = thread_manager();
-    auto item{input_queue.pop()};
-    int order = 0;
-    while (item.first) {
-      reduce_obj.add_item(std::forward<Identity>(*item.first));
-      item = input_queue.pop();
-      if (reduce_obj.reduction_needed()) {
-        constexpr sequential_execution seq;
-        auto red = reduce_obj.reduce_window(seq);
-        output_queue.push(make_pair(red, order++));
+    long order = 0;
+    auto emit = [&](result_type && result) {
+      if (credit) {
+        credit->acquire(order, [this] { return is_cancelled(); });
+      }
+      output_queue.push(make_pair(
+          output_item_value_type{std::move(result)}, order++));
+    };
+    input_item_type item;
+    for (;;) {
+      if (!input_queue.pop_for(item, reduce_obj.slide())) {
+        reduce_obj.advance(chrono::steady_clock::now(), emit);
+        continue;
       }
+      if (!item.first) break;
+      if (is_cancelled()) continue;
+      reduce_obj.add_item(*item.first, emit);
     }
+    if (!is_cancelled()) reduce_obj.flush(emit);
     output_queue.push(make_pair(output_item_value_type{}, -1));
   };
-  thread reduce_thread{reduce_task};
+
+  worker_pool workers{1};
+  workers.launch(*this, reduce_task);
   do_pipeline(output_queue, forward<OtherTransformers>(other_transform_ops)...);
-  reduce_thread.join();
+  workers.wait();
 }
 
 template <typename Queue, typename Transformer, typename Predicate,
@@ -1349,38 +2349,38 @@ void parallel_execution_native::do_pipeline(
   using input_item_type = typename decay_t<Queue>::value_type;
 
   decltype(auto) output_queue =
-    get_output_queue<input_item_type>(other_transform_ops...);
+    get_single_producer_queue<input_item_type>(other_transform_ops...);
+  output_queue.set_reorder_credit(input_queue.get_reorder_credit());
+
+  auto iterate = [&](input_item_type & item) {
+    auto value = invoke_on_item(iteration_obj.transformer(), *item.first);
+    bool done = iteration_obj.predicate(value);
+    auto new_item = input_item_type{std::move(value),item.second};
+    if (done) {
+      output_queue.push(std::move(new_item));
+    }
+    else {
+      input_queue.push(std::move(new_item));
+    }
+  };
 
   auto iteration_task = [&]() {
     for (;;) {
       auto item = input_queue.pop();
       if (!item.first) break;
-      auto value = iteration_obj.transform(*item.first);
-      auto new_item = input_item_type{value,item.second};
-      if (iteration_obj.predicate(value)) {
-        output_queue.push(new_item);
-      }
-      else {
-        input_queue.push(new_item);
-      }
+      iterate(item);
     }
     while (!input_queue.empty()) {
       auto item = input_queue.pop();
-      auto value = iteration_obj.transform(*item.first);
-      auto new_item = input_item_type{value,item.second};
-      if (iteration_obj.predicate(value)) {
-        output_queue.push(new_item);
-      }
-      else {
-        input_queue.push(new_item);
-      }
+      iterate(item);
     }
     output_queue.push(input_item_type{{},-1});
   };
 
-  thread iteration_thread{iteration_task};
+  worker_pool workers{1};
+  workers.launch(*this, iteration_task);
   do_pipeline(output_queue, forward<OtherTransformers>(other_transform_ops)...);
-  iteration_thread.join();
+  workers.wait();
 }
 
 template <typename Queue, typename Transformer, typename Predicate,
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_NATIVE_THREAD_POOL_H
+#define GRPPI_NATIVE_THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <vector>
+
+namespace grppi {
+
+/**
+\brief Pool of persistent threads executing submitted tasks.
+
+Threads are started lazily on the first submission and are reused by later
+submissions. Every submitted task is guaranteed to get a thread without
+waiting for another task to finish: when all threads are busy the pool
+grows by one thread. This is needed as tasks of a pipeline block on each
+other. Threads above the capacity of the last submission exit after being
+idle for a while, so that a wide pattern does not keep its threads alive.
+*/
+class thread_pool {
+public:
+
+  /**
+  \brief Creates a pool without starting any thread.
+  \param capacity Number of threads started on the first submission.
+  \param idle_timeout Time after which an idle thread above the capacity
+  exits.
+  */
+  explicit thread_pool(int capacity,
+      std::chrono::milliseconds idle_timeout = std::chrono::seconds{1})
+      noexcept :
+    capacity_{capacity},
+    idle_timeout_{idle_timeout}
+  {}
+
+  /**
+  \brief Destructs the pool after joining with all its threads.
+  \pre All submitted tasks have finished or will finish without
+  submitting new tasks.
+  */
+  ~thread_pool() noexcept;
+
+  thread_pool(thread_pool const &) = delete;
+  thread_pool & operator=(thread_pool const &) = delete;
+
+  /**
+  \brief Submits a task for execution in a thread of the pool.
+  \param task Task to be executed.
+  */
+  void submit(std::function<void()> task);
+
+  /**
+  \brief Submits a task for execution in a thread of the pool, setting the
+  number of threads kept by the pool.
+  \param task Task to be executed.
+  \param capacity Number of threads kept by the pool from now on.
+  */
+  void submit(std::function<void()> task, int capacity);
+
+  /**
+  \brief Gets the number of threads running in the pool.
+  */
+  int size() const noexcept {
+    std::lock_guard<std::mutex> lk{mut_};
+    return static_cast<int>(threads_.size());
+  }
+
+private:
+  using thread_list = std::list<std::thread>;
+
+  void start_thread();
+  void run(thread_list::iterator self) noexcept;
+  void join_retired() noexcept;
+
+private:
+  int capacity_;
+  const std::chrono::milliseconds idle_timeout_;
+
+  mutable std::mutex mut_{};
+  std::condition_variable wakeup_{};
+  std::deque<std::function<void()>> tasks_{};
+  thread_list threads_{};
+
+  /// Threads that exited after being idle, still to be joined.
+  std::vector<std::thread> retired_{};
+
+  /// Number of threads running a task.
+  std::size_t busy_ = 0;
+
+  bool stop_ = false;
+};
+
+inline thread_pool::~thread_pool() noexcept
+{
+  {
+    std::lock_guard<std::mutex> lk{mut_};
+    stop_ = true;
+  }
+  wakeup_.notify_all();
+  // Threads do not retire once stopped, so the lists do not change
+  for (auto & t : threads_) { t.join(); }
+  for (auto & t : retired_) { t.join(); }
+}
+
+inline void thread_pool::submit(std::function<void()> task)
+{
+  int capacity;
+  {
+    std::lock_guard<std::mutex> lk{mut_};
+    capacity = capacity_;
+  }
+  submit(std::move(task), capacity);
+}
+
+inline void thread_pool::submit(std::function<void()> task, int capacity)
+{
+  join_retired();
+  {
+    std::lock_guard<std::mutex> lk{mut_};
+    capacity_ = capacity;
+    tasks_.push_back(std::move(task));
+    while (threads_.size() < static_cast<std::size_t>(capacity_)) {
+      start_thread();
+    }
+    // Every queued task needs a thread not running another task
+    if (threads_.size() - busy_ < tasks_.size()) {
+      start_thread();
+    }
+  }
+  wakeup_.notify_one();
+}
+
+inline void thread_pool::start_thread()
+{
+  threads_.emplace_back();
+  auto self = std::prev(threads_.end());
+  *self = std::thread{[this,self]() { run(self); }};
+}
+
+inline void thread_pool::run(thread_list::iterator self) noexcept
+{
+  std::unique_lock<std::mutex> lk{mut_};
+  for (;;) {
+    if (!wakeup_.wait_for(lk, idle_timeout_,
+        [this] { return !tasks_.empty() || stop_; }))
+    {
+      // Idle threads above the capacity are joined by a later submission
+      if (threads_.size() > static_cast<std::size_t>(capacity_)) {
+        retired_.push_back(std::move(*self));
+        threads_.erase(self);
+        return;
+      }
+      continue;
+    }
+    if (tasks_.empty()) return;
+    auto task = std::move(tasks_.front());
+    tasks_.pop_front();
+    busy_++;
+    lk.unlock();
+    task();
+    lk.lock();
+    busy_--;
+  }
+}
+
+inline void thread_pool::join_retired() noexcept
+{
+  std::vector<std::thread> retired;
+  {
+    std::lock_guard<std::mutex> lk{mut_};
+    retired.swap(retired_);
+  }
+  for (auto & t : retired) { t.join(); }
+}
+
+}
+
+#endif
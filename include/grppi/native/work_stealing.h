@@ -0,0 +1,273 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_NATIVE_WORK_STEALING_H
+#define GRPPI_NATIVE_WORK_STEALING_H
+
+#include "../common/wait_policy.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+namespace grppi {
+
+/**
+\brief Chase-Lev work-stealing deque of pointers to tasks.
+
+The owner thread pushes and pops tasks at the bottom of the deque, while
+other threads steal tasks from the top. The buffer grows when full. Old
+buffers are kept until the deque is destroyed, as a thief may still be
+reading from them.
+\tparam T Type of the tasks.
+*/
+template <typename T>
+class work_stealing_deque {
+public:
+
+  /**
+  \brief Constructs an empty deque.
+  \param capacity Initial capacity (rounded up to a power of two).
+  */
+  explicit work_stealing_deque(std::size_t capacity = 64);
+
+  work_stealing_deque(work_stealing_deque const &) = delete;
+  work_stealing_deque & operator=(work_stealing_deque const &) = delete;
+
+  /**
+  \brief Pushes a task at the bottom of the deque.
+  \pre Called by the owner thread.
+  */
+  void push(T * task);
+
+  /**
+  \brief Pops the last pushed task from the bottom of the deque.
+  \pre Called by the owner thread.
+  \return The popped task, or nullptr if the deque is empty.
+  */
+  T * pop() noexcept;
+
+  /**
+  \brief Steals the oldest task from the top of the deque.
+  \return The stolen task, or nullptr if the deque is empty or the task
+  was taken by another thread.
+  */
+  T * steal() noexcept;
+
+private:
+
+  struct buffer {
+    explicit buffer(std::size_t c) :
+      capacity{c}, mask{c-1}, items{new std::atomic<T*>[c]} {}
+
+    T * get(long i) const noexcept {
+      return items[i & mask].load(std::memory_order_relaxed);
+    }
+
+    void put(long i, T * x) noexcept {
+      items[i & mask].store(x, std::memory_order_relaxed);
+    }
+
+    std::size_t capacity;
+    std::size_t mask;
+    std::unique_ptr<std::atomic<T*>[]> items;
+  };
+
+  buffer * grow(buffer * old, long bottom, long top);
+
+private:
+  constexpr static std::size_t cache_line = 64;
+
+  alignas(cache_line) std::atomic<long> top_{0};
+  alignas(cache_line) std::atomic<long> bottom_{0};
+  std::atomic<buffer*> buffer_;
+
+  /// Every buffer allocated by the owner.
+  std::vector<std::unique_ptr<buffer>> buffers_{};
+};
+
+/**
+\brief Set of work-stealing deques with one deque per worker.
+
+Workers that find no task wait for an event, that is signalled whenever a
+task is pushed or a condition workers wait for may have changed. Waiting
+spins and yields for a while before parking the worker.
+\tparam T Type of the tasks.
+*/
+template <typename T>
+class work_stealing_scheduler {
+public:
+
+  /**
+  \brief Constructs a scheduler for a number of workers.
+  */
+  explicit work_stealing_scheduler(int num_workers);
+
+  /**
+  \brief Gets the number of workers.
+  */
+  int num_workers() const noexcept {
+    return static_cast<int>(deques_.size());
+  }
+
+  /**
+  \brief Pushes a task in the deque of a worker.
+  \pre Called by the worker owning the deque.
+  */
+  void push(int worker, T * task) { 
+    deques_[worker]->push(task); 
+    signal();
+  }
+
+  /**
+  \brief Gets a task for a worker.
+  Tasks are taken from the deque of the worker and, if it is empty, stolen
+  from the other workers.
+  \return The task, or nullptr if no task was found.
+  */
+  T * take(int worker) noexcept;
+
+  /**
+  \brief Gets the number of events signalled so far.
+  */
+  unsigned long events() const noexcept { 
+    return events_.load(std::memory_order_acquire); 
+  }
+
+  /**
+  \brief Signals an event to waiting workers.
+  \note Must be called after the change that workers may be waiting for.
+  */
+  void signal() noexcept {
+    events_.fetch_add(1, std::memory_order_release);
+    idle_.notify();
+  }
+
+  /**
+  \brief Waits until an event is signalled or a condition holds.
+  \param seen Number of events observed before looking for a task.
+  \param ready Predicate ending the wait when it returns true.
+  */
+  template <typename Predicate>
+  void wait(unsigned long seen, Predicate && ready) noexcept {
+    idle_.wait_until([&] { return events() != seen || ready(); });
+  }
+
+private:
+  std::vector<std::unique_ptr<work_stealing_deque<T>>> deques_;
+  std::atomic<unsigned long> events_{0};
+  backoff_wait idle_{};
+};
+
+template <typename T>
+work_stealing_deque<T>::work_stealing_deque(std::size_t capacity)
+{
+  std::size_t c = 1;
+  while (c < capacity) { c <<= 1; }
+  buffers_.emplace_back(new buffer{c});
+  buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+}
+
+template <typename T>
+void work_stealing_deque<T>::push(T * task)
+{
+  auto b = bottom_.load(std::memory_order_relaxed);
+  auto t = top_.load(std::memory_order_acquire);
+  auto a = buffer_.load(std::memory_order_relaxed);
+  if (b - t > static_cast<long>(a->capacity) - 1) {
+    a = grow(a, b, t);
+  }
+  a->put(b, task);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom_.store(b + 1, std::memory_order_relaxed);
+}
+
+template <typename T>
+T * work_stealing_deque<T>::pop() noexcept
+{
+  auto b = bottom_.load(std::memory_order_relaxed) - 1;
+  auto a = buffer_.load(std::memory_order_relaxed);
+  bottom_.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto t = top_.load(std::memory_order_relaxed);
+  if (t > b) {
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  T * task = a->get(b);
+  if (t == b) {
+    // Last task: race against thieves
+    if (!top_.compare_exchange_strong(t, t + 1,
+        std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      task = nullptr;
+    }
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+  return task;
+}
+
+template <typename T>
+T * work_stealing_deque<T>::steal() noexcept
+{
+  auto t = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto b = bottom_.load(std::memory_order_acquire);
+  if (t >= b) return nullptr;
+  auto a = buffer_.load(std::memory_order_acquire);
+  T * task = a->get(t);
+  if (!top_.compare_exchange_strong(t, t + 1,
+      std::memory_order_seq_cst, std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  return task;
+}
+
+template <typename T>
+typename work_stealing_deque<T>::buffer *
+work_stealing_deque<T>::grow(buffer * old, long bottom, long top)
+{
+  buffers_.emplace_back(new buffer{old->capacity * 2});
+  auto a = buffers_.back().get();
+  for (long i = top; i != bottom; ++i) {
+    a->put(i, old->get(i));
+  }
+  buffer_.store(a, std::memory_order_release);
+  return a;
+}
+
+template <typename T>
+work_stealing_scheduler<T>::work_stealing_scheduler(int num_workers)
+{
+  deques_.reserve(num_workers);
+  for (int i=0; i<num_workers; ++i) {
+    deques_.emplace_back(new work_stealing_deque<T>{});
+  }
+}
+
+template <typename T>
+T * work_stealing_scheduler<T>::take(int worker) noexcept
+{
+  if (auto task = deques_[worker]->pop()) return task;
+  const int n = num_workers();
+  for (int i=1; i<n; ++i) {
+    if (auto task = deques_[(worker + i) % n]->steal()) return task;
+  }
+  return nullptr;
+}
+
+}
+
+#endif
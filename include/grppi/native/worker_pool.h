@@ -16,36 +16,35 @@
 #ifndef GRPPI_NATIVE_WORKER_POOL_H
 #define GRPPI_NATIVE_WORKER_POOL_H
 
-#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace grppi {
 
 /**
-\brief Pool of worker threads.
-This class offers a simple pool of worker threads.
-\note Current version does not support more threads than the initially set
-number of threads.
+\brief Group of tasks launched in the thread pool of an execution policy.
+This class allows waiting for the completion of the launched tasks. Tasks
+run in the persistent threads of the execution policy instead of in newly
+created threads.
 */
 class worker_pool {
   public:
 
     /**
     \brief Creates a worker pool with a number of threads.
-    \param num_threads Number of threads for the pool.
+    \param num_threads Number of tasks launched by launch_tasks().
     */
     worker_pool(int num_threads) noexcept : 
-        num_threads_{num_threads},
-        workers_{}
+        num_threads_{num_threads}
     {}
 
     /**
-    \brief Destructs the worker pool after joining with all threads in the 
-    pool.
+    \brief Destructs the worker pool after waiting for all launched tasks.
     */
     ~worker_pool() noexcept { this->wait(); }
 
-    worker_pool(worker_pool &&) noexcept = default;
-    worker_pool & operator=(worker_pool &&) noexcept = default;
+    worker_pool(worker_pool const &) = delete;
+    worker_pool & operator=(worker_pool const &) = delete;
     
     /**
     \brief Launch a function in the pool.
@@ -55,22 +54,30 @@ class worker_pool {
     \param ex Execution policy.
     \param f Function to be launched.
     \param args Arguments for launched function.
+    \note The task is finished even if the function throws or the task
+    cannot be submitted, so that wait() does not block forever.
     */
     template <typename E, typename F, typename ... Args>
     void launch(const E & ex, F f, Args && ... args) {
-      workers_.emplace_back([=,&ex]() {
-        auto manager = ex.thread_manager();
-        f(args...);
-      });
+      start();
+      try {
+        ex.pool().submit([=,&ex]() {
+          // Destroyed after the thread manager has deregistered the thread
+          finish_guard guard{*this};
+          auto manager = ex.thread_manager();
+          f(args...);
+        }, ex.concurrency_degree());
+      }
+      catch (...) {
+        finish();
+        throw;
+      }
     }
 
     template <typename E, typename F, typename ... Args>
     void launch_tasks(const E & ex, F && f, Args && ... args) {
       for (int i=0; i<num_threads_; ++i) {
-        workers_.emplace_back([=,&ex]() {
-          auto manager = ex.thread_manager();
-          f(args...);
-        });
+        launch(ex, f, args...);
       }
     }
 
@@ -79,13 +86,39 @@ class worker_pool {
     \post Number of workers is 0.
     */
     void wait() noexcept {
-      for (auto && w : workers_) { w.join(); }
-      workers_.clear();
+      std::unique_lock<std::mutex> lk{mut_};
+      done_.wait(lk, [this] { return pending_ == 0; });
+    }
+
+  private:
+    /// Finishes a launched task on destruction.
+    class finish_guard {
+    public:
+      explicit finish_guard(worker_pool & pool) noexcept : pool_{pool} {}
+      ~finish_guard() { pool_.finish(); }
+
+      finish_guard(finish_guard const &) = delete;
+      finish_guard & operator=(finish_guard const &) = delete;
+
+    private:
+      worker_pool & pool_;
+    };
+
+    void start() {
+      std::lock_guard<std::mutex> lk{mut_};
+      pending_++;
+    }
+
+    void finish() noexcept {
+      std::lock_guard<std::mutex> lk{mut_};
+      if (--pending_ == 0) done_.notify_all();
     }
 
   private:
     const int num_threads_;
-    std::vector<std::thread> workers_;
+    int pending_ = 0;
+    std::mutex mut_{};
+    std::condition_variable done_{};
 };
 
 }
@@ -19,6 +19,12 @@
 #ifdef GRPPI_OMP
 
 #include "../common/mpmc_queue.h"
+#include "../common/reorder_buffer.h"
+#include "../common/tree_combine.h"
+#include "../common/cancellation.h"
+#include "../common/scan_mode.h"
+#include "../common/sample_sort.h"
+#include "../common/hash_aggregation.h"
 #include "../common/iterator.h"
 #include "../common/execution_traits.h"
 #include "../common/configuration.h"
@@ -26,6 +32,8 @@
 
 #include <type_traits>
 #include <tuple>
+#include <memory>
+#include <vector>
 
 #include <omp.h>
 
@@ -105,6 +113,22 @@ public:
   */
   bool is_ordered() const noexcept { return ordering_; }
 
+  /**
+  \brief Attaches a cancellation token checked by the patterns.
+  Once cancelled, pipeline generators stop, items in flight are discarded
+  and data patterns stop processing chunks.
+  */
+  void set_cancellation_token(cancellation_token const & token) noexcept {
+    cancellation_ = &token;
+  }
+
+  /**
+  \brief Checks if cancellation was requested through the attached token.
+  */
+  bool is_cancelled() const noexcept {
+    return cancellation_ && cancellation_->is_cancelled();
+  }
+
   /**
   \brief Sets the attributes for the queues built through make_queue<T>(()
   */
@@ -113,6 +137,37 @@ public:
     queue_mode_ = mode;
   }
 
+  /**
+  \brief Sets the waiting strategy for the non-blocking queues built through
+  make_queue<T>()
+  */
+  void set_queue_wait(queue_wait wait) noexcept {
+    queue_wait_ = wait;
+  }
+
+  /**
+  \brief Sets the soft limit in number of elements for the queues built
+  through make_queue<T>() in unbounded mode (0 means no limit).
+  */
+  void set_queue_limit(std::size_t limit) noexcept {
+    queue_limit_ = limit;
+  }
+
+  /**
+  \brief Sets the capacity of the reorder buffers of ordered stages.
+  A stage issuing sequence numbers does not send an item until it is within
+  that distance of the next item to be released in order, so that reorder
+  buffers never grow.
+  */
+  void set_reorder_capacity(int capacity) noexcept {
+    reorder_capacity_ = capacity;
+  }
+
+  /**
+  \brief Gets the capacity of the reorder buffers of ordered stages.
+  */
+  int get_reorder_capacity() const noexcept { return reorder_capacity_; }
+
   /**
   \brief Makes a communication queue for elements of type T.
 
@@ -121,7 +176,28 @@ public:
   */
   template <typename T>
   mpmc_queue<T> make_queue() const {
-    return {queue_size_, queue_mode_};
+    mpmc_queue<T> queue{queue_size_, queue_mode_, queue_access::multiple,
+        queue_wait_, queue_limit_};
+    if (queue_statistics_) queue.set_statistics(queue_statistics_->add());
+    return queue;
+  }
+
+  /**
+  \brief Enables or disables statistics for the queues built from now on.
+  Enabling statistics discards the counters of previously built queues.
+  */
+  void set_queue_statistics(bool enabled) {
+    queue_statistics_ = enabled ?
+        std::make_shared<queue_statistics_registry>() : nullptr;
+  }
+
+  /**
+  \brief Gets the counters of the queues built while statistics were enabled.
+  \return Counters of every queue in creation order (empty if disabled).
+  */
+  std::vector<queue_counters> get_queue_statistics() const {
+    if (!queue_statistics_) return {};
+    return queue_statistics_->counters();
   }
 
   /**
@@ -220,6 +296,62 @@ public:
                   Identity && identity,
                   Transformer && transform_op, Combiner && combine_op) const;
 
+  /**
+  \brief Applies a map/reduce by key operation to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam KeyTransformer Callable object type for the key operation.
+  \tparam ValueTransformer Callable object type for the value operation.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param key_op Key callable object.
+  \param value_op Value callable object.
+  \param combine_op Combination callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \return A vector of pairs with every key and its combined value.
+  */
+  template <typename InputIterator, typename KeyTransformer,
+            typename ValueTransformer, typename Combiner>
+  auto map_reduce_by_key(InputIterator first, std::size_t sequence_size,
+                         KeyTransformer && key_op,
+                         ValueTransformer && value_op,
+                         Combiner && combine_op) const;
+
+  /**
+  \brief Applies a scan to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam OutputIterator Iterator type for the output sequence.
+  \tparam Identity Type for the identity value.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param first_out Iterator to the first element of the output sequence.
+  \param identity Identity value for the combination.
+  \param combine_op Combination callable object.
+  \param mode Inclusive or exclusive scan.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \pre Iterators in the range `[first_out,first_out+sequence_size)` are valid. 
+  */
+  template <typename InputIterator, typename OutputIterator, 
+            typename Identity, typename Combiner>
+  void scan(InputIterator first, std::size_t sequence_size,
+            OutputIterator first_out,
+            Identity && identity, Combiner && combine_op,
+            scan_mode mode) const;
+
+  /**
+  \brief Sorts a sequence of data items.
+  \tparam RandomIterator Random access iterator type for the sequence.
+  \tparam Compare Callable object type for the comparison.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the sequence.
+  \param comp Comparison callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  */
+  template <typename RandomIterator, typename Compare>
+  void sort(RandomIterator first, std::size_t sequence_size,
+            Compare && comp) const;
+
   /**
   \brief Applies a stencil to multiple sequences leaving the result in
   another sequence.
@@ -456,6 +588,54 @@ private:
   void do_pipeline(Queue && input_queue, Reduce<Combiner,Identity> && reduce_obj,
                    OtherTransformers && ... other_transform_ops) const;
 
+  template <typename Queue, typename KeyExtractor, typename Combiner,
+            typename Identity,
+            template <typename K, typename C, typename I> class KeyedReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_key<
+                KeyedReduce<KeyExtractor,Combiner,Identity>> = 0>
+  void do_pipeline(Queue & input_queue,
+                   KeyedReduce<KeyExtractor,Combiner,Identity> & reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const
+  {
+    do_pipeline(input_queue, std::move(reduce_obj),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Queue, typename KeyExtractor, typename Combiner,
+            typename Identity,
+            template <typename K, typename C, typename I> class KeyedReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_key<
+                KeyedReduce<KeyExtractor,Combiner,Identity>> = 0>
+  void do_pipeline(Queue & input_queue,
+                   KeyedReduce<KeyExtractor,Combiner,Identity> && reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const;
+
+  template <typename Queue, typename Timestamper, typename Combiner,
+            typename Identity,
+            template <typename T, typename C, typename I> class TimeReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_time<
+                TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  void do_pipeline(Queue & input_queue,
+                   TimeReduce<Timestamper,Combiner,Identity> & reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const
+  {
+    do_pipeline(input_queue, std::move(reduce_obj),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Queue, typename Timestamper, typename Combiner,
+            typename Identity,
+            template <typename T, typename C, typename I> class TimeReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_time<
+                TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  void do_pipeline(Queue & input_queue,
+                   TimeReduce<Timestamper,Combiner,Identity> && reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const;
+
   template <typename Queue, typename Transformer, typename Predicate,
             template <typename T, typename P> class Iteration,
             typename ... OtherTransformers,
@@ -513,6 +693,36 @@ private:
 
 private:
 
+  /**
+  \brief Invokes an operation for every index in [0,n) in parallel.
+  */
+  template <typename F>
+  void for_each_index(std::size_t n, F && f) const {
+    const long last = static_cast<long>(n);
+    #pragma omp parallel for num_threads(concurrency_degree_)
+    for (long i=0; i<last; ++i) {
+      f(static_cast<std::size_t>(i));
+    }
+  }
+
+  /**
+  \brief Attaches a reorder credit to a queue when ordering is enabled and
+  the next stages restore the order of its items.
+  \return The credit to acquire before sending an item (nullptr if none).
+  */
+  template <typename T, typename ... Transformers>
+  std::shared_ptr<reorder_credit> make_reorder_credit(mpmc_queue<T> & queue,
+      Transformers && ...) const
+  {
+    if (!is_ordered() || !reaches_reorder_buffer<Transformers...>) {
+      return nullptr;
+    }
+    auto credit = std::make_shared<reorder_credit>(
+        static_cast<std::size_t>(reorder_capacity_));
+    queue.set_reorder_credit(credit);
+    return credit;
+  }
+
   /**
   \brief Obtain OpenMP platform number of threads.
   Queries the current OpenMP number of threads so that it can be used in
@@ -540,6 +750,18 @@ private:
   int queue_size_ = config_.queue_size();
 
   queue_mode queue_mode_ = config_.mode();
+
+  queue_wait queue_wait_ = config_.wait_mode();
+
+  std::size_t queue_limit_ = config_.queue_limit();
+
+  int reorder_capacity_ = config_.reorder_capacity();
+
+  std::shared_ptr<queue_statistics_registry> queue_statistics_ =
+      config_.queue_statistics_enabled() ?
+          std::make_shared<queue_statistics_registry>() : nullptr;
+
+  cancellation_token const * cancellation_ = nullptr;
 };
 
 /**
@@ -579,6 +801,13 @@ constexpr bool supports_reduce<parallel_execution_omp>() { return true; }
 template <>
 constexpr bool supports_map_reduce<parallel_execution_omp>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the map-reduce by key pattern.
+\note Specialization for parallel_execution_omp.
+*/
+template <>
+constexpr bool supports_map_reduce_by_key<parallel_execution_omp>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the stencil pattern.
 \note Specialization for parallel_execution_omp when GRPPI_OMP is enabled.
@@ -586,6 +815,20 @@ constexpr bool supports_map_reduce<parallel_execution_omp>() { return true; }
 template <>
 constexpr bool supports_stencil<parallel_execution_omp>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the scan pattern.
+\note Specialization for parallel_execution_omp.
+*/
+template <>
+constexpr bool supports_scan<parallel_execution_omp>() { return true; }
+
+/**
+\brief Determines if an execution policy supports the sort pattern.
+\note Specialization for parallel_execution_omp.
+*/
+template <>
+constexpr bool supports_sort<parallel_execution_omp>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the divide/conquer pattern.
 \note Specialization for parallel_execution_omp when GRPPI_OMP is enabled.
@@ -609,6 +852,7 @@ void parallel_execution_omp::map(
 {
   #pragma omp parallel for
   for (std::size_t i=0; i<sequence_size; ++i) {
+    if (is_cancelled()) continue;
     first_out[i] = apply_iterators_indexed(transform_op, firsts, i);
   }
 }
@@ -624,6 +868,10 @@ auto parallel_execution_omp::reduce(
   using result_type = std::decay_t<Identity>;
   std::vector<result_type> partial_results(concurrency_degree_);
   auto process_chunk = [&](InputIterator f, std::size_t sz, std::size_t id) {
+    if (is_cancelled()) {
+      partial_results[id] = identity;
+      return;
+    }
     partial_results[id] = seq.reduce(f, sz, std::forward<Identity>(identity), 
         std::forward<Combiner>(combine_op));
   };
@@ -653,9 +901,8 @@ auto parallel_execution_omp::reduce(
     }
   }
 
-  return seq.reduce(std::next(partial_results.begin()), 
-      partial_results.size()-1,
-      partial_results[0], std::forward<Combiner>(combine_op));
+  return tree_combine(partial_results, std::forward<Combiner>(combine_op),
+      [this](std::size_t n, auto && f) { this->for_each_index(n, f); });
 }
 
 template <typename ... InputIterators, typename Identity, 
@@ -672,6 +919,10 @@ auto parallel_execution_omp::map_reduce(
   std::vector<result_type> partial_results(concurrency_degree_);
 
   auto process_chunk = [&](auto f, std::size_t sz, std::size_t i) {
+    if (is_cancelled()) {
+      partial_results[i] = identity;
+      return;
+    }
     partial_results[i] = seq.map_reduce(
         f, sz, 
         std::forward<Identity>(identity),
@@ -705,9 +956,85 @@ auto parallel_execution_omp::map_reduce(
     }
   }
 
-  return seq.reduce(partial_results.begin(), 
-      partial_results.size(), std::forward<Identity>(identity),
-      std::forward<Combiner>(combine_op));
+  return tree_combine(partial_results, std::forward<Combiner>(combine_op),
+      [this](std::size_t n, auto && f) { this->for_each_index(n, f); });
+}
+
+template <typename RandomIterator, typename Compare>
+void parallel_execution_omp::sort(
+    RandomIterator first, 
+    std::size_t sequence_size,
+    Compare && comp) const
+{
+  sample_sort(first, std::next(first, sequence_size), 
+      std::forward<Compare>(comp), concurrency_degree_,
+      [this](std::size_t n, auto && f) { this->for_each_index(n, f); });
+}
+
+template <typename InputIterator, typename KeyTransformer,
+          typename ValueTransformer, typename Combiner>
+auto parallel_execution_omp::map_reduce_by_key(
+    InputIterator first, 
+    std::size_t sequence_size,
+    KeyTransformer && key_op,
+    ValueTransformer && value_op,
+    Combiner && combine_op) const
+{
+  return hash_map_reduce_by_key(first, sequence_size,
+      std::forward<KeyTransformer>(key_op),
+      std::forward<ValueTransformer>(value_op),
+      std::forward<Combiner>(combine_op),
+      concurrency_degree_,
+      [this](std::size_t n, auto && f) { this->for_each_index(n, f); });
+}
+
+template <typename InputIterator, typename OutputIterator, 
+          typename Identity, typename Combiner>
+void parallel_execution_omp::scan(
+    InputIterator first, 
+    std::size_t sequence_size,
+    OutputIterator first_out,
+    Identity && identity,
+    Combiner && combine_op,
+    scan_mode mode) const
+{
+  constexpr sequential_execution seq;
+
+  using result_type = std::decay_t<Identity>;
+  const std::size_t nchunks = concurrency_degree_;
+  if (nchunks <= 1 || sequence_size < nchunks) {
+    seq.scan(first, sequence_size, first_out, identity, combine_op, mode);
+    return;
+  }
+
+  const auto chunk_size = sequence_size / nchunks;
+  auto chunk_length = [&](std::size_t id) {
+    return (id+1 == nchunks) ? sequence_size - chunk_size * id : chunk_size;
+  };
+
+  // First pass: reduce every chunk but the last one
+  std::vector<result_type> offsets(nchunks, identity);
+  for_each_index(nchunks-1, [&](std::size_t id) {
+    if (is_cancelled()) return;
+    offsets[id] = seq.reduce(std::next(first, chunk_size * id), chunk_size,
+        identity, combine_op);
+  });
+
+  // Exclusive scan of chunk reductions gives the offset of each chunk
+  result_type carry{identity};
+  for (auto & o : offsets) {
+    auto next = combine_op(carry, o);
+    o = std::move(carry);
+    carry = std::move(next);
+  }
+
+  // Second pass: scan every chunk from its offset
+  for_each_index(nchunks, [&](std::size_t id) {
+    if (is_cancelled()) return;
+    const auto delta = chunk_size * id;
+    seq.scan(std::next(first, delta), chunk_length(id), 
+        std::next(first_out, delta), offsets[id], combine_op, mode);
+  });
 }
 
 template <typename ... InputIterators, typename OutputIterator,
@@ -721,6 +1048,7 @@ void parallel_execution_omp::stencil(
   constexpr sequential_execution seq;
   const auto chunk_size = sequence_size / concurrency_degree_;
   auto process_chunk = [&](auto f, std::size_t sz, std::size_t delta) {
+    if (is_cancelled()) return;
     seq.stencil(f, std::next(first_out,delta), sz,
       std::forward<StencilTransformer>(transform_op),
       std::forward<Neighbourhood>(neighbour_op));
@@ -791,19 +1119,28 @@ void parallel_execution_omp::pipeline(
   using namespace std;
 
   using result_type = decay_t<typename result_of<Generator()>::type>;
-  auto output_queue = make_queue<pair<result_type,long>>(); 
+  using output_type = pair<result_type,long>;
+  auto output_queue = make_queue<output_type>(); 
+  auto credit = make_reorder_credit(output_queue, transform_ops...);
 
   #pragma omp parallel
   {
     #pragma omp single nowait
     {
-      #pragma omp task shared(generate_op,output_queue)
+      #pragma omp task shared(generate_op,output_queue,credit)
       {
         long order = 0;
         for (;;) {
-          auto item = generate_op();
-          output_queue.push(make_pair(item,order++)) ;
-          if (!item) break;
+          auto item = is_cancelled() ? result_type{} : generate_op();
+          bool end = !item;
+          if (credit && !end) {
+            credit->acquire(order, [this] { return is_cancelled(); });
+          }
+          output_queue.push_with([&](output_type & slot) {
+            slot.first = std::move(item);
+            slot.second = order++;
+          });
+          if (end) break;
         }
       }
       do_pipeline(output_queue,
@@ -971,42 +1308,32 @@ void parallel_execution_omp::do_pipeline(Queue & input_queue, Consumer && consum
   using namespace std;
   using input_type = typename Queue::value_type;
 
+  vector<input_type> batch(queue_batch_size);
   if (!is_ordered()) {
     for (;;) {
-      auto item = input_queue.pop();
-      if (!item.first) break;
-      consume_op(*item.first);
+      auto n = input_queue.pop_n(batch.data(), batch.size());
+      for (std::size_t i=0; i<n; ++i) {
+        if (!batch[i].first) return;
+        if (is_cancelled()) continue;
+        consume_op(*batch[i].first);
+      }
     }
-    return;
   }
 
-  vector<input_type> elements;
-  long current = 0;
-  auto item = input_queue.pop( );
-  while (item.first) {
-    if (current == item.second) {
-      consume_op(*item.first);
-      current ++;
-    } 
-    else {
-      elements.push_back(item);
-    }
-    auto it = find_if(elements.begin(), elements.end(),
-       [&](auto x) { return x.second== current; });
-    if(it != elements.end()){
-      consume_op(*it->first);
-      elements.erase(it);
-      current++;
-    }
-    item = input_queue.pop( );
-  }
-  while(elements.size()>0){
-    auto it = find_if(elements.begin(), elements.end(),
-       [&](auto x) { return x.second== current; });
-    if(it != elements.end()){
-      consume_op(*it->first);
-      elements.erase(it);
-      current++;
+  using value_type = typename input_type::first_type::value_type;
+  reorder_buffer<value_type> pending{
+      static_cast<std::size_t>(reorder_capacity_)};
+  auto credit = input_queue.get_reorder_credit();
+  for (;;) {
+    auto n = input_queue.pop_n(batch.data(), batch.size());
+    for (std::size_t i=0; i<n; ++i) {
+      auto & item = batch[i];
+      if (!item.first) return;
+      if (is_cancelled()) continue;
+      pending.insert(item.second, std::move(*item.first));
+      auto released = pending.release_ready(
+          [&](value_type & value) { consume_op(value); });
+      if (credit && released) credit->release(pending.next());
     }
   }
 }
@@ -1023,6 +1350,7 @@ void parallel_execution_omp::do_pipeline(Inqueue & input_queue, Transformer && t
   for (;;) {
     auto item{input_queue.pop()}; 
     if(!item.first) break;
+    if (is_cancelled()) continue;
     auto out = output_item_value_type{transform_op(*item.first)};
     output_queue.push(make_pair(out,item.second)) ;
   }
@@ -1048,6 +1376,9 @@ void parallel_execution_omp::do_pipeline(Queue & input_queue,
 
   decltype(auto) output_queue =
     get_output_queue<output_item_type>(other_ops...);
+  if (keeps_order_numbers<Transformer>) {
+    output_queue.set_reorder_credit(input_queue.get_reorder_credit());
+  }
   
   #pragma omp task shared(input_queue,context_op,output_queue)
   {
@@ -1076,14 +1407,28 @@ void parallel_execution_omp::do_pipeline(
 
   decltype(auto) output_queue =
     get_output_queue<output_type>(other_ops...);
+  output_queue.set_reorder_credit(input_queue.get_reorder_credit());
 
   #pragma omp task shared(transform_op, input_queue, output_queue)
   {
-    for (;;) {
-      auto item = input_queue.pop(); 
-      if (!item.first) break;
-      auto out = output_value_type{transform_op(*item.first)};
-      output_queue.push(make_pair(out, item.second));
+    vector<input_type> batch(queue_batch_size);
+    vector<output_type> results;
+    results.reserve(queue_batch_size);
+    bool end_of_stream = false;
+    while (!end_of_stream) {
+      auto n = input_queue.pop_n(batch.data(), batch.size());
+      for (std::size_t i=0; i<n; ++i) {
+        auto & item = batch[i];
+        if (!item.first) {
+          end_of_stream = true;
+          break;
+        }
+        if (is_cancelled()) continue;
+        results.emplace_back(output_value_type{transform_op(*item.first)},
+            item.second);
+      }
+      output_queue.push_n(results.data(), results.data() + results.size());
+      results.clear();
     }
     output_queue.push(make_pair(output_value_type{}, -1));
   }
@@ -1106,7 +1451,7 @@ void parallel_execution_omp::do_pipeline(
     {
       auto item = input_queue.pop();
       while (item.first) {
-        farm_obj(*item.first);
+        if (!is_cancelled()) farm_obj(*item.first);
         item = input_queue.pop();
       }
       input_queue.push(item);
@@ -1137,13 +1482,21 @@ void parallel_execution_omp::do_pipeline(
     get_output_queue<output_type>(other_transform_ops...);
 
 //  auto output_queue = make_queue<output_type>();
+  output_queue.set_reorder_credit(input_queue.get_reorder_credit());
 
   atomic<int> done_threads{0};
   int ntask = farm_obj.cardinality();
   for (int i=0; i<farm_obj.cardinality(); ++i) {
     #pragma omp task shared(done_threads,output_queue,farm_obj,input_queue,ntask)
     {
-      do_pipeline(input_queue, farm_obj.transformer(), output_queue);
+      for (;;) {
+        auto item{input_queue.pop()};
+        if (!item.first) break;
+        if (is_cancelled()) continue;
+        output_queue.push(make_pair(
+            output_optional_type{farm_obj.transformer()(*item.first)},
+            item.second));
+      }
       done_threads++;
       if (done_threads == ntask){
         output_queue.push(make_pair(output_optional_type{}, -1));
@@ -1178,85 +1531,63 @@ void parallel_execution_omp::do_pipeline(
   using namespace std;
   using input_type = typename Queue::value_type;
   using input_value_type = typename input_type::first_type;
-  auto filter_queue = make_queue<input_type>();
 
   if (is_ordered()) {
-    auto filter_task = [&]() {
-      {
-        auto item{input_queue.pop()};
-        while (item.first) {
-          if(filter_obj(*item.first)) {
-            filter_queue.push(item);
-          }
-          else {
-            filter_queue.push(make_pair(input_value_type{} ,item.second));
-          }
-          item = input_queue.pop();
-        }
-        filter_queue.push (make_pair(input_value_type{}, -1));
-      }
-    };
-
     decltype(auto) output_queue =
       get_output_queue<input_type>(other_transform_ops...);
+    auto output_credit =
+        make_reorder_credit(output_queue, other_transform_ops...);
 
-
-    auto reorder_task = [&]() {
-      vector<input_type> elements;
-      int current = 0;
+    // Discarded items are only recorded as gaps in the reorder buffer, so
+    // that no item is forwarded for them. Kept items are sent before
+    // waiting for credit, as the next stages may need them to hand it back.
+    auto filter_task = [&]() {
+      vector<input_type> batch(queue_batch_size);
+      vector<input_type> kept;
+      kept.reserve(queue_batch_size);
+      reorder_buffer<input_value_type> pending{
+          static_cast<std::size_t>(reorder_capacity_)};
+      auto input_credit = input_queue.get_reorder_credit();
+      auto send_kept = [&] {
+        output_queue.push_n(kept.data(), kept.data() + kept.size());
+        kept.clear();
+      };
       long order = 0;
-      auto item = filter_queue.pop();
-      for (;;) {
-        if (!item.first && item.second == -1) break;
-        if (item.second == current) {
-          if (item.first) {
-            output_queue.push(make_pair(item.first, order++));
-          }
-          current++;
-        }
-        else {
-          elements.push_back(item);
-        }
-        auto it = find_if(elements.begin(), elements.end(),
-           [&](auto x) { return x.second== current; });
-        if(it != elements.end()){
-          if (it->first) {
-            output_queue.push(make_pair(it->first,order));
-            order++;
+      bool end_of_stream = false;
+      while (!end_of_stream) {
+        auto n = input_queue.pop_n(batch.data(), batch.size());
+        for (std::size_t i=0; i<n; ++i) {
+          auto & item = batch[i];
+          if (!item.first) {
+            end_of_stream = true;
+            break;
           }
-          elements.erase(it);
-          current++;
-        }
-        item = filter_queue.pop();
-      }
-
-      while (elements.size()>0) {
-        auto it = find_if(elements.begin(), elements.end(),
-           [&](auto x) { return x.second== current; });
-        if(it != elements.end()){
-          if (it->first) {
-            output_queue.push(make_pair(it->first,order));
-            order++;
+          if (is_cancelled()) continue;
+          if (!filter_obj(*item.first)) item.first = input_value_type{};
+          pending.insert(item.second, std::move(item.first));
+          auto released = pending.release_ready(
+              [&](input_value_type & value) {
+                if (!value) return;
+                if (output_credit && !output_credit->available(order)) {
+                  send_kept();
+                  output_credit->acquire(order, 
+                      [this] { return is_cancelled(); });
+                }
+                kept.emplace_back(std::move(value), order++);
+              });
+          if (input_credit && released) {
+            input_credit->release(pending.next());
           }
-          elements.erase(it);
-          current++;
         }
-        item = filter_queue.pop();
+        send_kept();
       }
-
-      output_queue.push(item);
+      output_queue.push(make_pair(input_value_type{}, -1));
     };
 
-    
-    #pragma omp task shared(filter_queue,filter_obj,input_queue)
+    #pragma omp task shared(output_queue,filter_obj,input_queue)
     {
       filter_task();
     }
-    
-    #pragma omp task shared (output_queue,filter_queue)
-    {
-      reorder_task();
-    }
 
     do_pipeline(output_queue, 
         forward<OtherTransformers>(other_transform_ops)...);
@@ -1264,13 +1595,25 @@ void parallel_execution_omp::do_pipeline(
     #pragma omp taskwait
   }
   else {
+    auto filter_queue = make_queue<input_type>();
     auto filter_task = [&]() {
-      auto item = input_queue.pop( ) ;
-      while (item.first) {
-        if (filter_obj(*item.first)) {
-          filter_queue.push(item);
+      vector<input_type> batch(queue_batch_size);
+      bool end_of_stream = false;
+      while (!end_of_stream) {
+        auto n = input_queue.pop_n(batch.data(), batch.size());
+        std::size_t kept = 0;
+        for (std::size_t i=0; i<n; ++i) {
+          auto & item = batch[i];
+          if (!item.first) {
+            end_of_stream = true;
+            break;
+          }
+          if (filter_obj(*item.first)) {
+            if (kept != i) batch[kept] = std::move(item);
+            kept++;
+          }
         }
-        item = input_queue.pop();
+        filter_queue.push_n(batch.data(), batch.data() + kept);
       }
       filter_queue.push(make_pair(input_value_type{}, -1));
     };
@@ -1302,17 +1645,30 @@ void parallel_execution_omp::do_pipeline(
   
   decltype(auto) output_queue =
     get_output_queue<output_item_type>(other_transform_ops...);
+  auto credit = make_reorder_credit(output_queue, other_transform_ops...);
 
   auto reduce_task = [&]() {
-    auto item{input_queue.pop()};
-    int order = 0;
-    while (item.first) {
-      reduce_obj.add_item(std::forward<Identity>(*item.first));
-      item = input_queue.pop();
-      if (reduce_obj.reduction_needed()) {
-        constexpr sequential_execution seq;
-        auto red = reduce_obj.reduce_window(seq);
-        output_queue.push(make_pair(red, order++));
+    using input_item_type = typename decay_t<Queue>::value_type;
+    vector<input_item_type> batch(queue_batch_size);
+    long order = 0;
+    bool end_of_stream = false;
+    while (!end_of_stream) {
+      auto n = input_queue.pop_n(batch.data(), batch.size());
+      for (std::size_t i=0; i<n; ++i) {
+        auto & item = batch[i];
+        if (!item.first) {
+          end_of_stream = true;
+          break;
+        }
+        reduce_obj.add_item(std::forward<Identity>(*item.first));
+        if (reduce_obj.reduction_needed()) {
+          constexpr sequential_execution seq;
+          auto red = reduce_obj.reduce_window(seq);
+          if (credit) {
+            credit->acquire(order, [this] { return is_cancelled(); });
+          }
+          output_queue.push(make_pair(red, order++));
+        }
       }
     }
     output_queue.push(make_pair(output_item_value_type{}, -1));
@@ -1327,6 +1683,180 @@ void parallel_execution_omp::do_pipeline(
   #pragma omp taskwait
 }
 
+template <typename Queue, typename KeyExtractor, typename Combiner,
+          typename Identity,
+          template <typename K, typename C, typename I> class KeyedReduce,
+          typename ... OtherTransformers,
+          requires_reduce_by_key<KeyedReduce<KeyExtractor,Combiner,Identity>>>
+void parallel_execution_omp::do_pipeline(
+    Queue & input_queue, 
+    KeyedReduce<KeyExtractor,Combiner,Identity> && reduce_obj,
+    OtherTransformers && ... other_transform_ops) const
+{
+  using namespace std;
+
+  using input_item_type = typename Queue::value_type;
+  using input_value_type = typename input_item_type::first_type::value_type;
+  using reduce_type = KeyedReduce<KeyExtractor,Combiner,Identity>;
+  using key_type = typename reduce_type::template key_type<input_value_type>;
+  using result_type = 
+      typename reduce_type::template result_type<input_value_type>;
+  using output_item_value_type = grppi::optional<result_type>;
+  using output_item_type = pair<output_item_value_type,long>;
+  
+  decltype(auto) output_queue =
+    get_output_queue<output_item_type>(other_transform_ops...);
+  auto credit = make_reorder_credit(output_queue, other_transform_ops...);
+
+  // Tasks blocked on a queue keep their thread, so replicas are grouped in
+  // as many tasks as the team can run besides the generator and this one.
+  // The first task routes the stream and reduces the keys of its replicas.
+  using routed_type = grppi::optional<pair<key_type,input_value_type>>;
+  const int ntasks = std::max(1,
+      std::min(reduce_obj.replicas(), omp_get_num_threads() - 2));
+  vector<mpmc_queue<routed_type>> task_queues;
+  task_queues.reserve(ntasks);
+  for (int i=0; i<ntasks; ++i) {
+    task_queues.push_back(make_queue<routed_type>());
+  }
+
+  atomic<long> order{0};
+  atomic<int> done_tasks{0};
+  auto finish = [&]() {
+    if (++done_tasks == ntasks) {
+      output_queue.push(make_pair(output_item_value_type{}, -1));
+    }
+  };
+
+  auto route_task = [&]() {
+    auto windows = reduce_obj.template make_windows<input_value_type>();
+    auto emit = [&](key_type const & key, auto && result) {
+      const long item_order = order++;
+      if (credit) {
+        credit->acquire(item_order, [this] { return is_cancelled(); });
+      }
+      output_queue.push(make_pair(
+          output_item_value_type{make_pair(key, std::move(result))},
+          item_order));
+    };
+    vector<input_item_type> batch(queue_batch_size);
+    bool end_of_stream = false;
+    while (!end_of_stream) {
+      auto n = input_queue.pop_n(batch.data(), batch.size());
+      for (std::size_t i=0; i<n; ++i) {
+        auto & item = batch[i];
+        if (!item.first) {
+          end_of_stream = true;
+          break;
+        }
+        if (is_cancelled()) continue;
+        auto key = reduce_obj.key(*item.first);
+        const auto task = reduce_obj.replica(key) % ntasks;
+        if (task == 0) {
+          windows.add_item(std::move(key), std::move(*item.first), emit);
+        }
+        else {
+          task_queues[task].push(routed_type{
+              make_pair(std::move(key), std::move(*item.first))});
+        }
+      }
+    }
+    for (int i=1; i<ntasks; ++i) {
+      task_queues[i].push(routed_type{});
+    }
+    finish();
+  };
+
+  auto replica_task = [&](int task) {
+    auto windows = reduce_obj.template make_windows<input_value_type>();
+    auto emit = [&](key_type const & key, auto && result) {
+      const long item_order = order++;
+      if (credit) {
+        credit->acquire(item_order, [this] { return is_cancelled(); });
+      }
+      output_queue.push(make_pair(
+          output_item_value_type{make_pair(key, std::move(result))},
+          item_order));
+    };
+    for (;;) {
+      auto item = task_queues[task].pop();
+      if (!item) break;
+      windows.add_item(std::move(item->first), std::move(item->second), emit);
+    }
+    finish();
+  };
+
+  #pragma omp task shared(route_task)
+  {
+    route_task();
+  }
+  for (int i=1; i<ntasks; ++i) {
+    #pragma omp task shared(replica_task) firstprivate(i)
+    {
+      replica_task(i);
+    }
+  }
+  do_pipeline(output_queue, 
+      std::forward<OtherTransformers>(other_transform_ops)...);
+  #pragma omp taskwait
+}
+
+template <typename Queue, typename Timestamper, typename Combiner,
+          typename Identity,
+          template <typename T, typename C, typename I> class TimeReduce,
+          typename ... OtherTransformers,
+          requires_reduce_by_time<TimeReduce<Timestamper,Combiner,Identity>>>
+void parallel_execution_omp::do_pipeline(
+    Queue & input_queue, 
+    TimeReduce<Timestamper,Combiner,Identity> && reduce_obj,
+    OtherTransformers && ... other_transform_ops) const
+{
+  using namespace std;
+
+  using input_item_type = typename Queue::value_type;
+  using result_type = 
+      typename TimeReduce<Timestamper,Combiner,Identity>::result_type;
+  using output_item_value_type = grppi::optional<result_type>;
+  using output_item_type = pair<output_item_value_type,long>;
+
+  decltype(auto) output_queue =
+    get_output_queue<output_item_type>(other_transform_ops...);
+  auto credit = make_reorder_credit(output_queue, other_transform_ops...);
+
+  // Waits at most a slide for the next item, so that the watermark keeps
+  // advancing and windows are reduced when the input goes quiet
+  auto reduce_task = [&]() {
+    long order = 0;
+    auto emit = [&](result_type && result) {
+      if (credit) {
+        credit->acquire(order, [this] { return is_cancelled(); });
+      }
+      output_queue.push(make_pair(
+          output_item_value_type{std::move(result)}, order++));
+    };
+    input_item_type item;
+    for (;;) {
+      if (!input_queue.pop_for(item, reduce_obj.slide())) {
+        reduce_obj.advance(chrono::steady_clock::now(), emit);
+        continue;
+      }
+      if (!item.first) break;
+      if (is_cancelled()) continue;
+      reduce_obj.add_item(*item.first, emit);
+    }
+    if (!is_cancelled()) reduce_obj.flush(emit);
+    output_queue.push(make_pair(output_item_value_type{}, -1));
+  };
+
+  #pragma omp task shared(reduce_task)
+  {
+    reduce_task();
+  }
+  do_pipeline(output_queue, 
+      std::forward<OtherTransformers>(other_transform_ops)...);
+  #pragma omp taskwait
+}
+
 template <typename Queue, typename Transformer, typename Predicate,
           template <typename T, typename P> class Iteration,
           typename ... OtherTransformers,
@@ -1342,7 +1872,7 @@ void parallel_execution_omp::do_pipeline(
   using input_item_type = typename decay_t<Queue>::value_type;
   decltype(auto) output_queue =
     get_output_queue<input_item_type>(other_transform_ops...);
-
+  output_queue.set_reorder_credit(input_queue.get_reorder_credit());
 
   auto iteration_task = [&]() {
     for (;;) {
@@ -21,6 +21,7 @@
 #include "grppi/common/callable_traits.h"
 #include "grppi/common/execution_traits.h"
 #include "grppi/common/pipeline_pattern.h"
+#include "grppi/common/fused_stage.h"
 
 namespace grppi {
 
@@ -74,6 +75,43 @@ auto pipeline(
         std::forward<Transformer>(transform_op),
         std::forward<Transformers>(transform_ops)...);
 }
+
+/**
+\brief Fuse a single pipeline stage.
+Returns a copy of the stage itself.
+\tparam Transformer Callable type for the stage.
+\param transform_op Transformation operation.
+*/
+template <typename Transformer>
+auto fuse(Transformer && transform_op)
+{
+  return std::forward<Transformer>(transform_op);
+}
+
+/**
+\brief Fuse consecutive pipeline stages into a single stage.
+The resulting stage applies every transformation in order in the same 
+thread, without communication queues among them. Stages must be plain 
+callables and not patterns.
+\tparam Transformer Callable type for the first stage.
+\tparam Next Callable type for the second stage.
+\tparam Transformers Callable type for each additional stage.
+\param transform_op First transformation operation.
+\param next_op Second transformation operation.
+\param transform_ops Additional transformation operations.
+*/
+template <typename Transformer, typename Next, typename ... Transformers>
+auto fuse(
+    Transformer && transform_op,
+    Next && next_op,
+    Transformers && ... transform_ops)
+{
+  return fuse(
+      fused_stage_t<Transformer, Next>(
+          std::forward<Transformer>(transform_op),
+          std::forward<Next>(next_op)),
+      std::forward<Transformers>(transform_ops)...);
+}
 /**
 @}
 @}
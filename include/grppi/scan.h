@@ -0,0 +1,110 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_SCAN_H
+#define GRPPI_SCAN_H
+
+#include <utility>
+
+#include "grppi/common/range_concept.h"
+#include "grppi/common/iterator_traits.h"
+#include "grppi/common/execution_traits.h"
+#include "grppi/common/scan_mode.h"
+
+namespace grppi {
+
+/** 
+\addtogroup data_patterns
+@{
+\defgroup scan_pattern Scan pattern
+\brief Interface for applying the \ref md_scan.
+@{
+*/
+
+/**
+\brief Invoke \ref md_scan on a data sequence.
+\tparam Execution Execution policy type.
+\tparam InputIt Iterator type used for the input sequence.
+\tparam OutputIt Iterator type used for the output sequence.
+\tparam Identity Type for the identity value.
+\tparam Combiner Callable type for the combiner operation.
+\param ex Execution policy object.
+\param first Iterator to the first element in the input sequence.
+\param last Iterator to one past the end of the input sequence.
+\param first_out Iterator to the first element of the output sequence.
+\param identity Identity value for the combiner operation.
+\param combine_op Associative combiner operation.
+\param mode Whether each output element includes the input element at the
+same position (inclusive) or not (exclusive).
+\note The output sequence may be the input sequence.
+*/
+template <typename Execution, typename InputIt, typename OutputIt,
+          typename Identity, typename Combiner,
+          requires_iterator<InputIt> = 0,
+          requires_iterator<OutputIt> = 0>
+void scan(const Execution & ex,
+          InputIt first, InputIt last, OutputIt first_out,
+          Identity && identity,
+          Combiner && combine_op,
+          scan_mode mode = scan_mode::inclusive)
+{
+  static_assert(supports_scan<Execution>(),
+      "scan not supported on execution type");
+  ex.scan(first, std::distance(first,last), first_out,
+      std::forward<Identity>(identity), std::forward<Combiner>(combine_op),
+      mode);
+}
+
+/**
+\brief Invoke \ref md_scan on a data sequence.
+\tparam Execution Execution policy type.
+\tparam InRange Range type for the input range.
+\tparam OutRange Range type for the output range.
+\tparam Identity Type for the identity value.
+\tparam Combiner Callable type for the combiner operation.
+\param ex Execution policy object.
+\param rin Input range.
+\param rout Output range.
+\param identity Identity value for the combiner operation.
+\param combine_op Associative combiner operation.
+\param mode Whether each output element includes the input element at the
+same position (inclusive) or not (exclusive).
+\pre rin.size() == rout.size()
+*/
+template <typename Execution, typename InRange, typename OutRange,
+          typename Identity, typename Combiner,
+          meta::requires<range_concept,InRange> = 0,
+          meta::requires<range_concept,OutRange> = 0>
+void scan(const Execution & ex, 
+          InRange && rin, OutRange && rout,
+          Identity && identity,
+          Combiner && combine_op,
+          scan_mode mode = scan_mode::inclusive)
+{
+  static_assert(supports_scan<Execution>(),
+      "scan not supported on execution type");
+  ex.scan(rin.begin(), rin.size(), rout.begin(),
+      std::forward<Identity>(identity), std::forward<Combiner>(combine_op),
+      mode);
+}
+
+/**
+@}
+@}
+*/
+
+}
+
+#endif
@@ -22,10 +22,14 @@
 #include "../common/execution_traits.h"
 #include "../common/patterns.h"
 #include "../common/pack_traits.h"
+#include "../common/cancellation.h"
+#include "../common/scan_mode.h"
+#include "../common/hash_aggregation.h"
 
 #include <type_traits>
 #include <tuple>
 #include <iterator>
+#include <algorithm>
 
 namespace grppi {
 
@@ -69,6 +73,22 @@ public:
   */
   constexpr bool is_ordered() const noexcept { return true; }
 
+  /**
+  \brief Attaches a cancellation token checked by the patterns.
+  \note Sequential data patterns process their sequence as a single chunk,
+  so that only pipelines are cancelled.
+  */
+  void set_cancellation_token(cancellation_token const & token) noexcept {
+    cancellation_ = &token;
+  }
+
+  /**
+  \brief Checks if cancellation was requested through the attached token.
+  */
+  bool is_cancelled() const noexcept {
+    return cancellation_ && cancellation_->is_cancelled();
+  }
+
   /**
   \brief Applies a transformation to multiple sequences leaving the result in
   another sequence.
@@ -107,6 +127,62 @@ public:
               Identity && identity,
               Combiner && combine_op) const;
 
+  /**
+  \brief Applies a map/reduce by key operation to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam KeyTransformer Callable object type for the key operation.
+  \tparam ValueTransformer Callable object type for the value operation.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param key_op Key callable object.
+  \param value_op Value callable object.
+  \param combine_op Combination callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \return A vector of pairs with every key and its combined value.
+  */
+  template <typename InputIterator, typename KeyTransformer,
+            typename ValueTransformer, typename Combiner>
+  auto map_reduce_by_key(InputIterator first, std::size_t sequence_size,
+                         KeyTransformer && key_op,
+                         ValueTransformer && value_op,
+                         Combiner && combine_op) const;
+
+  /**
+  \brief Applies a scan to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam OutputIterator Iterator type for the output sequence.
+  \tparam Identity Type for the identity value.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param first_out Iterator to the first element of the output sequence.
+  \param identity Identity value for the combination.
+  \param combine_op Combination callable object.
+  \param mode Inclusive or exclusive scan.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \pre Iterators in the range `[first_out,first_out+sequence_size)` are valid. 
+  */
+  template <typename InputIterator, typename OutputIterator, 
+            typename Identity, typename Combiner>
+  void scan(InputIterator first, std::size_t sequence_size,
+            OutputIterator first_out,
+            Identity && identity, Combiner && combine_op,
+            scan_mode mode) const;
+
+  /**
+  \brief Sorts a sequence of data items.
+  \tparam RandomIterator Random access iterator type for the sequence.
+  \tparam Compare Callable object type for the comparison.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the sequence.
+  \param comp Comparison callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  */
+  template <typename RandomIterator, typename Compare>
+  void sort(RandomIterator first, std::size_t sequence_size,
+            Compare && comp) const;
+
   /**
   \brief Applies a map/reduce operation to a sequence of data items.
   \tparam InputIterator Iterator type for the input sequence.
@@ -219,10 +295,11 @@ public:
   {
     using namespace std;
     using optional_output_type = typename OutputType::first_type;
+    auto && stage = stream_stage(std::forward<Transformer>(transform_op));
     for(;;){
       auto item = input_queue.pop();
       if(!item.first) break;
-      do_pipeline(*item.first, std::forward<Transformer>(transform_op),
+      do_pipeline(*item.first, stage,
         [&](auto output_item) {
           output_queue.push( make_pair(optional_output_type{output_item}, item.second) );
         }
@@ -334,6 +411,54 @@ private:
   void do_pipeline(Item && item, Reduce<Combiner,Identity> && reduce_obj,
                    OtherTransformers && ... other_transform_ops) const;
 
+  template <typename Item, typename KeyExtractor, typename Combiner,
+            typename Identity,
+            template <typename K, typename C, typename I> class KeyedReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_key<
+                KeyedReduce<KeyExtractor,Combiner,Identity>> = 0>
+  void do_pipeline(Item && item,
+                   KeyedReduce<KeyExtractor,Combiner,Identity> & reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const
+  {
+    do_pipeline(std::forward<Item>(item), std::move(reduce_obj),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Item, typename KeyExtractor, typename Combiner,
+            typename Identity,
+            template <typename K, typename C, typename I> class KeyedReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_key<
+                KeyedReduce<KeyExtractor,Combiner,Identity>> = 0>
+  void do_pipeline(Item && item,
+                   KeyedReduce<KeyExtractor,Combiner,Identity> && reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const;
+
+  template <typename Item, typename Timestamper, typename Combiner,
+            typename Identity,
+            template <typename T, typename C, typename I> class TimeReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_time<
+                TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  void do_pipeline(Item && item,
+                   TimeReduce<Timestamper,Combiner,Identity> & reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const
+  {
+    do_pipeline(std::forward<Item>(item), std::move(reduce_obj),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Item, typename Timestamper, typename Combiner,
+            typename Identity,
+            template <typename T, typename C, typename I> class TimeReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_time<
+                TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  void do_pipeline(Item && item,
+                   TimeReduce<Timestamper,Combiner,Identity> && reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const;
+
   template <typename Item, typename Transformer, typename Predicate,
             template <typename T, typename P> class Iteration,
             typename ... OtherTransformers,
@@ -387,6 +512,81 @@ private:
           std::tuple<Transformers...> && transform_ops,
           std::index_sequence<I...>) const;
 
+  template <typename Item, typename KeyedReduce,
+            typename ... OtherTransformers>
+  void do_pipeline(Item && item,
+                   keyed_reduce_stream<KeyedReduce> & reduce_stream,
+                   OtherTransformers && ... other_transform_ops) const;
+
+  template <typename Item, typename ... Stages, std::size_t ... I>
+  void do_pipeline_stream(Item && item, std::tuple<Stages...> & stages,
+          std::index_sequence<I...>) const;
+
+  template <typename ... Stages, std::size_t ... I>
+  void flush_stream(std::tuple<Stages...> & stages,
+          std::index_sequence<I...>) const
+  {
+    flush_stages(std::get<I>(stages)...);
+  }
+
+  void flush_stages() const noexcept {}
+
+  template <typename Transformer, typename ... OtherTransformers,
+            std::enable_if_t<!is_reduce_by_time<Transformer> &&
+                !is_pipeline<Transformer>,int> = 0>
+  void flush_stages(Transformer &&, 
+          OtherTransformers && ... other_transform_ops) const
+  {
+    flush_stages(other_transform_ops...);
+  }
+
+  template <typename Transformer, typename ... OtherTransformers,
+            requires_reduce_by_time<Transformer> = 0>
+  void flush_stages(Transformer && reduce_obj, 
+          OtherTransformers && ... other_transform_ops) const;
+
+  /**
+  \brief Flushes the stages of a nested pipeline followed by the next ones.
+  */
+  template <typename Transformer, typename ... OtherTransformers,
+            requires_pipeline<Transformer> = 0>
+  void flush_stages(Transformer && pipeline_obj, 
+          OtherTransformers && ... other_transform_ops) const
+  {
+    flush_nested(std::tuple_cat(pipeline_obj.transformers(), 
+            std::forward_as_tuple(other_transform_ops...)),
+        std::make_index_sequence<std::tuple_size<
+            typename std::decay_t<Transformer>::transformers_type>::value +
+            sizeof...(OtherTransformers)>());
+  }
+
+  template <typename ... Transformers, std::size_t ... I>
+  void flush_nested(std::tuple<Transformers...> && transform_ops,
+          std::index_sequence<I...>) const
+  {
+    flush_stages(std::forward<Transformers>(std::get<I>(transform_ops))...);
+  }
+
+  /**
+  \brief Gives a reduce by key stage its windows for a single stream.
+  */
+  template <typename Transformer,
+            requires_reduce_by_key<Transformer> = 0>
+  auto stream_stage(Transformer && reduce_obj) const {
+    return keyed_reduce_stream<std::decay_t<Transformer>>{reduce_obj};
+  }
+
+  /**
+  \brief Forwards a stage that keeps no state for a single stream.
+  */
+  template <typename Transformer,
+            std::enable_if_t<!is_reduce_by_key<Transformer>,int> = 0>
+  Transformer && stream_stage(Transformer && transform_op) const {
+    return std::forward<Transformer>(transform_op);
+  }
+
+private:
+  cancellation_token const * cancellation_ = nullptr;
 };
 
 /// Determine if a type is a sequential execution policy.
@@ -423,6 +623,13 @@ constexpr bool supports_reduce<sequential_execution>() { return true; }
 template <>
 constexpr bool supports_map_reduce<sequential_execution>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the map-reduce by key pattern.
+\note Specialization for sequential_execution.
+*/
+template <>
+constexpr bool supports_map_reduce_by_key<sequential_execution>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the stencil pattern.
 \note Specialization for sequential_execution.
@@ -430,6 +637,20 @@ constexpr bool supports_map_reduce<sequential_execution>() { return true; }
 template <>
 constexpr bool supports_stencil<sequential_execution>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the scan pattern.
+\note Specialization for sequential_execution.
+*/
+template <>
+constexpr bool supports_scan<sequential_execution>() { return true; }
+
+/**
+\brief Determines if an execution policy supports the sort pattern.
+\note Specialization for sequential_execution.
+*/
+template <>
+constexpr bool supports_sort<sequential_execution>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the divide/conquer pattern.
 \note Specialization for sequential_execution.
@@ -474,6 +695,62 @@ constexpr auto sequential_execution::reduce(
   return result;
 }
 
+template <typename RandomIterator, typename Compare>
+void sequential_execution::sort(
+    RandomIterator first, 
+    std::size_t sequence_size,
+    Compare && comp) const
+{
+  std::sort(first, std::next(first, sequence_size), 
+      std::forward<Compare>(comp));
+}
+
+template <typename InputIterator, typename KeyTransformer,
+          typename ValueTransformer, typename Combiner>
+auto sequential_execution::map_reduce_by_key(
+    InputIterator first, 
+    std::size_t sequence_size,
+    KeyTransformer && key_op,
+    ValueTransformer && value_op,
+    Combiner && combine_op) const
+{
+  return hash_map_reduce_by_key(first, sequence_size,
+      std::forward<KeyTransformer>(key_op),
+      std::forward<ValueTransformer>(value_op),
+      std::forward<Combiner>(combine_op),
+      1, [](std::size_t n, auto && f) {
+        for (std::size_t i=0; i<n; ++i) { f(i); }
+      });
+}
+
+template <typename InputIterator, typename OutputIterator, 
+          typename Identity, typename Combiner>
+void sequential_execution::scan(
+    InputIterator first, 
+    std::size_t sequence_size,
+    OutputIterator first_out,
+    Identity && identity,
+    Combiner && combine_op,
+    scan_mode mode) const
+{
+  const auto last = std::next(first, sequence_size);
+  std::decay_t<Identity> result{identity};
+  if (mode == scan_mode::inclusive) {
+    while (first != last) {
+      result = combine_op(result, *first++);
+      *first_out++ = result;
+    }
+  }
+  else {
+    while (first != last) {
+      // Read the item before writing, as output may overwrite input
+      auto item = *first++;
+      *first_out++ = result;
+      result = combine_op(result, item);
+    }
+  }
+}
+
 template <typename ... InputIterators, typename Identity, 
           typename Transformer, typename Combiner>
 constexpr auto sequential_execution::map_reduce(
@@ -564,10 +841,19 @@ void sequential_execution::pipeline(
   static_assert(is_generator<Generator>,
     "First pipeline stage must be a generator");
 
-  for (;;) {
+  // Stages get their state for this stream, as patterns keep none
+  std::tuple<decltype(stream_stage(
+      std::forward<Transformers>(transform_ops)))...> stages{
+      stream_stage(std::forward<Transformers>(transform_ops))...};
+  while (!is_cancelled()) {
     auto x = generate_op();
     if (!x) break;
-    do_pipeline(*x, std::forward<Transformers>(transform_ops)...);
+    do_pipeline_stream(*x, stages, 
+        std::index_sequence_for<Transformers...>{});
+  }
+  // Stages keeping windows reduce them at the end of the stream
+  if (!is_cancelled()) {
+    flush_stream(stages, std::index_sequence_for<Transformers...>{});
   }
 }
 
@@ -651,6 +937,52 @@ void sequential_execution::do_pipeline(
   }
 }
 
+template <typename Item, typename KeyExtractor, typename Combiner,
+          typename Identity,
+          template <typename K, typename C, typename I> class KeyedReduce,
+          typename ... OtherTransformers,
+          requires_reduce_by_key<KeyedReduce<KeyExtractor,Combiner,Identity>>>
+void sequential_execution::do_pipeline(
+    Item &&, 
+    KeyedReduce<KeyExtractor,Combiner,Identity> &&,
+    OtherTransformers && ...) const
+{
+  static_assert(!is_reduce_by_key<KeyedReduce<KeyExtractor,Combiner,Identity>>,
+    "Reduce by key must be a stage of the outermost pipeline");
+}
+
+template <typename Item, typename KeyedReduce,
+          typename ... OtherTransformers>
+void sequential_execution::do_pipeline(
+    Item && item, 
+    keyed_reduce_stream<KeyedReduce> & reduce_stream,
+    OtherTransformers && ... other_transform_ops) const
+{
+  reduce_stream.add_item(std::forward<Item>(item),
+      [&](auto const & k, auto && result) {
+        do_pipeline(std::make_pair(k, std::move(result)),
+            std::forward<OtherTransformers>(other_transform_ops)...);
+      });
+}
+
+template <typename Item, typename Timestamper, typename Combiner,
+          typename Identity,
+          template <typename T, typename C, typename I> class TimeReduce,
+          typename ... OtherTransformers,
+          requires_reduce_by_time<TimeReduce<Timestamper,Combiner,Identity>>>
+void sequential_execution::do_pipeline(
+    Item && item, 
+    TimeReduce<Timestamper,Combiner,Identity> && reduce_obj,
+    OtherTransformers && ... other_transform_ops) const
+{
+  // A single thread cannot wait for the input, so windows are only
+  // reduced as items arrive and at the end of the stream
+  reduce_obj.add_item(item, [&](auto && result) {
+    do_pipeline(std::move(result),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  });
+}
+
 template <typename Item, typename Transformer, typename Predicate,
           template <typename T, typename P> class Iteration,
           typename ... OtherTransformers,
@@ -698,6 +1030,27 @@ void sequential_execution::do_pipeline(
       std::make_index_sequence<sizeof...(Transformers)+sizeof...(OtherTransformers)>());
 }
 
+template <typename Item, typename ... Stages, std::size_t ... I>
+void sequential_execution::do_pipeline_stream(
+    Item && item, 
+    std::tuple<Stages...> & stages,
+    std::index_sequence<I...>) const
+{
+  do_pipeline(std::forward<Item>(item), std::get<I>(stages)...);
+}
+
+template <typename Transformer, typename ... OtherTransformers,
+          requires_reduce_by_time<Transformer>>
+void sequential_execution::flush_stages(
+    Transformer && reduce_obj, 
+    OtherTransformers && ... other_transform_ops) const
+{
+  reduce_obj.flush([&](auto && result) {
+    do_pipeline(std::move(result), other_transform_ops...);
+  });
+  flush_stages(other_transform_ops...);
+}
+
 template <typename Item, typename ... Transformers, std::size_t ... I>
 void sequential_execution::do_pipeline_nested(
     Item && item, 
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GRPPI_SORT_H
+#define GRPPI_SORT_H
+
+#include <utility>
+#include <functional>
+
+#include "grppi/common/range_concept.h"
+#include "grppi/common/iterator_traits.h"
+#include "grppi/common/execution_traits.h"
+
+namespace grppi {
+
+/** 
+\addtogroup data_patterns
+@{
+\defgroup sort_pattern Sort pattern
+\brief Interface for applying the \ref md_sort.
+@{
+*/
+
+/**
+\brief Invoke \ref md_sort on a data sequence.
+\tparam Execution Execution policy type.
+\tparam RandomIt Random access iterator type for the sequence.
+\tparam Compare Callable type for the comparison.
+\param ex Execution policy object.
+\param first Iterator to the first element in the sequence.
+\param last Iterator to one past the end of the sequence.
+\param comp Strict weak ordering of the elements.
+\note The sort is not stable.
+*/
+template <typename Execution, typename RandomIt, typename Compare,
+          requires_iterator<RandomIt> = 0>
+void sort(const Execution & ex,
+          RandomIt first, RandomIt last,
+          Compare && comp)
+{
+  static_assert(supports_sort<Execution>(),
+      "sort not supported on execution type");
+  ex.sort(first, std::distance(first,last), std::forward<Compare>(comp));
+}
+
+/**
+\brief Invoke \ref md_sort on a data sequence in ascending order.
+\tparam Execution Execution policy type.
+\tparam RandomIt Random access iterator type for the sequence.
+\param ex Execution policy object.
+\param first Iterator to the first element in the sequence.
+\param last Iterator to one past the end of the sequence.
+*/
+template <typename Execution, typename RandomIt,
+          requires_iterator<RandomIt> = 0>
+void sort(const Execution & ex, RandomIt first, RandomIt last)
+{
+  grppi::sort(ex, first, last, std::less<>{});
+}
+
+/**
+\brief Invoke \ref md_sort on a data range.
+\tparam Execution Execution policy type.
+\tparam Range Range type for the sequence.
+\tparam Compare Callable type for the comparison.
+\param ex Execution policy object.
+\param r Range to be sorted.
+\param comp Strict weak ordering of the elements.
+\note The sort is not stable.
+*/
+template <typename Execution, typename Range, typename Compare,
+          meta::requires<range_concept,Range> = 0>
+void sort(const Execution & ex, Range && r, Compare && comp)
+{
+  static_assert(supports_sort<Execution>(),
+      "sort not supported on execution type");
+  ex.sort(r.begin(), r.size(), std::forward<Compare>(comp));
+}
+
+/**
+\brief Invoke \ref md_sort on a data range in ascending order.
+\tparam Execution Execution policy type.
+\tparam Range Range type for the sequence.
+\param ex Execution policy object.
+\param r Range to be sorted.
+*/
+template <typename Execution, typename Range,
+          meta::requires<range_concept,Range> = 0>
+void sort(const Execution & ex, Range && r)
+{
+  grppi::sort(ex, std::forward<Range>(r), std::less<>{});
+}
+
+/**
+@}
+@}
+*/
+
+}
+
+#endif
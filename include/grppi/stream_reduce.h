@@ -52,6 +52,108 @@ auto reduce(int window_size, int offset,
        std::forward<Combiner>(combine_op));
 }
 
+/**
+\brief Invoke \ref md_stream-reduce on the items of each key of a stream
+that can be composed in other streaming patterns.
+\tparam KeyExtractor Callable type returning the key of a data item.
+\tparam Identity Type of the identity value used by the combiner.
+\tparam Combiner Callable type used for data items combination.
+\param window_size Number of consecutive items of a key to be reduced.
+\param offset Number of items of a key after of which a new reduction is
+started.
+\param key_op Key extractor.
+\param identity Identity value for the combination.
+\param combine_op Combination operation.
+\return The stage, producing a pair with the key and the result of every
+window.
+*/
+template <typename KeyExtractor, typename Identity, typename Combiner>
+auto reduce_by_key(int window_size, int offset,
+                   KeyExtractor && key_op,
+                   Identity identity,
+                   Combiner && combine_op)
+{
+  return reduce_by_key_t<KeyExtractor,Combiner,Identity>(
+       1, window_size, offset, std::forward<KeyExtractor>(key_op),
+       identity, std::forward<Combiner>(combine_op));
+}
+
+/**
+\brief Invoke \ref md_stream-reduce on the items of each key of a stream
+that can be composed in other streaming patterns, with keys partitioned
+among several replicas.
+\tparam KeyExtractor Callable type returning the key of a data item.
+\tparam Identity Type of the identity value used by the combiner.
+\tparam Combiner Callable type used for data items combination.
+\param replicas Number of replicas. Each key is owned by one replica,
+selected by the hash of the key.
+\param window_size Number of consecutive items of a key to be reduced.
+\param offset Number of items of a key after of which a new reduction is
+started.
+\param key_op Key extractor.
+\param identity Identity value for the combination.
+\param combine_op Combination operation.
+\return The stage, producing a pair with the key and the result of every
+window.
+*/
+template <typename KeyExtractor, typename Identity, typename Combiner>
+auto reduce_by_key(int replicas, int window_size, int offset,
+                   KeyExtractor && key_op,
+                   Identity identity,
+                   Combiner && combine_op)
+{
+  return reduce_by_key_t<KeyExtractor,Combiner,Identity>(
+       replicas, window_size, offset, std::forward<KeyExtractor>(key_op),
+       identity, std::forward<Combiner>(combine_op));
+}
+
+/**
+\brief Invoke \ref md_stream-reduce on windows of processing time of a
+stream that can be composed in other streaming patterns.
+\tparam Identity Type of the identity value used by the combiner.
+\tparam Combiner Callable type used for data items combination.
+\param window Duration of every window.
+\param slide Time between window starts.
+\param identity Identity value for the combination.
+\param combine_op Combination operation, invoked as
+combine_op(result, item).
+*/
+template <typename Identity, typename Combiner>
+auto reduce_by_time(std::chrono::milliseconds window,
+                    std::chrono::milliseconds slide,
+                    Identity identity,
+                    Combiner && combine_op)
+{
+  return reduce_by_time_t<processing_time,Combiner,Identity>(
+       window, slide, processing_time{},
+       identity, std::forward<Combiner>(combine_op));
+}
+
+/**
+\brief Invoke \ref md_stream-reduce on windows of event time of a
+stream that can be composed in other streaming patterns.
+\tparam Timestamper Callable type returning the timestamp of a data item.
+\tparam Identity Type of the identity value used by the combiner.
+\tparam Combiner Callable type used for data items combination.
+\param window Duration of every window.
+\param slide Time between window starts.
+\param timestamp_op Timestamp extractor, returning a std::chrono duration.
+\param identity Identity value for the combination.
+\param combine_op Combination operation, invoked as
+combine_op(result, item).
+*/
+template <typename Timestamper, typename Identity, typename Combiner>
+auto reduce_by_time(std::chrono::milliseconds window,
+                    std::chrono::milliseconds slide,
+                    Timestamper && timestamp_op,
+                    Identity identity,
+                    Combiner && combine_op)
+{
+  return reduce_by_time_t<Timestamper,Combiner,Identity>(
+       window, slide, std::forward<Timestamper>(timestamp_op),
+       identity, std::forward<Combiner>(combine_op));
+}
+
 /**
 @}
 @}
@@ -21,12 +21,19 @@
 #include "../common/optional.h"
 #include "../common/mpmc_queue.h"
 #include "../common/iterator.h"
+#include "../common/tree_combine.h"
+#include "../common/cancellation.h"
+#include "../common/scan_mode.h"
+#include "../common/hash_aggregation.h"
 #include "../common/patterns.h"
 #include "../common/farm_pattern.h"
 #include "../common/execution_traits.h"
 
 #include <type_traits>
 #include <tuple>
+#include <memory>
+#include <vector>
+#include <functional>
 
 #include <tbb/tbb.h>
 
@@ -92,6 +99,22 @@ public:
   */
   bool is_ordered() const noexcept { return ordering_; }
 
+  /**
+  \brief Attaches a cancellation token checked by the patterns.
+  Once cancelled, pipeline generators stop and data patterns stop 
+  processing chunks.
+  */
+  void set_cancellation_token(cancellation_token const & token) noexcept {
+    cancellation_ = &token;
+  }
+
+  /**
+  \brief Checks if cancellation was requested through the attached token.
+  */
+  bool is_cancelled() const noexcept {
+    return cancellation_ && cancellation_->is_cancelled();
+  }
+
   /**
   \brief Sets the attributes for the queues built through make_queue<T>()
   */
@@ -101,6 +124,22 @@ public:
     num_tokens_ = tokens;
   }
 
+  /**
+  \brief Sets the waiting strategy for the non-blocking queues built through
+  make_queue<T>()
+  */
+  void set_queue_wait(queue_wait wait) noexcept {
+    queue_wait_ = wait;
+  }
+
+  /**
+  \brief Sets the soft limit in number of elements for the queues built
+  through make_queue<T>() in unbounded mode (0 means no limit).
+  */
+  void set_queue_limit(std::size_t limit) noexcept {
+    queue_limit_ = limit;
+  }
+
   /**
   \brief Makes a communication queue for elements of type T.
   Constructs a queue using the attributes that can be set via 
@@ -108,7 +147,28 @@ public:
   */
   template <typename T>
   mpmc_queue<T> make_queue() const {
-    return {queue_size_, queue_mode_};
+    mpmc_queue<T> queue{queue_size_, queue_mode_, queue_access::multiple,
+        queue_wait_, queue_limit_};
+    if (queue_statistics_) queue.set_statistics(queue_statistics_->add());
+    return queue;
+  }
+
+  /**
+  \brief Enables or disables statistics for the queues built from now on.
+  Enabling statistics discards the counters of previously built queues.
+  */
+  void set_queue_statistics(bool enabled) {
+    queue_statistics_ = enabled ?
+        std::make_shared<queue_statistics_registry>() : nullptr;
+  }
+
+  /**
+  \brief Gets the counters of the queues built while statistics were enabled.
+  \return Counters of every queue in creation order (empty if disabled).
+  */
+  std::vector<queue_counters> get_queue_statistics() const {
+    if (!queue_statistics_) return {};
+    return queue_statistics_->counters();
   }
 
   /**
@@ -174,6 +234,62 @@ public:
                   Identity && identity,
                   Transformer && transform_op, Combiner && combine_op) const;
 
+  /**
+  \brief Applies a map/reduce by key operation to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam KeyTransformer Callable object type for the key operation.
+  \tparam ValueTransformer Callable object type for the value operation.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param key_op Key callable object.
+  \param value_op Value callable object.
+  \param combine_op Combination callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \return A vector of pairs with every key and its combined value.
+  */
+  template <typename InputIterator, typename KeyTransformer,
+            typename ValueTransformer, typename Combiner>
+  auto map_reduce_by_key(InputIterator first, std::size_t sequence_size,
+                         KeyTransformer && key_op,
+                         ValueTransformer && value_op,
+                         Combiner && combine_op) const;
+
+  /**
+  \brief Applies a scan to a sequence of data items.
+  \tparam InputIterator Iterator type for the input sequence.
+  \tparam OutputIterator Iterator type for the output sequence.
+  \tparam Identity Type for the identity value.
+  \tparam Combiner Callable object type for the combination.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the input sequence.
+  \param first_out Iterator to the first element of the output sequence.
+  \param identity Identity value for the combination.
+  \param combine_op Combination callable object.
+  \param mode Inclusive or exclusive scan.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  \pre Iterators in the range `[first_out,first_out+sequence_size)` are valid. 
+  */
+  template <typename InputIterator, typename OutputIterator, 
+            typename Identity, typename Combiner>
+  void scan(InputIterator first, std::size_t sequence_size,
+            OutputIterator first_out,
+            Identity && identity, Combiner && combine_op,
+            scan_mode mode) const;
+
+  /**
+  \brief Sorts a sequence of data items.
+  \tparam RandomIterator Random access iterator type for the sequence.
+  \tparam Compare Callable object type for the comparison.
+  \param first Iterator to the first element of the sequence.
+  \param sequence_size Size of the sequence.
+  \param comp Comparison callable object.
+  \pre Iterators in the range `[first,first+sequence_size)` are valid. 
+  */
+  template <typename RandomIterator, typename Compare>
+  void sort(RandomIterator first, std::size_t sequence_size,
+            Compare && comp) const;
+
   /**
   \brief Applies a transformation to multiple sequences leaving the result in
   another sequence.
@@ -262,9 +378,17 @@ public:
                 mpmc_queue<OutputType> & output_queue) const
   {
     ::std::atomic<long> order {0};
+    // The generator stage is serial, so it may keep a block of pending items.
+    std::vector<InputType> batch(queue_batch_size);
+    std::size_t next = 0;
+    std::size_t available = 0;
     pipeline(
       [&](){
-        auto item = input_queue.pop();
+        if (next == available) {
+          available = input_queue.pop_n(batch.data(), batch.size());
+          next = 0;
+        }
+        auto item = std::move(batch[next++]);
         if(!item.first) input_queue.push(item);
         return item.first;
       },
@@ -409,6 +533,50 @@ private:
   auto make_filter(Reduce<Combiner,Identity> && reduce_obj,
                    OtherTransformers && ... other_transform_ops) const;
 
+  template <typename Input, typename KeyExtractor, typename Combiner,
+            typename Identity,
+            template <typename K, typename C, typename I> class KeyedReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_key<
+                KeyedReduce<KeyExtractor,Combiner,Identity>> = 0>
+  auto make_filter(KeyedReduce<KeyExtractor,Combiner,Identity> & reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const
+  {
+    return this->template make_filter<Input>(std::move(reduce_obj),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Input, typename KeyExtractor, typename Combiner,
+            typename Identity,
+            template <typename K, typename C, typename I> class KeyedReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_key<
+                KeyedReduce<KeyExtractor,Combiner,Identity>> = 0>
+  auto make_filter(KeyedReduce<KeyExtractor,Combiner,Identity> && reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const;
+
+  template <typename Input, typename Timestamper, typename Combiner,
+            typename Identity,
+            template <typename T, typename C, typename I> class TimeReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_time<
+                TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  auto make_filter(TimeReduce<Timestamper,Combiner,Identity> & reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const
+  {
+    return this->template make_filter<Input>(std::move(reduce_obj),
+        std::forward<OtherTransformers>(other_transform_ops)...);
+  }
+
+  template <typename Input, typename Timestamper, typename Combiner,
+            typename Identity,
+            template <typename T, typename C, typename I> class TimeReduce,
+            typename ... OtherTransformers,
+            requires_reduce_by_time<
+                TimeReduce<Timestamper,Combiner,Identity>> = 0>
+  auto make_filter(TimeReduce<Timestamper,Combiner,Identity> && reduce_obj,
+                   OtherTransformers && ... other_transform_ops) const;
+
   template <typename Input, typename Transformer, typename Predicate,
             template <typename T, typename P> class Iteration,
             typename ... OtherTransformers,
@@ -462,6 +630,18 @@ private:
 
 private:
 
+  /// Operations reducing the windows left open at the end of a stream.
+  using stream_flushes = std::vector<std::function<void()>>;
+
+  /**
+  \brief Flushes registered by the stages of the pipeline being built in
+  the calling thread (nullptr if none is being built).
+  */
+  static stream_flushes *& current_flushes() noexcept {
+    static thread_local stream_flushes * flushes = nullptr;
+    return flushes;
+  }
+
   constexpr static int token_factor_ = 4;
 
   configuration<> config_{};
@@ -475,6 +655,16 @@ private:
   int num_tokens_ = token_factor_ * concurrency_degree_;
 
   queue_mode queue_mode_ = config_.mode();
+
+  queue_wait queue_wait_ = config_.wait_mode();
+
+  std::size_t queue_limit_ = config_.queue_limit();
+
+  std::shared_ptr<queue_statistics_registry> queue_statistics_ =
+      config_.queue_statistics_enabled() ?
+          std::make_shared<queue_statistics_registry>() : nullptr;
+
+  cancellation_token const * cancellation_ = nullptr;
 };
 
 /**
@@ -514,6 +704,13 @@ constexpr bool supports_reduce<parallel_execution_tbb>() { return true; }
 template <>
 constexpr bool supports_map_reduce<parallel_execution_tbb>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the map-reduce by key pattern.
+\note Specialization for parallel_execution_tbb.
+*/
+template <>
+constexpr bool supports_map_reduce_by_key<parallel_execution_tbb>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the stencil pattern.
 \note Specialization for parallel_execution_omp when GRPPI_TBB is enabled.
@@ -521,6 +718,20 @@ constexpr bool supports_map_reduce<parallel_execution_tbb>() { return true; }
 template <>
 constexpr bool supports_stencil<parallel_execution_tbb>() { return true; }
 
+/**
+\brief Determines if an execution policy supports the scan pattern.
+\note Specialization for parallel_execution_tbb.
+*/
+template <>
+constexpr bool supports_scan<parallel_execution_tbb>() { return true; }
+
+/**
+\brief Determines if an execution policy supports the sort pattern.
+\note Specialization for parallel_execution_tbb.
+*/
+template <>
+constexpr bool supports_sort<parallel_execution_tbb>() { return true; }
+
 /**
 \brief Determines if an execution policy supports the divide/conquer pattern.
 \note Specialization for parallel_execution_omp when GRPPI_TBB is enabled.
@@ -545,6 +756,7 @@ void parallel_execution_tbb::map(
   tbb::parallel_for(
     std::size_t{0}, sequence_size, 
     [&] (std::size_t index){
+      if (is_cancelled()) return;
       first_out[index] = apply_iterators_indexed(transform_op, firsts, index);
     }
  );   
@@ -562,7 +774,8 @@ auto parallel_execution_tbb::reduce(
   return tbb::parallel_reduce(
       tbb::blocked_range<InputIterator>(first, std::next(first,sequence_size)),
       identity,
-      [combine_op,seq](const auto & range, auto value) {
+      [this,combine_op,seq](const auto & range, auto value) {
+        if (this->is_cancelled()) return value;
         return seq.reduce(range.begin(), range.size(), value, combine_op);
       },
       combine_op);
@@ -583,6 +796,10 @@ auto parallel_execution_tbb::map_reduce(
   std::vector<result_type> partial_results(concurrency_degree_);
 
   auto process_chunk = [&](auto fins, std::size_t sz, std::size_t i) {
+    if (is_cancelled()) {
+      partial_results[i] = identity;
+      return;
+    }
     partial_results[i] = seq.map_reduce(fins, sz,
         std::forward<Identity>(identity),
         std::forward<Transformer>(transform_op), 
@@ -606,9 +823,77 @@ auto parallel_execution_tbb::map_reduce(
 
   g.wait(); 
 
-  return seq.reduce(partial_results.begin(), 
-      partial_results.size(), std::forward<Identity>(identity), 
-      std::forward<Combiner>(combine_op));
+  return tree_combine(partial_results, std::forward<Combiner>(combine_op),
+      [](std::size_t n, auto && f) { 
+        tbb::parallel_for(std::size_t{0}, n, f); 
+      });
+}
+
+template <typename RandomIterator, typename Compare>
+void parallel_execution_tbb::sort(
+    RandomIterator first, 
+    std::size_t sequence_size,
+    Compare && comp) const
+{
+  tbb::parallel_sort(first, std::next(first, sequence_size), 
+      std::forward<Compare>(comp));
+}
+
+template <typename InputIterator, typename KeyTransformer,
+          typename ValueTransformer, typename Combiner>
+auto parallel_execution_tbb::map_reduce_by_key(
+    InputIterator first, 
+    std::size_t sequence_size,
+    KeyTransformer && key_op,
+    ValueTransformer && value_op,
+    Combiner && combine_op) const
+{
+  return hash_map_reduce_by_key(first, sequence_size,
+      std::forward<KeyTransformer>(key_op),
+      std::forward<ValueTransformer>(value_op),
+      std::forward<Combiner>(combine_op),
+      concurrency_degree_,
+      [](std::size_t n, auto && f) {
+        tbb::parallel_for(std::size_t{0}, n, [&f](std::size_t i) { f(i); });
+      });
+}
+
+template <typename InputIterator, typename OutputIterator, 
+          typename Identity, typename Combiner>
+void parallel_execution_tbb::scan(
+    InputIterator first, 
+    std::size_t sequence_size,
+    OutputIterator first_out,
+    Identity && identity,
+    Combiner && combine_op,
+    scan_mode mode) const
+{
+  using result_type = std::decay_t<Identity>;
+  const bool exclusive = (mode == scan_mode::exclusive);
+
+  tbb::parallel_scan(
+    tbb::blocked_range<std::size_t>(0, sequence_size),
+    result_type{identity},
+    [&](const tbb::blocked_range<std::size_t> & r, result_type sum, 
+        bool is_final) {
+      auto in = std::next(first, r.begin());
+      auto out = std::next(first_out, r.begin());
+      for (auto i = r.begin(); i != r.end(); ++i) {
+        if (is_final && exclusive) {
+          auto item = *in++;
+          *out++ = sum;
+          sum = combine_op(sum, item);
+        }
+        else {
+          sum = combine_op(sum, *in++);
+          if (is_final) *out++ = sum;
+        }
+      }
+      return sum;
+    },
+    [&](const result_type & x, const result_type & y) {
+      return combine_op(x, y);
+    });
 }
 
 template <typename ... InputIterators, typename OutputIterator,
@@ -621,6 +906,7 @@ void parallel_execution_tbb::stencil(
 {
   const auto chunk_size = sequence_size / concurrency_degree_;
   auto process_chunk = [&](auto f, std::size_t sz, std::size_t delta) {
+    if (is_cancelled()) return;
     constexpr sequential_execution seq{};
     seq.stencil(f, std::next(first_out,delta), sz,
       std::forward<StencilTransformer>(transform_op),
@@ -688,6 +974,10 @@ void parallel_execution_tbb::pipeline(
   auto generator = tbb::make_filter<void, output_type>(
     tbb::filter::serial_in_order, 
     [&](tbb::flow_control & fc) -> output_type {
+      if (is_cancelled()) {
+        fc.stop();
+        return {};
+      }
       auto item =  generate_op();
       if (item) {
         return *item;
@@ -699,15 +989,24 @@ void parallel_execution_tbb::pipeline(
     }
   );
 
+  // Stages keeping windows, even in nested pipelines, register how to
+  // reduce them at the end of the stream while the filters are built
+  stream_flushes flushes;
+  auto outer_flushes = current_flushes();
+  current_flushes() = &flushes;
   auto rest =
     this->template make_filter<output_value_type>(forward<Transformers>(transform_ops)...);
-
+  current_flushes() = outer_flushes;
 
   tbb::task_group_context context;
   tbb::parallel_pipeline(tokens(), 
     generator
     & 
     rest);
+
+  if (!is_cancelled()) {
+    for (auto & flush : flushes) { flush(); }
+  }
 }
 
 // PRIVATE MEMBERS
@@ -989,6 +1288,114 @@ auto parallel_execution_tbb::make_filter(
           std::forward<OtherTransformers>(other_transform_ops)...);
 }
 
+template <typename Input, typename KeyExtractor, typename Combiner,
+          typename Identity,
+          template <typename K, typename C, typename I> class KeyedReduce,
+          typename ... OtherTransformers,
+          requires_reduce_by_key<KeyedReduce<KeyExtractor,Combiner,Identity>>>
+auto parallel_execution_tbb::make_filter(
+    KeyedReduce<KeyExtractor,Combiner,Identity> && reduce_obj,
+    OtherTransformers && ... other_transform_ops) const
+{
+  using namespace std;
+
+  using input_value_type = Input;
+  using input_type = grppi::optional<input_value_type>;
+  using reduce_type = KeyedReduce<KeyExtractor,Combiner,Identity>;
+  using output_value_type = 
+      typename reduce_type::template result_type<input_value_type>;
+  using output_type = grppi::optional<output_value_type>;
+
+  // A serial filter owns the windows of every key, made for this stream
+  auto windows = make_shared<decltype(
+      reduce_obj.template make_windows<input_value_type>())>(
+          reduce_obj.template make_windows<input_value_type>());
+  return tbb::make_filter<input_type, output_type>(
+      tbb::filter::serial,
+      [&reduce_obj,windows](input_type item) -> output_type {
+        if (!item) return {};
+        output_type result;
+        auto key = reduce_obj.key(*item);
+        windows->add_item(
+            std::move(key), std::move(*item),
+            [&](auto const & k, auto && red) {
+              result = make_pair(k, std::move(red));
+            });
+        return result;
+      })
+    &
+      this->template make_filter<output_value_type>(
+          std::forward<OtherTransformers>(other_transform_ops)...);
+}
+
+template <typename Input, typename Timestamper, typename Combiner,
+          typename Identity,
+          template <typename T, typename C, typename I> class TimeReduce,
+          typename ... OtherTransformers,
+          requires_reduce_by_time<TimeReduce<Timestamper,Combiner,Identity>>>
+auto parallel_execution_tbb::make_filter(
+    TimeReduce<Timestamper,Combiner,Identity> && reduce_obj,
+    OtherTransformers && ... other_transform_ops) const
+{
+  using namespace std;
+
+  using input_value_type = Input;
+  using input_type = grppi::optional<input_value_type>;
+  using reduce_type = TimeReduce<Timestamper,Combiner,Identity>;
+  using result_type = typename reduce_type::result_type;
+  using output_type = grppi::optional<result_type>;
+  static_assert(sizeof...(OtherTransformers) > 0,
+      "Reduce by time must be followed by other stages in TBB pipelines");
+
+  // A filter yields at most one item, while an item may close several
+  // windows. So the reduction ends the TBB pipeline, and the results of
+  // each item go through the next stages in a nested pipeline. The windows
+  // and the next stages are made once, so that they keep their state for
+  // the stream.
+  auto reduction = make_shared<reduce_type>(reduce_obj);
+  auto next_stages = make_shared<decltype(
+      this->template make_filter<result_type>(
+          std::forward<OtherTransformers>(other_transform_ops)...))>(
+      this->template make_filter<result_type>(
+          std::forward<OtherTransformers>(other_transform_ops)...));
+  auto run_next_stages = [this,next_stages](vector<result_type> & results) {
+    if (results.empty()) return;
+    auto next = results.begin();
+    tbb::parallel_pipeline(tokens(),
+        tbb::make_filter<void, output_type>(
+            tbb::filter::serial_in_order,
+            [&](tbb::flow_control & fc) -> output_type {
+              if (next == results.end()) {
+                fc.stop();
+                return {};
+              }
+              return std::move(*next++);
+            })
+      & *next_stages);
+  };
+
+  if (auto flushes = current_flushes()) {
+    flushes->push_back([reduction,run_next_stages]() {
+      vector<result_type> results;
+      reduction->flush([&](result_type && result) {
+        results.push_back(std::move(result));
+      });
+      run_next_stages(results);
+    });
+  }
+
+  return tbb::make_filter<input_type, void>(
+      tbb::filter::serial_in_order,
+      [reduction,run_next_stages](input_type item) {
+        if (!item) return;
+        vector<result_type> results;
+        reduction->add_item(*item, [&](result_type && result) {
+          results.push_back(std::move(result));
+        });
+        run_next_stages(results);
+      });
+}
+
 template <typename Input, typename Transformer, typename Predicate,
           template <typename T, typename P> class Iteration,
           typename ... OtherTransformers,
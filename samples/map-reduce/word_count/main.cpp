@@ -40,18 +40,16 @@ void test_mapreduce(grppi::dynamic_execution & ex,
   copy(istream_iterator<string>{file}, istream_iterator<string>{},
     back_inserter(words));
 
-  // Word count for vector of lines
-  auto result = map_reduce(ex,
-    words.begin(), words.end(), map<string,int>{},
-    [](string word) -> map<string,int> { return {{word,1}}; },
-    [](map<string,int> & lhs, const map<string,int> & rhs) -> map<string,int> & {
-      for (auto & w : rhs) {
-        lhs[w.first]+= w.second;
-      }
-      return lhs;
-    }
+  // Word count for vector of words
+  auto counts = map_reduce_by_key(ex, words,
+    [](const string & word) { return word; },
+    [](const string &) { return 1; },
+    [](int x, int y) { return x + y; }
   );
 
+  // Keys are not ordered, sort them for the output
+  map<string,int> result(counts.begin(), counts.end());
+
   cout << "Word : count " << endl;
   for (const auto & w : result) {
     cout << w.first << " : " << w.second << endl;
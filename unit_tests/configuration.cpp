@@ -139,6 +139,30 @@ TEST(configuration_synthetic, get_negative_queue_size){
   EXPECT_EQ(config.default_queue_size, config.queue_size());
 }
 
+TEST(configuration_synthetic, get_good_reorder_capacity){
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_REORDER_CAPACITY") == 0) return "64";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(64, config.reorder_capacity());
+}
+
+TEST(configuration_synthetic, get_zero_reorder_capacity){
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_REORDER_CAPACITY") == 0) return "0";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(config.default_reorder_capacity, config.reorder_capacity());
+}
+
 TEST(configuration_synthetic, get_blocking_mode) {
   struct getter {
     const char * operator()(char const * var_name) {
@@ -163,6 +187,124 @@ TEST(configuration_synthetic, get_lockfree_mode) {
   EXPECT_EQ(queue_mode::lockfree, config.mode());
 }
 
+TEST(configuration_synthetic, get_sequenced_mode) {
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_QUEUE_MODE") == 0) return "sequenced";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(queue_mode::sequenced, config.mode());
+}
+
+TEST(configuration_synthetic, get_default_wait) {
+  struct getter {
+    const char * operator()(char const *) { return nullptr; }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(queue_wait::spin, config.wait_mode());
+}
+
+TEST(configuration_synthetic, get_backoff_wait) {
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_QUEUE_WAIT") == 0) return "backoff";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(queue_wait::backoff, config.wait_mode());
+}
+
+TEST(configuration_synthetic, get_unbounded_mode) {
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_QUEUE_MODE") == 0) return "unbounded";
+      if (strcmp(var_name,"GRPPI_QUEUE_LIMIT") == 0) return "100000";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(queue_mode::unbounded, config.mode());
+  EXPECT_EQ(100000u, config.queue_limit());
+}
+
+TEST(configuration_synthetic, get_sharded_distribution) {
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_FARM_DISTRIBUTION") == 0) return "sharded";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(farm_distribution::sharded, config.distribution());
+}
+
+TEST(configuration_synthetic, get_queue_statistics) {
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_QUEUE_STATS") == 0) return "on";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_TRUE(config.queue_statistics_enabled());
+}
+
+TEST(configuration_synthetic, get_stage_fusion) {
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_STAGE_FUSION") == 0) return "on";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_TRUE(config.stage_fusion_enabled());
+}
+
+TEST(configuration_synthetic, get_default_schedule) {
+  struct getter {
+    const char * operator()(char const *) { return nullptr; }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(loop_schedule::static_chunks, config.schedule());
+  EXPECT_EQ(0u, config.schedule_chunk());
+}
+
+TEST(configuration_synthetic, get_dynamic_schedule) {
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_SCHEDULE") == 0) return "dynamic,64";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(loop_schedule::dynamic_chunks, config.schedule());
+  EXPECT_EQ(64u, config.schedule_chunk());
+}
+
+TEST(configuration_synthetic, get_invalid_schedule) {
+  struct getter {
+    const char * operator()(char const * var_name) {
+      if (strcmp(var_name,"GRPPI_SCHEDULE") == 0) return "guided,-2";
+      return nullptr;
+    }
+  };
+
+  configuration<getter> config;
+  EXPECT_EQ(loop_schedule::static_chunks, config.schedule());
+}
+
 TEST(configuration_synthetic, get_unknown_mode) {
   struct getter {
     const char * operator()(char const * var_name) {
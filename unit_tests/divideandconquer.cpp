@@ -259,3 +259,28 @@ TYPED_TEST(divideconquer_test, static_multiple_triple_div_4_threads)
   this->out =  this->run_vecsum_chunked(this->execution_);
   this->check_multiple_triple_div();
 }
+
+TEST(divideconquer_native, skewed_tree)
+{
+  parallel_execution_native ex{4};
+  using range = std::pair<long,long>;
+
+  // Every division leaves a single leaf and the rest of the range
+  auto result = grppi::divide_conquer(ex, range{0, 500},
+    [](range r) -> std::vector<range> {
+      return {{r.first, r.first+1}, {r.first+1, r.second}};
+    },
+    [](range r) { return r.second - r.first <= 1; },
+    [](range r) {
+      long s = 0;
+      for (long i=0; i<=r.first*10; ++i) { s += i%7; }
+      return s;
+    },
+    [](long x, long y) { return x+y; });
+
+  long expected = 0;
+  for (long j=0; j<500; ++j) {
+    for (long i=0; i<=j*10; ++i) { expected += i%7; }
+  }
+  EXPECT_EQ(expected, result);
+}
@@ -14,6 +14,11 @@
  * limitations under the License.
  */
 #include <atomic>
+#include <numeric>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include <gtest/gtest.h>
 
@@ -420,3 +425,66 @@ TYPED_TEST(map_test, dyn_multiple_nary_tuple_range)
   this->check_multiple_nary();
 }
 
+
+TEST(map_native, reuses_thread_pool)
+{
+  parallel_execution_native ex{4};
+  parallel_execution_native copy{ex};
+  EXPECT_EQ(&ex.pool(), &copy.pool());
+
+  vector<int> v(100, 1);
+  vector<int> w(100);
+  for (int i=0; i<50; ++i) {
+    grppi::map(copy, begin(v), end(v), begin(w), [](int x) { return x+1; });
+  }
+  EXPECT_EQ(200, accumulate(begin(w), end(w), 0));
+  // Threads finishing a task may still be counted as busy by the next call
+  EXPECT_LE(4, ex.pool().size());
+  EXPECT_GE(7, ex.pool().size());
+}
+
+TEST(map_native, thread_pool_follows_concurrency_degree)
+{
+  parallel_execution_native ex{2};
+  vector<int> v(100, 1);
+  vector<int> w(100);
+  grppi::map(ex, begin(v), end(v), begin(w), [](int x) { return x+1; });
+  EXPECT_LE(2, ex.pool().size());
+
+  ex.set_concurrency_degree(6);
+  grppi::map(ex, begin(v), end(v), begin(w), [](int x) { return x+1; });
+  EXPECT_EQ(200, accumulate(begin(w), end(w), 0));
+  EXPECT_LE(6, ex.pool().size());
+}
+
+TEST(thread_pool_native, retires_idle_threads)
+{
+  thread_pool pool{2, std::chrono::milliseconds{20}};
+
+  // Blocked tasks make the pool grow above its capacity
+  std::mutex mut;
+  std::condition_variable cv;
+  bool release = false;
+  int done = 0;
+  for (int i=0; i<6; ++i) {
+    pool.submit([&]() {
+      std::unique_lock<std::mutex> lk{mut};
+      cv.wait(lk, [&] { return release; });
+      done++;
+      cv.notify_all();
+    });
+  }
+  EXPECT_LE(6, pool.size());
+  {
+    std::unique_lock<std::mutex> lk{mut};
+    release = true;
+    cv.notify_all();
+    cv.wait(lk, [&] { return done == 6; });
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+  while (pool.size() > 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  EXPECT_EQ(2, pool.size());
+}
@@ -17,6 +17,8 @@
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include <numeric>
+#include <string>
 
 #include "grppi/mapreduce.h"
 #include "grppi/dyn/dynamic_execution.h"
@@ -338,3 +340,44 @@ TYPED_TEST(map_reduce_test, dyn_multiple_scalar_product_tuple_size_range)
   this->output = this->run_scalar_product_tuple_range(this->dyn_execution_);
   this->check_multiple_scalar_product();
 }
+
+TEST(map_reduce_native, schedules_keep_order)
+{
+  vector<int> v(1000);
+  iota(begin(v), end(v), 0);
+  string expected;
+  for (int x : v) { expected += to_string(x) + ","; }
+
+  parallel_execution_native ex{4};
+  for (auto schedule : {loop_schedule::static_chunks, 
+      loop_schedule::dynamic_chunks, loop_schedule::guided_chunks}) {
+    for (std::size_t chunk : {0, 1, 7}) {
+      ex.set_schedule(schedule, chunk);
+      auto result = grppi::map_reduce(ex, begin(v), end(v), string{},
+          [](int x) { return to_string(x) + ","; },
+          [](string const & x, string const & y) { return x + y; });
+      EXPECT_EQ(expected, result);
+    }
+  }
+}
+
+TEST(map_reduce_native, cancelled)
+{
+  vector<int> v(100000, 1);
+  parallel_execution_native ex{2};
+  ex.set_schedule(loop_schedule::dynamic_chunks, 1);
+  cancellation_token token;
+  ex.set_cancellation_token(token);
+
+  std::atomic<int> transformed{0};
+  auto result = grppi::map_reduce(ex, begin(v), end(v), 0,
+      [&](int x) { 
+        if (++transformed == 10) token.cancel();
+        return x; 
+      },
+      [](int x, int y) { return x + y; });
+
+  EXPECT_TRUE(token.is_cancelled());
+  EXPECT_EQ(transformed.load(), result);
+  EXPECT_LT(transformed, 1000);
+}
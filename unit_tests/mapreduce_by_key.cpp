@@ -0,0 +1,194 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "grppi/mapreduce_by_key.h"
+#include "grppi/dyn/dynamic_execution.h"
+
+#include "supported_executions.h"
+
+using namespace std;
+using namespace grppi;
+
+template <typename T>
+class map_reduce_by_key_test : public ::testing::Test {
+public:
+  T execution_{};
+  dynamic_execution dyn_execution_{execution_};
+
+  // Variables
+  vector<string> words{};
+  map<string,int> expected{};
+  vector<pair<string,int>> result{};
+
+  void setup_empty() {
+    words = {};
+    expected = {};
+  }
+
+  void setup_words(int size) {
+    words = vector<string>(size);
+    expected = {};
+    for (int i=0; i<size; ++i) {
+      words[i] = "w" + to_string((i * 31) % 97);
+      expected[words[i]]++;
+    }
+  }
+
+  template <typename E>
+  void run_word_count(const E & e) {
+    result = grppi::map_reduce_by_key(e, words.begin(), words.end(),
+      [](string const & w) { return w; },
+      [](string const &) { return 1; },
+      [](int x, int y) { return x + y; });
+  }
+
+  template <typename E>
+  void run_word_count_range(const E & e) {
+    result = grppi::map_reduce_by_key(e, words,
+      [](string const & w) { return w; },
+      [](string const &) { return 1; },
+      [](int x, int y) { return x + y; });
+  }
+
+  void check() {
+    EXPECT_EQ(expected.size(), result.size());
+    map<string,int> counts(result.begin(), result.end());
+    EXPECT_EQ(expected, counts);
+  }
+
+  template <typename E>
+  void run_ordered(const E & e, int size) {
+    vector<int> v(size);
+    map<int,string> expected_strings;
+    for (int i=0; i<size; ++i) {
+      v[i] = i;
+      expected_strings[i % 5] += to_string(i) + ",";
+    }
+    auto out = grppi::map_reduce_by_key(e, v,
+      [](int x) { return x % 5; },
+      [](int x) { return to_string(x) + ","; },
+      [](string const & x, string const & y) { return x + y; });
+    map<int,string> strings(out.begin(), out.end());
+    EXPECT_EQ(expected_strings, strings);
+  }
+
+  template <typename E>
+  void run_reference_values(const E & e) {
+    vector<pair<int,string>> v;
+    map<int,string> expected_strings;
+    for (int i=0; i<100; ++i) {
+      v.emplace_back(i % 3, to_string(i));
+      expected_strings[i % 3] += to_string(i);
+    }
+    auto out = grppi::map_reduce_by_key(e, v,
+      [](pair<int,string> const & x) { return x.first; },
+      [](pair<int,string> const & x) -> string const & { return x.second; },
+      [](string const & x, string const & y) { return x + y; });
+    map<int,string> strings(out.begin(), out.end());
+    EXPECT_EQ(expected_strings, strings);
+  }
+};
+
+// Test for execution policies defined in supported_executions.h
+TYPED_TEST_CASE(map_reduce_by_key_test, executions);
+
+TYPED_TEST(map_reduce_by_key_test, static_empty)
+{
+  this->setup_empty();
+  this->run_word_count(this->execution_);
+  this->check();
+}
+
+TYPED_TEST(map_reduce_by_key_test, static_word_count)
+{
+  this->setup_words(10000);
+  this->run_word_count(this->execution_);
+  this->check();
+}
+
+TYPED_TEST(map_reduce_by_key_test, static_word_count_range)
+{
+  this->setup_words(10000);
+  this->run_word_count_range(this->execution_);
+  this->check();
+}
+
+TYPED_TEST(map_reduce_by_key_test, static_ordered)
+{
+  this->run_ordered(this->execution_, 1001);
+}
+
+TYPED_TEST(map_reduce_by_key_test, static_reference_values)
+{
+  this->run_reference_values(this->execution_);
+}
+
+TYPED_TEST(map_reduce_by_key_test, dyn_word_count)
+{
+  this->setup_words(10000);
+  this->run_word_count(this->dyn_execution_);
+  this->check();
+}
+
+TYPED_TEST(map_reduce_by_key_test, dyn_word_count_range)
+{
+  this->setup_words(10000);
+  this->run_word_count_range(this->dyn_execution_);
+  this->check();
+}
+
+TEST(map_reduce_by_key_native, schedules_keep_order)
+{
+  vector<int> v(1000);
+  iota(begin(v), end(v), 0);
+  map<int,string> expected;
+  for (int x : v) { expected[x % 7] += to_string(x) + ","; }
+
+  parallel_execution_native ex{4};
+  for (auto schedule : {loop_schedule::static_chunks,
+      loop_schedule::dynamic_chunks, loop_schedule::guided_chunks}) {
+    for (std::size_t chunk : {0, 1, 7}) {
+      ex.set_schedule(schedule, chunk);
+      auto result = grppi::map_reduce_by_key(ex, v,
+          [](int x) { return x % 7; },
+          [](int x) { return to_string(x) + ","; },
+          [](string const & x, string const & y) { return x + y; });
+      EXPECT_EQ(expected, (map<int,string>(result.begin(), result.end())));
+    }
+  }
+}
+
+TEST(hash_aggregation_table, grows_and_drains)
+{
+  hash_aggregation_table<long,long> table{2};
+  auto add = [](long x, long y) { return x + y; };
+  for (long i=0; i<1000; ++i) {
+    table.aggregate(mix_hash(i % 300), i % 300, 1L, add);
+  }
+  EXPECT_EQ(300u, table.size());
+  long total = 0;
+  table.drain([&](std::size_t, pair<long,long> && entry) {
+    total += entry.second;
+  });
+  EXPECT_EQ(1000, total);
+  EXPECT_TRUE(table.empty());
+}
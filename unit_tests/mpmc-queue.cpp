@@ -21,6 +21,8 @@
 #include <utility>
 #include <iostream>
 #include <numeric>
+#include <chrono>
+#include <memory>
 
 using namespace std;
 using namespace grppi;
@@ -36,7 +38,9 @@ public:
 
 };
 
-using types = ::testing::Types<atomic_mpmc_queue<int>, locked_mpmc_queue<int>>;
+using types = ::testing::Types<atomic_mpmc_queue<int>, locked_mpmc_queue<int>,
+    sequenced_mpmc_queue<int>, unbounded_mpmc_queue<int>,
+    atomic_mpmc_queue<int,backoff_wait>, sequenced_mpmc_queue<int,backoff_wait>>;
 
 TYPED_TEST_CASE(mpmc_test, types);
                 
@@ -101,6 +105,102 @@ TYPED_TEST(mpmc_test , concurrent_pop_push){
   EXPECT_TRUE(q.empty());
 }
 
+TYPED_TEST(mpmc_test, push_n_pop_n){
+  auto q = this->make_queue(10);
+  std::vector<int> in{1,2,3,4,5};
+  q.push_n(in.begin(), in.end());
+  EXPECT_FALSE(q.empty());
+
+  std::vector<int> out(10);
+  auto n = q.pop_n(out.begin(), out.size());
+  EXPECT_EQ(5u, n);
+  EXPECT_TRUE(q.empty());
+  EXPECT_TRUE(std::equal(in.begin(), in.end(), out.begin()));
+}
+
+TYPED_TEST(mpmc_test, concurrent_push_n_pop_n){
+  auto q = this->make_queue(3);
+  constexpr int n = 100;
+
+  std::vector<std::thread> thrs;
+  for (int t=0; t<2; ++t) {
+    thrs.push_back(std::thread([&q](){
+      std::vector<int> v(n/2);
+      std::iota(v.begin(), v.end(), 1);
+      q.push_n(v.begin(), v.end());
+    }));
+  }
+
+  int count = 0;
+  int val = 0;
+  std::vector<int> out(4);
+  while (count < n) {
+    auto m = q.pop_n(out.begin(), out.size());
+    count += m;
+    val = std::accumulate(out.begin(), out.begin()+m, val);
+  }
+
+  for (auto & t : thrs) { t.join(); }
+
+  EXPECT_EQ(n, count);
+  EXPECT_EQ(2 * (n/2) * (n/2+1) / 2, val);
+  EXPECT_TRUE(q.empty());
+}
+
+
+TYPED_TEST(mpmc_test, push_with_pop_with){
+  auto q = this->make_queue(3);
+  std::thread producer{[&q](){
+    for (int i=0; i<10; ++i) {
+      q.push_with([i](int & slot) { slot = i; });
+    }
+  }};
+
+  int val = 0;
+  for (int i=0; i<10; ++i) {
+    q.pop_with([&val](int & slot) { val += slot; });
+  }
+  producer.join();
+
+  EXPECT_EQ(45, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TYPED_TEST(mpmc_test, try_push_try_pop){
+  auto q = this->make_queue(2);
+  int value = 0;
+  EXPECT_FALSE(q.try_pop(value));
+
+  EXPECT_TRUE(q.try_push(1));
+  EXPECT_TRUE(q.try_push(2));
+  EXPECT_TRUE(q.try_pop(value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(q.try_pop(value));
+  EXPECT_EQ(2, value);
+  EXPECT_TRUE(q.empty());
+}
+
+TYPED_TEST(mpmc_test, push_for_pop_for){
+  auto q = this->make_queue(2);
+  int value = 0;
+  EXPECT_FALSE(q.pop_for(value, std::chrono::milliseconds{1}));
+
+  std::thread producer{[&q](){
+    for (int i=1; i<=10; ++i) {
+      while (!q.push_for(std::move(i), std::chrono::milliseconds{1})) {}
+    }
+  }};
+
+  int val = 0;
+  for (int i=0; i<10; ++i) {
+    while (!q.pop_for(value, std::chrono::milliseconds{1})) {}
+    val += value;
+  }
+  producer.join();
+
+  EXPECT_EQ(55, val);
+  EXPECT_TRUE(q.empty());
+}
 
 TEST(mpmc_queue_blocking, constructor){
   mpmc_queue<int> queue(10, queue_mode::blocking);
@@ -225,3 +325,452 @@ TEST(mpmc_queue_lockfree, concurrent_pop_push){
   EXPECT_TRUE(q.empty());
 }
 
+TEST(mpmc_queue_sequenced, constructor){
+  mpmc_queue<int> queue(10, queue_mode::sequenced);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(mpmc_queue_sequenced, push_pop){
+  mpmc_queue<int> queue(10, queue_mode::sequenced);
+  queue.push(1);
+  EXPECT_FALSE(queue.empty());
+
+  int value = queue.pop();
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(1,value);
+}
+
+TEST(mpmc_queue_sequenced, concurrent_push_pop){
+  mpmc_queue<int> q(3, queue_mode::sequenced);
+  std::vector<std::thread> thrs;
+  for (int i=0; i<6; ++i) {
+    thrs.push_back(std::thread([&q,i](){
+      q.push(i);
+    }));
+  }
+
+  int val = 0;
+  for (int i=0; i<6; ++i) {
+    val += q.pop();
+  }
+
+  for (auto & t : thrs) {
+    t.join();
+  }
+  EXPECT_EQ(15, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_sequenced, concurrent_pop_push){
+  mpmc_queue<int> q(3, queue_mode::sequenced);
+  std::vector<std::thread> thrs;
+  std::vector<int> v(6);
+  for (int i=0; i<6; ++i) {
+    thrs.push_back(std::thread([&q,&v,i](){
+      v[i] = q.pop();
+    }));
+  }
+
+  for (int i=0; i<6; ++i) {
+    q.push(i);
+  }
+
+  for (auto & t : thrs) {
+    t.join();
+  }
+  int val = std::accumulate(std::begin(v), std::end(v), 0);
+
+  EXPECT_EQ(15, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_sequenced, wraparound){
+  mpmc_queue<int> q(4, queue_mode::sequenced);
+  constexpr int n = 100;
+  std::thread producer{[&q](){
+    for (int i=0; i<n; ++i) { q.push(i); }
+  }};
+
+  long long val = 0;
+  for (int i=0; i<n; ++i) {
+    val += q.pop();
+  }
+  producer.join();
+
+  EXPECT_EQ(static_cast<long long>(n)*(n-1)/2, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(spsc_queue, constructor){
+  spsc_queue<int> queue(10);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(spsc_queue, push_pop){
+  spsc_queue<int> queue(10);
+  queue.push(1);
+  EXPECT_FALSE(queue.empty());
+
+  int value = queue.pop();
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(1,value);
+}
+
+TEST(spsc_queue, concurrent_push_pop){
+  spsc_queue<int> q(3);
+  constexpr int n = 100;
+  std::thread producer{[&q](){
+    for (int i=0; i<n; ++i) { q.push(i); }
+  }};
+
+  bool ordered = true;
+  for (int i=0; i<n; ++i) {
+    if (q.pop() != i) ordered = false;
+  }
+  producer.join();
+
+  EXPECT_TRUE(ordered);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_single, lockfree_push_pop){
+  mpmc_queue<int> q(3, queue_mode::lockfree, queue_access::single);
+  constexpr int n = 100;
+  std::thread producer{[&q](){
+    for (int i=0; i<n; ++i) { q.push(i); }
+  }};
+
+  long long val = 0;
+  for (int i=0; i<n; ++i) {
+    val += q.pop();
+  }
+  producer.join();
+
+  EXPECT_EQ(static_cast<long long>(n)*(n-1)/2, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_single, blocking_push_pop){
+  mpmc_queue<int> q(3, queue_mode::blocking, queue_access::single);
+  std::thread producer{[&q](){
+    for (int i=0; i<6; ++i) { q.push(i); }
+  }};
+
+  int val = 0;
+  for (int i=0; i<6; ++i) {
+    val += q.pop();
+  }
+  producer.join();
+
+  EXPECT_EQ(15, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(spsc_queue, concurrent_push_n_pop_n){
+  spsc_queue<int> q(3);
+  constexpr int n = 100;
+  std::thread producer{[&q](){
+    std::vector<int> v(n);
+    std::iota(v.begin(), v.end(), 0);
+    q.push_n(v.begin(), v.end());
+  }};
+
+  std::vector<int> result;
+  std::vector<int> out(4);
+  while (result.size() < n) {
+    auto m = q.pop_n(out.begin(), out.size());
+    result.insert(result.end(), out.begin(), out.begin()+m);
+  }
+  producer.join();
+
+  std::vector<int> expected(n);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(expected, result);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_blocking, push_n_pop_n){
+  mpmc_queue<int> queue(10, queue_mode::blocking);
+  int in[] = {1,2,3};
+  queue.push_n(std::begin(in), std::end(in));
+
+  int out[5];
+  EXPECT_EQ(3u, queue.pop_n(out, 5));
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(6, out[0]+out[1]+out[2]);
+}
+
+TEST(mpmc_queue_lockfree, push_n_pop_n){
+  mpmc_queue<int> queue(10, queue_mode::lockfree);
+  int in[] = {1,2,3};
+  queue.push_n(std::begin(in), std::end(in));
+
+  int out[5];
+  EXPECT_EQ(3u, queue.pop_n(out, 5));
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(6, out[0]+out[1]+out[2]);
+}
+
+TEST(mpmc_queue_backoff, lockfree_concurrent_push_pop){
+  mpmc_queue<int> q(3, queue_mode::lockfree, queue_access::multiple,
+      queue_wait::backoff);
+  std::vector<std::thread> thrs;
+  for (int i=0; i<6; ++i) {
+    thrs.push_back(std::thread([&q,i](){
+      q.push(i);
+    }));
+  }
+
+  int val = 0;
+  for (int i=0; i<6; ++i) {
+    val += q.pop();
+  }
+
+  for (auto & t : thrs) {
+    t.join();
+  }
+  EXPECT_EQ(15, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_backoff, single_push_pop){
+  mpmc_queue<int> q(3, queue_mode::lockfree, queue_access::single,
+      queue_wait::backoff);
+  constexpr int n = 100;
+  std::thread producer{[&q](){
+    for (int i=0; i<n; ++i) { q.push(i); }
+  }};
+
+  bool ordered = true;
+  for (int i=0; i<n; ++i) {
+    if (q.pop() != i) ordered = false;
+  }
+  producer.join();
+
+  EXPECT_TRUE(ordered);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_backoff, move_construct){
+  mpmc_queue<int> q(3, queue_mode::sequenced, queue_access::multiple,
+      queue_wait::backoff);
+  q.push(1);
+  q.push(2);
+
+  mpmc_queue<int> r{std::move(q)};
+  EXPECT_EQ(1, r.pop());
+  EXPECT_EQ(2, r.pop());
+  EXPECT_TRUE(r.empty());
+}
+
+TEST(mpmc_queue_blocking, push_n_wakes_waiting_consumers){
+  mpmc_queue<int> q(10, queue_mode::blocking);
+  std::atomic<int> val{0};
+  std::vector<std::thread> thrs;
+  for (int i=0; i<4; ++i) {
+    thrs.push_back(std::thread([&q,&val](){
+      val += q.pop();
+    }));
+  }
+
+  int in[] = {1,2,3,4};
+  q.push_n(std::begin(in), std::end(in));
+
+  for (auto & t : thrs) {
+    t.join();
+  }
+  EXPECT_EQ(10, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(unbounded_queue, grow_and_shrink){
+  unbounded_mpmc_queue<int> q(4);
+  constexpr int n = 1000;
+  for (int i=0; i<n; ++i) { q.push(i); }
+
+  bool ordered = true;
+  for (int i=0; i<n; ++i) {
+    if (q.pop() != i) ordered = false;
+  }
+  EXPECT_TRUE(ordered);
+  EXPECT_TRUE(q.empty());
+
+  q.push(42);
+  EXPECT_EQ(42, q.pop());
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(unbounded_queue, soft_limit){
+  unbounded_mpmc_queue<int> q(2, 3);
+  constexpr int n = 100;
+  std::thread producer{[&q](){
+    for (int i=0; i<n; ++i) { q.push(i); }
+  }};
+
+  long long val = 0;
+  for (int i=0; i<n; ++i) {
+    val += q.pop();
+  }
+  producer.join();
+
+  EXPECT_EQ(static_cast<long long>(n)*(n-1)/2, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_unbounded, push_pop){
+  mpmc_queue<int> q(2, queue_mode::unbounded);
+  for (int i=0; i<10; ++i) { q.push(i); }
+
+  int val = 0;
+  for (int i=0; i<10; ++i) {
+    val += q.pop();
+  }
+  EXPECT_EQ(45, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_lockfree, push_with_pop_with){
+  mpmc_queue<std::vector<int>> q(3, queue_mode::lockfree);
+  q.push_with([](std::vector<int> & slot) { slot.assign({1,2,3}); });
+
+  int val = 0;
+  q.pop_with([&val](std::vector<int> & slot) {
+    val = std::accumulate(slot.begin(), slot.end(), 0);
+  });
+  EXPECT_EQ(6, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_lockfree, try_push_full){
+  mpmc_queue<int> q(2, queue_mode::lockfree);
+  EXPECT_TRUE(q.try_push(1));
+  EXPECT_TRUE(q.try_push(2));
+  EXPECT_FALSE(q.try_push(3));
+  EXPECT_FALSE(q.push_for(3, std::chrono::milliseconds{1}));
+
+  int value = 0;
+  EXPECT_TRUE(q.pop_for(value, std::chrono::milliseconds{1}));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(q.try_push(3));
+}
+
+TEST(mpmc_queue_blocking, try_push_full){
+  mpmc_queue<int> q(2, queue_mode::blocking);
+  EXPECT_TRUE(q.try_push(1));
+  EXPECT_TRUE(q.try_push(2));
+  EXPECT_FALSE(q.try_push(3));
+  EXPECT_FALSE(q.push_for(3, std::chrono::milliseconds{1}));
+
+  int value = 0;
+  EXPECT_TRUE(q.try_pop(value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(q.pop_for(value, std::chrono::milliseconds{1}));
+  EXPECT_EQ(2, value);
+  EXPECT_FALSE(q.pop_for(value, std::chrono::milliseconds{1}));
+}
+
+TEST(mpmc_queue_backoff, pop_for_timeout){
+  mpmc_queue<int> q(2, queue_mode::sequenced, queue_access::multiple,
+      queue_wait::backoff);
+  int value = 0;
+  EXPECT_FALSE(q.pop_for(value, std::chrono::milliseconds{5}));
+  q.push(7);
+  EXPECT_TRUE(q.pop_for(value, std::chrono::milliseconds{5}));
+  EXPECT_EQ(7, value);
+}
+
+TEST(sharded_queue, pop_from_steals){
+  sharded_mpmc_queue<int> q(8, 4);
+  for (int i=0; i<8; ++i) { q.push(i); }
+
+  int val = 0;
+  for (int i=0; i<8; ++i) {
+    val += q.pop_from(0);
+  }
+  EXPECT_EQ(28, val);
+  EXPECT_TRUE(q.empty());
+
+  int value = 0;
+  EXPECT_FALSE(q.try_pop(value));
+}
+
+TEST(sharded_queue, concurrent_pop_from){
+  sharded_mpmc_queue<int> q(4, 4);
+  constexpr int n = 100;
+  std::atomic<int> val{0};
+  std::vector<std::thread> thrs;
+  for (int t=0; t<4; ++t) {
+    thrs.push_back(std::thread([&q,&val,t](){
+      for (int i=0; i<n/4; ++i) { val += q.pop_from(t); }
+    }));
+  }
+
+  for (int i=1; i<=n; ++i) { q.push(i); }
+
+  for (auto & t : thrs) { t.join(); }
+  EXPECT_EQ(n*(n+1)/2, val);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(mpmc_queue_statistics, counters){
+  mpmc_queue<int> q(4, queue_mode::lockfree);
+  auto stats = std::make_shared<queue_statistics>();
+  q.set_statistics(stats);
+
+  int in[] = {1,2,3};
+  q.push_n(std::begin(in), std::end(in));
+  q.push(4);
+  EXPECT_TRUE(q.full());
+  EXPECT_FALSE(q.try_push(5));
+  int out[2];
+  q.pop_n(out, 2);
+  q.pop();
+
+  auto c = stats->counters();
+  EXPECT_EQ(4u, c.pushes);
+  EXPECT_EQ(3u, c.pops);
+  EXPECT_EQ(4u, c.high_water_mark);
+}
+
+TEST(mpmc_queue_statistics, pop_wait){
+  mpmc_queue<int> q(4, queue_mode::blocking);
+  auto stats = std::make_shared<queue_statistics>();
+  q.set_statistics(stats);
+
+  std::thread producer{[&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    q.push(1);
+  }};
+  EXPECT_EQ(1, q.pop());
+  producer.join();
+
+  EXPECT_LE(std::chrono::milliseconds(10), stats->counters().pop_wait);
+}
+
+TEST(mpmc_queue_sharded, push_pop){
+  mpmc_queue<int> q(6, queue_shards{3});
+  int in[] = {1,2,3,4,5};
+  q.push_n(std::begin(in), std::end(in));
+
+  int val = q.pop_from(2);
+  int out[5];
+  auto n = q.pop_n(out, 5);
+  val = std::accumulate(out, out+n, val);
+  while (!q.empty()) { val += q.pop(); }
+  EXPECT_EQ(15, val);
+}
+
+TEST(mpmc_queue_move_only, push_pop){
+  for (auto mode : {queue_mode::blocking, queue_mode::lockfree, 
+      queue_mode::sequenced, queue_mode::unbounded}) {
+    mpmc_queue<std::unique_ptr<int>> q(4, mode);
+    for (int i=0; i<3; ++i) { q.push(std::make_unique<int>(i)); }
+
+    int val = 0;
+    for (int i=0; i<3; ++i) {
+      val += *q.pop();
+    }
+    EXPECT_EQ(3, val);
+    EXPECT_TRUE(q.empty());
+  }
+}
@@ -14,11 +14,17 @@
  * limitations under the License.
  */
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <numeric>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "grppi/pipeline.h"
+#include "grppi/farm.h"
+#include "grppi/stream_filter.h"
 #include "grppi/dyn/dynamic_execution.h"
 
 #include "supported_executions.h"
@@ -215,6 +221,28 @@ public:
       });
   }
 
+  template <typename E>
+  void run_fused(const E & e) {
+    grppi::pipeline(e,
+      [this,i=0,max=counter]() mutable -> grppi::optional<int> {
+        invocations_init++;
+        if (++i<=max) return i;
+        else return {};
+      },
+      grppi::fuse(
+        [this](int x) {
+          invocations_intermediate++;
+          return x*x;
+        },
+        [](int x) {
+          return x+1;
+        }),
+      [this](int x) {
+        invocations_last++;
+        out += x;
+      });
+  }
+
   void check_composed() {
     EXPECT_EQ(6, invocations_init); 
     EXPECT_EQ(5, invocations_last); 
@@ -296,3 +324,369 @@ TYPED_TEST(pipeline_test, static_composed_piecewise)
   this->run_composed_piecewise(this->execution_);
   this->check_composed();
 }
+
+TYPED_TEST(pipeline_test, static_fused)
+{
+  this->setup_composed();
+  this->run_fused(this->execution_);
+  this->check_composed();
+}
+
+TYPED_TEST(pipeline_test, dyn_fused)
+{
+  this->setup_composed();
+  this->run_fused(this->dyn_execution_);
+  this->check_composed();
+}
+
+template <typename T>
+class pipeline_cancel_test : public ::testing::Test {
+public:
+  T execution_{};
+  cancellation_token token_{};
+
+  // Stops an endless stream once the consumer finds an item
+  void run_cancelled(int target) {
+    execution_.set_cancellation_token(token_);
+    std::atomic<int> found{0};
+    grppi::pipeline(execution_,
+      [i=0]() mutable -> grppi::optional<int> { return ++i; },
+      [](int x) { return x*2; },
+      [&](int x) {
+        if (x == 2*target) {
+          found++;
+          token_.cancel();
+        }
+      });
+    EXPECT_EQ(1, found);
+    EXPECT_TRUE(token_.is_cancelled());
+  }
+};
+
+TYPED_TEST_CASE(pipeline_cancel_test, executions_noff);
+
+TYPED_TEST(pipeline_cancel_test, static_cancelled)
+{
+  this->run_cancelled(500);
+}
+
+TEST(pipeline_native, lockfree_single_producer_links)
+{
+  parallel_execution_native ex{2};
+  ex.set_queue_attributes(4, queue_mode::lockfree);
+
+  long out = 0;
+  grppi::pipeline(ex,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (++i<=100) return i;
+      else return {};
+    },
+    [](int x) { return x*2; },
+    [](int x) { return x+1; },
+    [&out](int x) { out += x; });
+
+  EXPECT_EQ(100*101 + 100, out);
+}
+
+TEST(pipeline_native, sharded_farm)
+{
+  parallel_execution_native ex{4};
+  ex.set_queue_attributes(4, queue_mode::lockfree);
+  ex.set_farm_distribution(farm_distribution::sharded);
+
+  long out = 0;
+  grppi::pipeline(ex,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (++i<=100) return i;
+      else return {};
+    },
+    grppi::farm(3, [](int x) { return x*2; }),
+    [&out](int x) { out += x; });
+
+  EXPECT_EQ(100*101, out);
+}
+
+TEST(pipeline_native, queue_statistics)
+{
+  parallel_execution_native ex{4};
+  ex.set_queue_statistics(true);
+
+  long out = 0;
+  grppi::pipeline(ex,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (++i<=100) return i;
+      else return {};
+    },
+    [](int x) { return x*2; },
+    [&out](int x) { out += x; });
+
+  EXPECT_EQ(100*101, out);
+  auto counters = ex.get_queue_statistics();
+  ASSERT_FALSE(counters.empty());
+  for (auto & c : counters) {
+    EXPECT_LE(101u, c.pushes);
+    EXPECT_EQ(c.pushes, c.pops);
+  }
+}
+
+TEST(pipeline_native, copied_policy_options)
+{
+  parallel_execution_native ex{4};
+  ex.set_queue_attributes(64, queue_mode::sequenced);
+  ex.set_queue_wait(queue_wait::backoff);
+  ex.set_queue_limit(1000);
+  ex.set_reorder_capacity(32);
+  ex.set_farm_distribution(farm_distribution::sharded);
+  ex.set_schedule(loop_schedule::dynamic_chunks, 16);
+  ex.set_stage_fusion(true);
+  ex.set_queue_statistics(true);
+
+  parallel_execution_native copy{ex};
+  EXPECT_EQ(4, copy.concurrency_degree());
+  EXPECT_EQ(64, copy.get_queue_size());
+  EXPECT_EQ(queue_mode::sequenced, copy.get_queue_mode());
+  EXPECT_EQ(queue_wait::backoff, copy.get_queue_wait());
+  EXPECT_EQ(1000u, copy.get_queue_limit());
+  EXPECT_EQ(32, copy.get_reorder_capacity());
+  EXPECT_EQ(farm_distribution::sharded, copy.get_farm_distribution());
+  EXPECT_EQ(loop_schedule::dynamic_chunks, copy.schedule());
+  EXPECT_TRUE(copy.is_stage_fusion());
+
+  // Copies, including the one held by a dynamic policy, record their queues
+  // in the statistics of the original policy
+  dynamic_execution dyn{copy};
+  long out = 0;
+  grppi::pipeline(dyn,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (++i<=100) return i;
+      else return {};
+    },
+    grppi::farm(2, [](int x) { return x*2; }),
+    [&out](int x) { out += x; });
+
+  EXPECT_EQ(100*101, out);
+  EXPECT_FALSE(ex.get_queue_statistics().empty());
+  EXPECT_EQ(ex.get_queue_statistics().size(),
+      copy.get_queue_statistics().size());
+}
+
+TEST(pipeline_native, bounded_reorder_window)
+{
+  parallel_execution_native ex{4};
+  ex.set_reorder_capacity(8);
+
+  // While the first item stalls, the farm may only start the items that
+  // follow it within the reorder capacity
+  atomic<bool> stalled{true};
+  atomic<long> max_started{0};
+  vector<long> out;
+  grppi::pipeline(ex,
+    [i=0L]() mutable -> grppi::optional<long> {
+      if (i<1000) return i++;
+      else return {};
+    },
+    grppi::farm(4, [&](long x) {
+      if (x==0) {
+        this_thread::sleep_for(chrono::milliseconds{100});
+        stalled = false;
+      }
+      else if (stalled) {
+        long m = max_started;
+        while (m<x && !max_started.compare_exchange_weak(m, x)) {}
+      }
+      return x;
+    }),
+    [&out](long x) { out.push_back(x); });
+
+  EXPECT_LT(max_started.load(), 8);
+  vector<long> expected(1000);
+  iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(expected, out);
+}
+
+TEST(pipeline_native, bounded_reorder_window_filter)
+{
+  parallel_execution_native ex{4};
+  ex.set_reorder_capacity(8);
+
+  // The filter releases the credit of the generator and issues its own
+  // for the consumer
+  vector<long> out;
+  grppi::pipeline(ex,
+    [i=0L]() mutable -> grppi::optional<long> {
+      if (i<1000) return i++;
+      else return {};
+    },
+    grppi::farm(4, [](long x) {
+      if (x%100==0) this_thread::sleep_for(chrono::milliseconds{10});
+      return x;
+    }),
+    grppi::discard([](long x) { return x%3==0; }),
+    grppi::farm(4, [](long x) { return x; }),
+    [&out](long x) { out.push_back(x); });
+
+  vector<long> expected;
+  for (long i=0; i<1000; ++i) {
+    if (i%3!=0) expected.push_back(i);
+  }
+  EXPECT_EQ(expected, out);
+}
+
+TEST(pipeline_native, sharded_farm_sink)
+{
+  parallel_execution_native ex{4};
+  ex.set_farm_distribution(farm_distribution::sharded);
+
+  std::atomic<long> out{0};
+  grppi::pipeline(ex,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (++i<=100) return i;
+      else return {};
+    },
+    grppi::farm(3, [&out](int x) { out += x; }));
+
+  EXPECT_EQ(100*101/2, out);
+}
+
+TEST(pipeline_native, stage_fusion)
+{
+  parallel_execution_native ex{4};
+  ex.set_stage_fusion(true);
+
+  long out = 0;
+  bool same_thread = true;
+  grppi::pipeline(ex,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (++i<=100) return i;
+      else return {};
+    },
+    [](int x) { return std::make_pair(x*2, std::this_thread::get_id()); },
+    [](auto p) { return std::make_pair(p.first+1, p.second); },
+    [&](auto p) { 
+      same_thread = same_thread && p.second == std::this_thread::get_id();
+      out += p.first; 
+    });
+
+  EXPECT_EQ(100*101 + 100, out);
+  EXPECT_TRUE(same_thread);
+}
+
+TEST(pipeline_native, stage_fusion_around_patterns)
+{
+  parallel_execution_native ex{4};
+  ex.set_stage_fusion(true);
+
+  long out = 0;
+  grppi::pipeline(ex,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (++i<=100) return i;
+      else return {};
+    },
+    [](int x) { return x*2; },
+    [](int x) { return x+1; },
+    grppi::farm(3, [](int x) { return x-1; }),
+    grppi::pipeline(
+      [](int x) { return x*3; },
+      [](int x) { return x/3; }),
+    [](int x) { return x/2; },
+    [&out](int x) { out += x; });
+
+  EXPECT_EQ(100*101/2, out);
+}
+
+TEST(pipeline_native, move_only_items)
+{
+  parallel_execution_native ex{4};
+
+  for (bool ordered : {true, false}) {
+    if (ordered) ex.enable_ordering();
+    else ex.disable_ordering();
+
+    long out = 0;
+    grppi::pipeline(ex,
+      [i=0]() mutable -> grppi::optional<std::unique_ptr<int>> {
+        if (++i<=100) return std::make_unique<int>(i);
+        else return {};
+      },
+      [](std::unique_ptr<int> p) { *p *= 2; return p; },
+      grppi::farm(3, [](std::unique_ptr<int> p) { *p += 1; return p; }),
+      grppi::keep([](std::unique_ptr<int> const & p) { return *p % 3 != 0; }),
+      [&out](std::unique_ptr<int> p) { out += *p; });
+
+    EXPECT_EQ(6732, out);
+  }
+}
+
+TEST(pipeline_native, reference_parameters)
+{
+  parallel_execution_native ex{4};
+
+  // Items are moved to stages taking rvalues and passed as lvalues to
+  // stages taking non-const references
+  for (bool fusion : {true, false}) {
+    for (bool ordered : {true, false}) {
+      ex.set_stage_fusion(fusion);
+      if (ordered) ex.enable_ordering();
+      else ex.disable_ordering();
+
+      long lvalue_out = 0;
+      grppi::pipeline(ex,
+        [i=0]() mutable -> grppi::optional<int> {
+          if (++i<=100) return i;
+          else return {};
+        },
+        [](int & x) { x *= 2; return x; },
+        [](int & x) -> int { return x+1; },
+        grppi::farm(3, [](int & x) { return x-1; }),
+        [&lvalue_out](int & x) { lvalue_out += x; });
+      EXPECT_EQ(100*101, lvalue_out);
+
+      long rvalue_out = 0;
+      grppi::pipeline(ex,
+        [i=0]() mutable -> grppi::optional<int> {
+          if (++i<=100) return i;
+          else return {};
+        },
+        [](int && x) { return x*2; },
+        [](int && x) { return x+1; },
+        grppi::farm(3, [](int && x) { return x-1; }),
+        [&rvalue_out](int && x) { rvalue_out += x; });
+      EXPECT_EQ(100*101, rvalue_out);
+
+      std::atomic<long> farm_out{0};
+      grppi::pipeline(ex,
+        [i=0]() mutable -> grppi::optional<int> {
+          if (++i<=100) return i;
+          else return {};
+        },
+        grppi::farm(3, [&farm_out](int & x) { farm_out += x; }));
+      EXPECT_EQ(100*101/2, farm_out);
+    }
+  }
+}
+
+TEST(pipeline_native, cancelled_farm)
+{
+  parallel_execution_native ex{4};
+  cancellation_token token;
+  ex.set_cancellation_token(token);
+
+  std::atomic<long> generated{0};
+  std::atomic<long> generated_at_cancel{0};
+  grppi::pipeline(ex,
+    [&]() -> grppi::optional<int> { return ++generated; },
+    grppi::farm(3, [&](int x) { 
+      if (x == 1000) {
+        token.cancel();
+        generated_at_cancel = generated.load();
+      }
+      return x; 
+    }),
+    grppi::keep([](int x) { return x % 2 == 0; }),
+    [](int) {});
+
+  // Only a call already started before the cancellation may follow it
+  EXPECT_TRUE(token.is_cancelled());
+  EXPECT_LE(1000, generated_at_cancel);
+  EXPECT_GE(generated_at_cancel + 1, generated);
+}
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include <atomic>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -76,6 +77,19 @@ public:
     EXPECT_EQ(15, out); 
   }
 
+  template <typename E>
+  void run_ordered(const E & e, int size) {
+    vector<string> words(size);
+    string expected;
+    for (int i=0; i<size; ++i) {
+      words[i] = to_string(i) + ",";
+      expected += words[i];
+    }
+    auto result = grppi::reduce(e, words.begin(), words.end(), string{},
+      [](string const & x, string const & y) { return x + y; });
+    EXPECT_EQ(expected, result);
+  }
+
 };
 
 // Test for execution policies defined in supported_executions.h
@@ -144,6 +158,11 @@ TYPED_TEST(reduce_test, static_multiple_range)
   this->check_multiple();
 }
 
+TYPED_TEST(reduce_test, static_ordered)
+{
+  this->run_ordered(this->execution_, 1001);
+}
+
 TYPED_TEST(reduce_test, dyn_multiple)
 {
   this->setup_multiple();
@@ -164,3 +183,20 @@ TYPED_TEST(reduce_test, dyn_multiple_range)
   this->run_unary_range(this->dyn_execution_);
   this->check_multiple();
 }
+
+TEST(reduce_native, tree_combine_keeps_order)
+{
+  parallel_execution_native ex{4};
+  ex.set_schedule(loop_schedule::dynamic_chunks, 1);
+  for (int size : {1, 2, 3, 7, 64, 999}) {
+    vector<string> words(size);
+    string expected;
+    for (int i=0; i<size; ++i) {
+      words[i] = to_string(i) + ",";
+      expected += words[i];
+    }
+    auto result = grppi::reduce(ex, begin(words), end(words), string{},
+        [](string const & x, string const & y) { return x + y; });
+    EXPECT_EQ(expected, result);
+  }
+}
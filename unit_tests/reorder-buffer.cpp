@@ -0,0 +1,98 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include "grppi/common/reorder_buffer.h"
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+using namespace grppi;
+
+TEST(reorder_buffer, in_order){
+  reorder_buffer<int> buffer{4};
+  vector<int> out;
+  for (int i=0; i<10; ++i) {
+    buffer.insert(i, int{i});
+    buffer.release_ready([&](int x) { out.push_back(x); });
+  }
+  EXPECT_EQ((vector<int>{0,1,2,3,4,5,6,7,8,9}), out);
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(4u, buffer.capacity());
+}
+
+TEST(reorder_buffer, reversed){
+  reorder_buffer<string> buffer{4};
+  for (int i=3; i>0; --i) {
+    buffer.insert(i, to_string(i));
+    EXPECT_FALSE(buffer.ready());
+  }
+  buffer.insert(0, "0");
+  EXPECT_TRUE(buffer.ready());
+  EXPECT_EQ("0", buffer.release());
+  EXPECT_EQ(3u, buffer.size());
+  string out;
+  EXPECT_EQ(3u, buffer.release_ready([&](string & s) { out += s; }));
+  EXPECT_EQ("123", out);
+  EXPECT_EQ(4, buffer.next());
+}
+
+TEST(reorder_buffer, keeps_capacity){
+  reorder_buffer<int> buffer{2};
+  int expected = 0;
+  for (int i=0; i<10; i+=2) {
+    buffer.insert(i+1, i+1);
+    EXPECT_FALSE(buffer.ready());
+    buffer.insert(i, int{i});
+    buffer.release_ready([&](int x) { EXPECT_EQ(expected++, x); });
+    EXPECT_EQ(2u, buffer.capacity());
+  }
+  EXPECT_EQ(10, expected);
+}
+
+TEST(reorder_credit, waits_for_release){
+  reorder_credit credit{4};
+  for (long i=0; i<4; ++i) {
+    EXPECT_TRUE(credit.available(i));
+  }
+  EXPECT_FALSE(credit.available(4));
+
+  atomic<bool> acquired{false};
+  thread issuer{[&] {
+    credit.acquire(4, [] { return false; });
+    acquired = true;
+  }};
+  this_thread::sleep_for(chrono::milliseconds{50});
+  EXPECT_FALSE(acquired);
+  credit.release(1);
+  issuer.join();
+  EXPECT_TRUE(acquired);
+}
+
+TEST(reorder_credit, cancelled_wait){
+  reorder_credit credit{4};
+  atomic<bool> cancelled{false};
+  thread issuer{[&] {
+    credit.acquire(10, [&] { return cancelled.load(); });
+  }};
+  this_thread::sleep_for(chrono::milliseconds{10});
+  cancelled = true;
+  issuer.join();
+  EXPECT_FALSE(credit.available(10));
+}
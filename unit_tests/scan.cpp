@@ -0,0 +1,174 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <numeric>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "grppi/scan.h"
+#include "grppi/dyn/dynamic_execution.h"
+
+#include "supported_executions.h"
+
+using namespace std;
+using namespace grppi;
+
+template <typename T>
+class scan_test : public ::testing::Test {
+public:
+  T execution_{};
+  dynamic_execution dyn_execution_{execution_};
+
+  // Vectors
+  vector<long> v{};
+  vector<long> w{};
+  vector<long> expected{};
+
+  template <typename E>
+  void run_inclusive(const E & e) {
+    grppi::scan(e, v.begin(), v.end(), w.begin(), 0L,
+      [](long x, long y) { return x + y; });
+  }
+
+  template <typename E>
+  void run_exclusive_range(const E & e) {
+    grppi::scan(e, v, w, 0L,
+      [](long x, long y) { return x + y; },
+      scan_mode::exclusive);
+  }
+
+  template <typename E>
+  void run_inplace(const E & e) {
+    grppi::scan(e, v.begin(), v.end(), v.begin(), 0L,
+      [](long x, long y) { return x + y; });
+  }
+
+  void setup_empty() {
+    v = vector<long>{};
+    w = vector<long>{};
+  }
+
+  void setup_multiple(scan_mode mode) {
+    v = vector<long>(1000);
+    iota(v.begin(), v.end(), 1L);
+    w = vector<long>(v.size());
+    expected = vector<long>(v.size());
+    long sum = 0;
+    for (size_t i=0; i<v.size(); ++i) {
+      if (mode == scan_mode::exclusive) {
+        expected[i] = sum;
+        sum += v[i];
+      }
+      else {
+        sum += v[i];
+        expected[i] = sum;
+      }
+    }
+  }
+
+  void check_empty() {
+    EXPECT_TRUE(w.empty());
+  }
+
+  void check_multiple() {
+    EXPECT_EQ(expected, w);
+  }
+
+  void check_inplace() {
+    EXPECT_EQ(expected, v);
+  }
+
+  template <typename E>
+  void run_ordered(const E & e, int size) {
+    vector<string> words(size);
+    vector<string> expected_words(size);
+    string prefix;
+    for (int i=0; i<size; ++i) {
+      words[i] = to_string(i) + ",";
+      expected_words[i] = prefix;
+      prefix += words[i];
+    }
+    vector<string> result(size);
+    grppi::scan(e, words, result, string{},
+      [](string const & x, string const & y) { return x + y; },
+      scan_mode::exclusive);
+    EXPECT_EQ(expected_words, result);
+  }
+};
+
+// Test for execution policies defined in supported_executions.h
+TYPED_TEST_CASE(scan_test, executions);
+
+TYPED_TEST(scan_test, static_empty)
+{
+  this->setup_empty();
+  this->run_inclusive(this->execution_);
+  this->check_empty();
+}
+
+TYPED_TEST(scan_test, static_inclusive)
+{
+  this->setup_multiple(scan_mode::inclusive);
+  this->run_inclusive(this->execution_);
+  this->check_multiple();
+}
+
+TYPED_TEST(scan_test, static_exclusive_range)
+{
+  this->setup_multiple(scan_mode::exclusive);
+  this->run_exclusive_range(this->execution_);
+  this->check_multiple();
+}
+
+TYPED_TEST(scan_test, static_inplace)
+{
+  this->setup_multiple(scan_mode::inclusive);
+  this->run_inplace(this->execution_);
+  this->check_inplace();
+}
+
+TYPED_TEST(scan_test, static_ordered)
+{
+  this->run_ordered(this->execution_, 1001);
+}
+
+TYPED_TEST(scan_test, dyn_inclusive)
+{
+  this->setup_multiple(scan_mode::inclusive);
+  this->run_inclusive(this->dyn_execution_);
+  this->check_multiple();
+}
+
+TYPED_TEST(scan_test, dyn_exclusive_range)
+{
+  this->setup_multiple(scan_mode::exclusive);
+  this->run_exclusive_range(this->dyn_execution_);
+  this->check_multiple();
+}
+
+TEST(scan_native, dynamic_chunks)
+{
+  parallel_execution_native ex{4};
+  ex.set_schedule(loop_schedule::dynamic_chunks, 1);
+  for (int size : {1, 2, 3, 7, 64, 999}) {
+    vector<long> v(size);
+    iota(v.begin(), v.end(), 1L);
+    vector<long> expected(size);
+    partial_sum(v.begin(), v.end(), expected.begin());
+    grppi::scan(ex, v, v, 0L, [](long x, long y) { return x + y; });
+    EXPECT_EQ(expected, v);
+  }
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "grppi/sort.h"
+#include "grppi/dyn/dynamic_execution.h"
+
+#include "supported_executions.h"
+
+using namespace std;
+using namespace grppi;
+
+template <typename T>
+class sort_test : public ::testing::Test {
+public:
+  T execution_{};
+  dynamic_execution dyn_execution_{execution_};
+
+  // Vectors
+  vector<int> v{};
+  vector<int> expected{};
+
+  void setup_empty() {
+    v = vector<int>{};
+    expected = v;
+  }
+
+  void setup_random(int size, int max_value) {
+    mt19937 gen{42};
+    uniform_int_distribution<int> dist{0, max_value};
+    v = vector<int>(size);
+    for (auto & x : v) { x = dist(gen); }
+    expected = v;
+    std::sort(expected.begin(), expected.end());
+  }
+
+  template <typename E>
+  void run_iterators(const E & e) {
+    grppi::sort(e, v.begin(), v.end());
+  }
+
+  template <typename E>
+  void run_range(const E & e) {
+    grppi::sort(e, v);
+  }
+
+  void check() {
+    EXPECT_EQ(expected, v);
+  }
+
+  template <typename E>
+  void run_descending_strings(const E & e, int size) {
+    vector<string> words(size);
+    for (int i=0; i<size; ++i) {
+      words[i] = to_string((i * 7919) % size);
+    }
+    auto expected_words = words;
+    std::sort(expected_words.begin(), expected_words.end(), greater<>{});
+    grppi::sort(e, words, greater<>{});
+    EXPECT_EQ(expected_words, words);
+  }
+};
+
+// Test for execution policies defined in supported_executions.h
+TYPED_TEST_CASE(sort_test, executions);
+
+TYPED_TEST(sort_test, static_empty)
+{
+  this->setup_empty();
+  this->run_iterators(this->execution_);
+  this->check();
+}
+
+TYPED_TEST(sort_test, static_small)
+{
+  this->setup_random(100, 1000);
+  this->run_iterators(this->execution_);
+  this->check();
+}
+
+TYPED_TEST(sort_test, static_large)
+{
+  this->setup_random(20000, 1000000);
+  this->run_iterators(this->execution_);
+  this->check();
+}
+
+TYPED_TEST(sort_test, static_large_range)
+{
+  this->setup_random(20000, 1000000);
+  this->run_range(this->execution_);
+  this->check();
+}
+
+TYPED_TEST(sort_test, static_duplicates)
+{
+  this->setup_random(20000, 3);
+  this->run_iterators(this->execution_);
+  this->check();
+}
+
+TYPED_TEST(sort_test, static_comparator)
+{
+  this->run_descending_strings(this->execution_, 5000);
+}
+
+TYPED_TEST(sort_test, dyn_large)
+{
+  this->setup_random(20000, 1000000);
+  this->run_iterators(this->dyn_execution_);
+  this->check();
+}
+
+TYPED_TEST(sort_test, dyn_duplicates)
+{
+  this->setup_random(20000, 3);
+  this->run_range(this->dyn_execution_);
+  this->check();
+}
+
+TEST(sample_sort, merge_fallback)
+{
+  parallel_execution_native ex{3};
+  for (int size : {2048, 5000, 20011}) {
+    vector<int> v(size, 7);
+    for (int i=0; i<size; i+=97) { v[i] = i; }
+    auto expected = v;
+    std::sort(expected.begin(), expected.end());
+    grppi::sort(ex, v);
+    EXPECT_EQ(expected, v);
+  }
+}
+
+TEST(sample_sort, small_blocks)
+{
+  vector<int> v(20000);
+  for (size_t i=0; i<v.size(); ++i) { v[i] = (i * 7919) % 100003; }
+  auto expected = v;
+  std::sort(expected.begin(), expected.end());
+  sample_sort(v.begin(), v.end(), less<>{}, 4,
+      [](size_t n, auto && f) { for (size_t i=0; i<n; ++i) f(i); },
+      1024);
+  EXPECT_EQ(expected, v);
+}
@@ -19,6 +19,7 @@
 
 #include "grppi/stream_filter.h"
 #include "grppi/pipeline.h"
+#include "grppi/farm.h"
 #include "grppi/dyn/dynamic_execution.h"
 
 #include "supported_executions.h"
@@ -309,3 +310,22 @@ TYPED_TEST(stream_filter_test, dyn_discard_multiple)
   this->run_discard_multiple(this->dyn_execution_);
   this->check_discard_multiple();
 }
+
+TEST(stream_filter_native, ordered_selective_after_farm)
+{
+  parallel_execution_native ex{4};
+  ex.enable_ordering();
+
+  vector<int> out;
+  grppi::pipeline(ex,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (i<10000) return i++;
+      else return {};
+    },
+    grppi::farm(4, [](int x) { return x; }),
+    grppi::keep([](int x) { return x%100 == 0; }),
+    [&out](int x) { out.push_back(x); });
+
+  ASSERT_EQ(100u, out.size());
+  for (int i=0; i<100; ++i) { EXPECT_EQ(i*100, out[i]); }
+}
@@ -13,7 +13,12 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
 #include <atomic>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <thread>
 
 #include <gtest/gtest.h>
 
@@ -207,3 +212,254 @@ TYPED_TEST(stream_reduce_test, dyn_offset_window)
   this->run_reduction_add(this->dyn_execution_);
   this->check_offset_window();
 }
+
+template <typename T>
+class stream_reduce_by_key_test : public ::testing::Test {
+public:
+  T execution_{};
+
+  // Results of every window by key
+  map<int,vector<long>> out{};
+
+  template <typename E>
+  void run_reduction_by_key(const E & e, int replicas, int window,
+                            int offset) {
+    grppi::pipeline(e,
+      [i=0]() mutable -> grppi::optional<int> {
+        if (i < 1000) return i++;
+        return {};
+      },
+      grppi::reduce_by_key(replicas, window, offset,
+        [](int x) { return x % 7; },
+        0L,
+        [](long acc, int x) { return acc + x; }),
+      [this](pair<int,long> r) {
+        out[r.first].push_back(r.second);
+      });
+  }
+
+  void check(int window, int offset) {
+    map<int,vector<long>> expected;
+    for (int k=0; k<7; ++k) {
+      vector<int> items;
+      for (int x=k; x<1000; x+=7) { items.push_back(x); }
+      for (std::size_t first=0; first+window <= items.size(); 
+           first+=offset) {
+        long sum = 0;
+        for (int j=0; j<window; ++j) { sum += items[first+j]; }
+        expected[k].push_back(sum);
+      }
+    }
+    EXPECT_EQ(expected, out);
+  }
+};
+
+TYPED_TEST_CASE(stream_reduce_by_key_test, executions_noff);
+
+TYPED_TEST(stream_reduce_by_key_test, static_tumbling)
+{
+  this->run_reduction_by_key(this->execution_, 1, 3, 3);
+  this->check(3, 3);
+}
+
+TYPED_TEST(stream_reduce_by_key_test, static_sliding)
+{
+  this->run_reduction_by_key(this->execution_, 1, 4, 2);
+  this->check(4, 2);
+}
+
+TYPED_TEST(stream_reduce_by_key_test, static_hopping_replicas)
+{
+  this->run_reduction_by_key(this->execution_, 3, 2, 5);
+  this->check(2, 5);
+}
+
+TYPED_TEST(stream_reduce_by_key_test, static_reused_stage)
+{
+  // Every execution of the pipeline starts with empty windows
+  auto reducer = grppi::reduce_by_key(10, 10,
+      [](int) { return 0; },
+      0L,
+      [](long acc, int x) { return acc + x; });
+  for (int run=0; run<2; ++run) {
+    grppi::pipeline(this->execution_,
+      [i=0]() mutable -> grppi::optional<int> {
+        if (i < 15) return i++;
+        return {};
+      },
+      reducer,
+      [this](pair<int,long> r) { this->out[r.first].push_back(r.second); });
+  }
+  EXPECT_EQ((map<int,vector<long>>{{0, {45, 45}}}), this->out);
+}
+
+TEST(stream_reduce_by_key_native, ordered_replicas)
+{
+  parallel_execution_native ex{4};
+  vector<pair<int,long>> out;
+  grppi::pipeline(ex,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (i < 10000) return i++;
+      return {};
+    },
+    grppi::reduce_by_key(4, 10, 10,
+      [](int x) { return x % 100; },
+      0L,
+      [](long acc, int x) { return acc + x; }),
+    [&](pair<int,long> r) { out.push_back(r); });
+
+  ASSERT_EQ(1000u, out.size());
+  map<int,long> last;
+  for (auto & r : out) {
+    auto it = last.find(r.first);
+    if (it != last.end()) {
+      EXPECT_LT(it->second, r.second);
+    }
+    last[r.first] = r.second;
+  }
+}
+
+template <typename T>
+class stream_reduce_by_time_test : public ::testing::Test {
+public:
+  T execution_{};
+
+  // Results of every window
+  vector<long> out{};
+
+  // Runs a reduction of items 0..100, with timestamps 100 ms apart
+  template <typename E>
+  void run_reduction_by_time(const E & e, int window, int slide) {
+    grppi::pipeline(e,
+      [i=0]() mutable -> grppi::optional<int> {
+        if (i <= 100) return i++;
+        return {};
+      },
+      grppi::reduce_by_time(
+        chrono::milliseconds{window}, chrono::milliseconds{slide},
+        [](int x) { return chrono::milliseconds{100 * x}; },
+        0L,
+        [](long acc, int x) { return acc + x; }),
+      [this](long r) { out.push_back(r); });
+  }
+};
+
+TYPED_TEST_CASE(stream_reduce_by_time_test, executions);
+
+TYPED_TEST(stream_reduce_by_time_test, static_tumbling)
+{
+  this->run_reduction_by_time(this->execution_, 1000, 1000);
+
+  // The last window only holds item 100 and is reduced at the end
+  vector<long> expected;
+  for (int k=0; k<=10; ++k) {
+    long sum = 0;
+    for (int i=10*k; i<std::min(10*k+10,101); ++i) { sum += i; }
+    expected.push_back(sum);
+  }
+  EXPECT_EQ(expected, this->out);
+}
+
+TYPED_TEST(stream_reduce_by_time_test, static_sliding)
+{
+  this->run_reduction_by_time(this->execution_, 1000, 500);
+
+  // Window k holds items [5k,5k+10), the first one starts at -500 ms and
+  // the last two ones are reduced at the end
+  vector<long> expected;
+  for (int k=-1; k<=20; ++k) {
+    long sum = 0;
+    for (int i=std::max(0,5*k); i<std::min(5*k+10,101); ++i) { sum += i; }
+    expected.push_back(sum);
+  }
+  EXPECT_EQ(expected, this->out);
+}
+
+TYPED_TEST(stream_reduce_by_time_test, static_late_items)
+{
+  vector<int> times{0, 500, 1200, 300, 1500};
+  grppi::pipeline(this->execution_,
+    [&, i=0u]() mutable -> grppi::optional<int> {
+      if (i < times.size()) return times[i++];
+      return {};
+    },
+    grppi::reduce_by_time(
+      chrono::milliseconds{1000}, chrono::milliseconds{1000},
+      [](int t) { return chrono::milliseconds{t}; },
+      0L,
+      [](long acc, int x) { return acc + x; }),
+    [this](long r) { this->out.push_back(r); });
+
+  // Item at 300 ms arrives after its window was closed
+  EXPECT_EQ((vector<long>{500, 2700}), this->out);
+}
+
+TYPED_TEST(stream_reduce_by_time_test, static_nested)
+{
+  auto reducer = grppi::reduce_by_time(
+      chrono::milliseconds{1000}, chrono::milliseconds{1000},
+      [](int x) { return chrono::milliseconds{100 * x}; },
+      0L,
+      [](long acc, int x) { return acc + x; });
+  grppi::pipeline(this->execution_,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (i <= 100) return i++;
+      return {};
+    },
+    grppi::pipeline(
+      [](int x) { return x; },
+      reducer,
+      [](long r) { return 2*r; }),
+    [this](long r) { this->out.push_back(r); });
+
+  // The windows left open are reduced and go through the next stages
+  vector<long> expected;
+  for (int k=0; k<=10; ++k) {
+    long sum = 0;
+    for (int i=10*k; i<std::min(10*k+10,101); ++i) { sum += i; }
+    expected.push_back(2*sum);
+  }
+  EXPECT_EQ(expected, this->out);
+}
+
+TEST(stream_reduce_by_time, bounded_windows)
+{
+  auto reducer = grppi::reduce_by_time(
+      chrono::milliseconds{1000}, chrono::milliseconds{250},
+      [](int t) { return chrono::milliseconds{t}; },
+      0L,
+      [](long acc, int x) { return acc + x; });
+
+  int results = 0;
+  for (int t=0; t<100000; t+=10) {
+    reducer.add_item(t, [&](long) { results++; });
+    EXPECT_GE(4u, reducer.open_windows());
+  }
+  // Windows start from -750 ms, and those ending after 99990 ms are open
+  EXPECT_EQ(399, results);
+  reducer.flush([&](long) { results++; });
+  EXPECT_EQ(403, results);
+  EXPECT_EQ(0u, reducer.open_windows());
+}
+
+TEST(stream_reduce_by_time_native, idle_flush)
+{
+  parallel_execution_native ex{};
+  vector<long> out;
+  grppi::pipeline(ex,
+    [i=0]() mutable -> grppi::optional<int> {
+      if (i < 3) return ++i;
+      // Input goes quiet before the end of the stream
+      this_thread::sleep_for(chrono::milliseconds{500});
+      return {};
+    },
+    grppi::reduce_by_time(
+      chrono::milliseconds{50}, chrono::milliseconds{50},
+      0L,
+      [](long acc, int x) { return acc + x; }),
+    [&](long r) { out.push_back(r); });
+
+  long total = 0;
+  for (auto r : out) { total += r; }
+  EXPECT_EQ(6, total);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2018 Universidad Carlos III de Madrid
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include "grppi/grppi.h"
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using namespace grppi;
+
+TEST(thread_registry, unregistered){
+  thread_registry registry;
+  EXPECT_EQ(-1, registry.current_index());
+}
+
+TEST(thread_registry, nested_registration){
+  thread_registry registry;
+  registry.register_thread();
+  registry.register_thread();
+  EXPECT_EQ(0, registry.current_index());
+  registry.deregister_thread();
+  EXPECT_EQ(0, registry.current_index());
+  registry.deregister_thread();
+  EXPECT_EQ(-1, registry.current_index());
+}
+
+TEST(thread_registry, several_registries){
+  thread_registry first, second;
+  first.register_thread();
+  second.register_thread();
+  thread t{[&] {
+    native_thread_manager manager{second};
+    native_thread_manager other{first};
+    EXPECT_EQ(1, first.current_index());
+    EXPECT_EQ(1, second.current_index());
+  }};
+  t.join();
+  EXPECT_EQ(0, first.current_index());
+  EXPECT_EQ(0, second.current_index());
+  first.deregister_thread();
+  EXPECT_EQ(-1, first.current_index());
+  EXPECT_EQ(0, second.current_index());
+  second.deregister_thread();
+  EXPECT_EQ(-1, second.current_index());
+}
+
+TEST(thread_registry, recycles_indices){
+  thread_registry registry;
+  registry.register_thread();
+
+  for (int i=0; i<10; ++i) {
+    int index = -1;
+    thread t{[&] {
+      native_thread_manager manager{registry};
+      index = registry.current_index();
+    }};
+    t.join();
+    EXPECT_EQ(1, index);
+  }
+
+  EXPECT_EQ(0, registry.current_index());
+  registry.deregister_thread();
+}
+
+TEST(thread_registry, concurrent_indices){
+  thread_registry registry;
+  constexpr int nthreads = 8;
+  vector<int> indices(nthreads);
+  atomic<int> registered{0};
+
+  vector<thread> threads;
+  for (int i=0; i<nthreads; ++i) {
+    threads.emplace_back([&,i] {
+      native_thread_manager manager{registry};
+      indices[i] = registry.current_index();
+      registered++;
+      while (registered.load() < nthreads) { this_thread::yield(); }
+    });
+  }
+  for (auto & t : threads) { t.join(); }
+
+  sort(indices.begin(), indices.end());
+  for (int i=0; i<nthreads; ++i) { EXPECT_EQ(i, indices[i]); }
+}